@@ -0,0 +1,215 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include <zenkit/DaedalusScript.hh>
+#include <zenkit/DaedalusVm.hh>
+#include <zenkit/Logger.hh>
+#include <zenkit/Stream.hh>
+#include <zenkit/addon/daedalus.hh>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A copy of the decoder DaedalusScript::instruction_at used before the code section was decoded at load time. It is
+// kept here to measure the pre-decoded instruction table against it.
+static zenkit::DaedalusInstruction decode_from_stream(zenkit::Read* r) {
+	zenkit::DaedalusInstruction s {};
+	s.op = static_cast<zenkit::DaedalusOpcode>(r->read_ubyte());
+	s.size = 1;
+
+	switch (s.op) {
+	case zenkit::DaedalusOpcode::BL:
+	case zenkit::DaedalusOpcode::BZ:
+	case zenkit::DaedalusOpcode::B:
+		s.address = r->read_uint();
+		s.size += sizeof(std::uint32_t);
+		break;
+	case zenkit::DaedalusOpcode::PUSHI:
+		s.immediate = r->read_int();
+		s.size += sizeof(std::uint32_t);
+		break;
+	case zenkit::DaedalusOpcode::BE:
+	case zenkit::DaedalusOpcode::PUSHV:
+	case zenkit::DaedalusOpcode::PUSHVI:
+	case zenkit::DaedalusOpcode::GMOVI:
+		s.symbol = r->read_uint();
+		s.size += sizeof(std::uint32_t);
+		break;
+	case zenkit::DaedalusOpcode::PUSHVV:
+		s.symbol = r->read_uint();
+		s.index = r->read_ubyte();
+		s.size += sizeof(std::uint32_t) + sizeof(std::uint8_t);
+		break;
+	default:
+		break;
+	}
+
+	return s;
+}
+
+template <typename F>
+static void measure(char const* name, std::size_t iterations, F&& fn) {
+	auto begin = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < iterations; ++i) {
+		fn();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+	std::cout << name << ": " << iterations << " iterations, " << (total / 1000000.0) << " ms total, "
+	          << (static_cast<double>(total) / static_cast<double>(iterations)) << " ns/iteration\n";
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cerr << "Usage: bench_daedalus <GOTHIC.DAT> <FUNCTION> [ITERATIONS]\n";
+		return -1;
+	}
+
+	zenkit::Logger::set_default(zenkit::LogLevel::ERROR);
+	std::size_t iterations = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10000;
+
+	measure("DaedalusScript::load", 10, [&] {
+		zenkit::DaedalusScript tmp;
+		auto rd = zenkit::Read::from(argv[1]);
+		tmp.load(rd.get());
+	});
+
+	zenkit::DaedalusScript script;
+	auto rd = zenkit::Read::from(argv[1]);
+	script.load(rd.get());
+
+	// Instruction lookup: seeking and decoding the code section like the VM did before it was decoded at load time
+	// versus the expanded DaedalusInstruction and the compact table entry used by the VM. The code section is
+	// stored at the very end of the file.
+	std::vector<std::byte> file;
+	{
+		auto in = zenkit::Read::from(argv[1]);
+		in->seek(0, zenkit::Whence::END);
+		file.resize(in->tell());
+		in->seek(0, zenkit::Whence::BEG);
+		in->read(file.data(), file.size());
+	}
+
+	std::vector<std::byte> text {file.end() - script.size(), file.end()};
+	auto text_reader = zenkit::Read::from(&text);
+
+	std::cout << "Pre-decoded instruction table: " << script.size() << " bytes of code, "
+	          << script.size() * sizeof(zenkit::DaedalusCompactInstruction) << " bytes of table\n";
+
+	measure("decode from stream (full sweep)", 100, [&] {
+		for (std::uint32_t pc = 0; pc < script.size();) {
+			text_reader->seek(pc, zenkit::Whence::BEG);
+			pc += decode_from_stream(text_reader.get()).size;
+		}
+	});
+
+	measure("DaedalusScript::instruction_at (full sweep)", 100, [&] {
+		for (std::uint32_t pc = 0; pc < script.size();) {
+			pc += script.instruction_at(pc).size;
+		}
+	});
+
+	measure("DaedalusScript::compact_instruction_at (full sweep)", 100, [&] {
+		for (std::uint32_t pc = 0; pc < script.size();) {
+			pc += script.compact_instruction_at(pc)->size;
+		}
+	});
+
+	// The static instruction mix: the most common opcode triples and how many of them were fused into
+	// superinstructions at load time.
+	std::unordered_map<std::uint32_t, std::size_t> triples;
+	std::size_t fused = 0;
+	std::uint32_t window = 0;
+	for (std::uint32_t pc = 0; pc < script.size();) {
+		auto* instr = script.compact_instruction_at(pc);
+		fused += instr->op != instr->original_op();
+		window = (window << 8 | static_cast<std::uint8_t>(instr->original_op())) & 0xFFFFFF;
+		triples[window] += 1;
+		pc += instr->size;
+	}
+
+	std::vector<std::pair<std::uint32_t, std::size_t>> mix {triples.begin(), triples.end()};
+	std::sort(mix.begin(), mix.end(), [](auto const& a, auto const& b) { return a.second > b.second; });
+	mix.resize(std::min<std::size_t>(mix.size(), 10));
+
+	std::cout << "Most common opcode triples (" << fused << " superinstructions):\n";
+	for (auto& [ops, count] : mix) {
+		std::cout << "  " << (ops >> 16) << " " << (ops >> 8 & 0xFF) << " " << (ops & 0xFF) << ": " << count << "\n";
+	}
+
+	// Symbol lookup by name over the whole symbol table, using lower-case names to exercise case folding. The
+	// baseline replicates the previous implementation, which upper-cased a copy of the name before hashing it.
+	std::vector<std::string> names;
+	std::unordered_map<std::string, std::uint32_t> names_by_copy;
+	for (auto& sym : script.symbols()) {
+		names_by_copy[sym.name()] = sym.index();
+
+		auto& name = names.emplace_back(sym.name());
+		std::transform(name.begin(), name.end(), name.begin(), [](char c) { return std::tolower(c); });
+	}
+
+	std::uint32_t found = 0;
+	measure("find_symbol_by_name (upper-case copy)", 100, [&] {
+		for (auto& name : names) {
+			std::string up {name};
+			std::transform(up.begin(), up.end(), up.begin(), toupper);
+			found += names_by_copy.find(up) != names_by_copy.end();
+		}
+	});
+
+	measure("DaedalusScript::find_symbol_by_name", 100, [&] {
+		for (auto& name : names) {
+			found += script.find_symbol_by_name(name) != nullptr;
+		}
+	});
+	std::cout << "(" << found << " symbols found)\n";
+
+	zenkit::DaedalusVm vm {std::move(script)};
+	zenkit::register_all_script_classes(vm);
+	vm.register_default_external([](zenkit::DaedalusSymbol const&) {});
+
+	auto* sym = vm.find_symbol_by_name(argv[2]);
+	if (sym == nullptr || sym->type() != zenkit::DaedalusDataType::FUNCTION || sym->count() != 0) {
+		std::cerr << "Function " << argv[2] << " not found or it requires parameters.\n";
+		return -1;
+	}
+
+	measure("DaedalusVm::call_function", iterations, [&] { vm.call_function(sym); });
+
+	// The same call on a VM which executes every instruction of a superinstruction separately.
+	zenkit::DaedalusScript unfused_script;
+	rd = zenkit::Read::from(argv[1]);
+	unfused_script.load(rd.get());
+
+	zenkit::DaedalusVm unfused {std::move(unfused_script), zenkit::DaedalusVmExecutionFlag::DISABLE_SUPERINSTRUCTIONS};
+	zenkit::register_all_script_classes(unfused);
+	unfused.register_default_external([](zenkit::DaedalusSymbol const&) {});
+
+	auto* unfused_sym = unfused.find_symbol_by_name(argv[2]);
+	measure("DaedalusVm::call_function (no superinstructions)", iterations, [&] { unfused.call_function(unfused_sym); });
+
+	// The same call on a VM which runs verified functions without runtime checks.
+	zenkit::DaedalusScript unverified;
+	rd = zenkit::Read::from(argv[1]);
+	unverified.load(rd.get());
+
+	zenkit::DaedalusVm unchecked {std::move(unverified), zenkit::DaedalusVmExecutionFlag::UNCHECKED};
+	zenkit::register_all_script_classes(unchecked);
+	unchecked.register_default_external([](zenkit::DaedalusSymbol const&) {});
+
+	std::size_t verified = 0;
+	for (auto& fn : unchecked.functions()) {
+		verified += unchecked.is_function_verified(unchecked.find_symbol_by_index(fn.symbol));
+	}
+	std::cout << "(" << verified << " of " << unchecked.functions().size() << " functions verified)\n";
+
+	auto* unchecked_sym = unchecked.find_symbol_by_name(argv[2]);
+	measure("DaedalusVm::call_function (unchecked)", iterations, [&] { unchecked.call_function(unchecked_sym); });
+	return 0;
+}
@@ -0,0 +1,85 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include <zenkit/DaedalusScript.hh>
+#include <zenkit/Logger.hh>
+#include <zenkit/Stream.hh>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+template <typename F>
+static double measure(std::size_t iterations, F&& fn) {
+	auto begin = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < iterations; ++i) {
+		fn();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+	return static_cast<double>(total) / static_cast<double>(iterations) / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: bench_script_load <SCRIPT.DAT>... [-n ITERATIONS]\n\n"
+		          << "Measures the time it takes to parse each of the given scripts from a file and from memory, as\n"
+		          << "well as loading all of them one after another and concurrently.\n";
+		return -1;
+	}
+
+	zenkit::Logger::set_default(zenkit::LogLevel::ERROR);
+
+	std::size_t iterations = 10;
+	std::vector<std::filesystem::path> paths;
+	for (int i = 1; i < argc; ++i) {
+		if (std::string {argv[i]} == "-n" && i + 1 < argc) {
+			iterations = std::strtoull(argv[++i], nullptr, 10);
+		} else {
+			paths.emplace_back(argv[i]);
+		}
+	}
+
+	double sequential = 0;
+	for (auto& path : paths) {
+		auto rd = zenkit::Read::from(path);
+		std::vector<std::byte> data(std::filesystem::file_size(path));
+		data.resize(rd->read(data.data(), data.size()));
+
+		auto file = measure(iterations, [&] {
+			zenkit::DaedalusScript script;
+			auto r = zenkit::Read::from(path);
+			script.load(r.get());
+		});
+
+		auto memory = measure(iterations, [&] {
+			zenkit::DaedalusScript script;
+			script.load(data);
+		});
+
+		zenkit::DaedalusScript script;
+		script.load(data);
+
+		std::cout << path.filename().string() << ": " << script.symbols().size() << " symbols, " << data.size()
+		          << " bytes, " << file << " ms from file, " << memory << " ms from memory\n";
+		sequential += file;
+	}
+
+	auto parallel = measure(iterations, [&] {
+		std::vector<std::unique_ptr<zenkit::Read>> streams;
+		std::vector<zenkit::Read*> readers;
+
+		for (auto& path : paths) {
+			readers.push_back(streams.emplace_back(zenkit::Read::from(path)).get());
+		}
+
+		(void) zenkit::DaedalusScript::load_all(readers);
+	});
+
+	std::cout << "All scripts: " << sequential << " ms one after another, " << parallel
+	          << " ms using DaedalusScript::load_all\n";
+	return 0;
+}
@@ -0,0 +1,37 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include <zenkit/DaedalusScript.hh>
+#include <zenkit/DaedalusTranslator.hh>
+#include <zenkit/Logger.hh>
+#include <zenkit/Stream.hh>
+
+#include <iostream>
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cerr << "Usage: translate_script <GOTHIC.DAT> <OUTPUT.cc> [MODULE]\n\n"
+		          << "Translates the functions of a compiled Daedalus script to C++. Compile the output into your\n"
+		          << "program and every DaedalusVm created for the same script calls the translated functions\n"
+		          << "instead of interpreting them. MODULE is the name of the generated DaedalusNativeModule\n"
+		          << "(default: DAEDALUS_NATIVE_MODULE).\n";
+		return -1;
+	}
+
+	zenkit::Logger::set_default(zenkit::LogLevel::INFO);
+
+	zenkit::DaedalusScript script;
+	auto rd = zenkit::Read::from(argv[1]);
+	script.load(rd.get());
+
+	auto wr = zenkit::Write::to(std::filesystem::path {argv[2]});
+	if (wr == nullptr) {
+		std::cerr << "Failed to open " << argv[2] << " for writing.\n";
+		return -1;
+	}
+
+	zenkit::DaedalusTranslator translator {script};
+	auto count = translator.write_source(wr.get(), argc > 3 ? argv[3] : "DAEDALUS_NATIVE_MODULE");
+
+	std::cout << "Translated " << count << " of " << script.functions().size() << " functions.\n";
+	return 0;
+}
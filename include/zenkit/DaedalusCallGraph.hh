@@ -0,0 +1,113 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "zenkit/Library.hh"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace zenkit {
+	class DaedalusScript;
+	class DaedalusSymbol;
+	class Write;
+
+	/// \brief How a function refers to another symbol.
+	enum class DaedalusCallKind : std::uint8_t {
+		CALL,      ///< A call to a script function using `BL`.
+		EXTERNAL,  ///< A call to an external using `BE`.
+		INSTANCE,  ///< An instance set as the global instance using `GMOVI`.
+		REFERENCE, ///< A function assigned to a variable using `MOVVF`, which may be called later.
+	};
+
+	/// \brief A reference from one function to another symbol.
+	struct DaedalusCallEdge {
+		std::uint32_t caller {0};  ///< The symbol index of the referring function.
+		std::uint32_t callee {0};  ///< The symbol index of the referenced function or instance.
+		std::uint32_t address {0}; ///< The address of the instruction containing the reference.
+		DaedalusCallKind kind {DaedalusCallKind::CALL};
+	};
+
+	/// \brief A function in a DaedalusCallGraph.
+	struct DaedalusCallGraphNode {
+		static constexpr auto UNBOUNDED = static_cast<std::uint32_t>(-1);
+
+		std::uint32_t symbol {0}; ///< The index of the function's symbol.
+
+		/// \brief Whether the function passed verification. Otherwise, #stack_depth only covers the instructions
+		///        visited before verification failed.
+		/// \see DaedalusScript::verify_function
+		bool verified {false};
+
+		/// \brief The maximum number of stack slots used by the function itself, including its parameters.
+		std::uint32_t stack_depth {0};
+
+		/// \brief The maximum number of nested script function calls starting with this function, including itself,
+		///        or #UNBOUNDED if it may recurse.
+		std::uint32_t max_call_depth {0};
+
+		/// \brief An upper bound of the number of stack slots used by this function and all functions it calls, or
+		///        #UNBOUNDED if it may recurse.
+		///
+		/// Assumes that each call is made with the caller's stack at its maximum depth.
+		std::uint32_t max_stack_depth {0};
+
+		std::uint32_t edges_begin {0}; ///< The index of the first outgoing edge in DaedalusCallGraph::edges.
+		std::uint32_t edges_count {0}; ///< The number of outgoing edges.
+	};
+
+	/// \brief The static call graph of a script.
+	///
+	/// Contains a node for every entry of DaedalusScript::functions, including externals, prototypes and instances,
+	/// and an edge for every `BL`, `BE` and `GMOVI` instruction reachable from the start of a function, as well as for
+	/// every function assigned to a variable. Calls made by the engine, e.g. to functions it looks up by name, are not
+	/// visible in the bytecode, so they have to be passed as roots when looking for unreachable functions.
+	class DaedalusCallGraph {
+	public:
+		ZKAPI explicit DaedalusCallGraph(DaedalusScript const& script);
+
+		/// \return All nodes, in the order of DaedalusScript::functions.
+		[[nodiscard]] std::vector<DaedalusCallGraphNode> const& nodes() const noexcept {
+			return _m_nodes;
+		}
+
+		/// \return All edges, grouped by caller in the order of #nodes.
+		[[nodiscard]] std::vector<DaedalusCallEdge> const& edges() const noexcept {
+			return _m_edges;
+		}
+
+		/// \return The node of the given function or `nullptr` if it is not a function.
+		[[nodiscard]] ZKAPI DaedalusCallGraphNode const* node(DaedalusSymbol const& sym) const noexcept;
+
+		/// \return The outgoing edges of the given node.
+		[[nodiscard]] std::span<DaedalusCallEdge const> edges(DaedalusCallGraphNode const& node) const noexcept {
+			return std::span {_m_edges}.subspan(node.edges_begin, node.edges_count);
+		}
+
+		/// \brief Finds all functions, externals and instances reachable from the given roots using any edge.
+		/// \param roots The functions and instances the engine may call directly.
+		/// \return The symbol indices of all reachable symbols, including the roots, in ascending order.
+		[[nodiscard]] ZKAPI std::vector<std::uint32_t> reachable(std::span<DaedalusSymbol const* const> roots) const;
+
+		/// \brief Finds all script functions, prototypes and instances not reachable from the given roots.
+		/// \param roots The functions and instances the engine may call directly.
+		/// \return The symbol indices of all unreachable symbols in ascending order. Externals are not included.
+		[[nodiscard]] ZKAPI std::vector<std::uint32_t> unreachable(std::span<DaedalusSymbol const* const> roots) const;
+
+		/// \brief Writes the graph as JSON.
+		///
+		/// The output is an object with a `functions` array containing one object per node with the fields of
+		/// DaedalusCallGraphNode, `name` and `external`, and an `edges` array containing one object per edge.
+		/// Unbounded depths are written as `null`. If \p roots is not empty, every function additionally contains a
+		/// `reachable` field.
+		///
+		/// \param w The stream to write to.
+		/// \param roots The functions and instances the engine may call directly.
+		ZKAPI void write_json(Write* w, std::span<DaedalusSymbol const* const> roots = {}) const;
+
+	private:
+		DaedalusScript const& _m_script;
+		std::vector<DaedalusCallGraphNode> _m_nodes;
+		std::vector<DaedalusCallEdge> _m_edges;
+	};
+} // namespace zenkit
@@ -0,0 +1,133 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "zenkit/Library.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace zenkit {
+	class DaedalusScript;
+	class DaedalusSymbol;
+	class Write;
+
+	/// \brief Aggregated profiling data of a single function.
+	///
+	/// Externals are recorded like any other function, so the time spent inside a registered external
+	/// is the #time_inclusive of its entry. Recursive calls are only counted once in the inclusive values.
+	struct DaedalusProfileEntry {
+		std::uint32_t symbol {0};                 ///< The index of the function's symbol.
+		std::uint64_t calls {0};                  ///< The number of times the function was called.
+		std::uint64_t instructions_inclusive {0}; ///< Instructions executed by the function and its callees.
+		std::uint64_t instructions_exclusive {0}; ///< Instructions executed by the function itself.
+		std::chrono::nanoseconds time_inclusive {0};
+		std::chrono::nanoseconds time_exclusive {0};
+	};
+
+	/// \brief The value reported for each stack in collapsed-stack output.
+	enum class DaedalusProfileMetric {
+		INSTRUCTIONS, ///< The number of instructions executed exclusively by the stack.
+		TIME,         ///< The wall time spent exclusively in the stack in microseconds.
+	};
+
+	/// \brief Collects per-function call statistics of a DaedalusVm.
+	///
+	/// The VM only reports to the profiler if ZenKit was built with `ZK_ENABLE_VM_PROFILER`, which defines
+	/// `_ZK_WITH_VM_PROFILER`. Otherwise, all profiling hooks are compiled out of the interpreter.
+	///
+	/// \see DaedalusVm::enable_profiler
+	class DaedalusProfiler {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		ZKAPI DaedalusProfiler();
+
+		/// \brief Records a call to the given function.
+		ZKAPI void enter(DaedalusSymbol const& sym);
+
+		/// \brief Records the return from the function most recently entered.
+		ZKAPI void leave();
+
+		/// \brief Records the return from all functions entered after the call stack had the given depth.
+		///
+		/// This is used to close the calls interrupted by a script error.
+		///
+		/// \param depth The depth to return to.
+		ZKAPI void unwind(std::size_t depth);
+
+		/// \return The number of functions entered but not yet returned from.
+		[[nodiscard]] std::size_t depth() const noexcept {
+			return _m_frames.size();
+		}
+
+		/// \brief Records the execution of a single instruction by the current function.
+		void instruction() noexcept {
+			++_m_instructions;
+		}
+
+		/// \brief Discards all data recorded so far.
+		ZKAPI void reset();
+
+		/// \brief Enables or disables recording every call individually for #write_chrome_trace.
+		///
+		/// This is disabled by default since the number of recorded events grows with every call.
+		///
+		/// \param enable `true` to record calls and `false` to only record aggregated data.
+		ZKAPI void set_trace_enabled(bool enable) noexcept;
+
+		/// \return The aggregated data of all functions called at least once.
+		[[nodiscard]] ZKAPI std::vector<DaedalusProfileEntry> entries() const;
+
+		/// \return The aggregated data of the given function or `nullptr` if it was never called.
+		[[nodiscard]] ZKAPI DaedalusProfileEntry const* entry(DaedalusSymbol const& sym) const;
+
+		/// \brief Writes the recorded call stacks in the collapsed-stack format understood by `flamegraph.pl`.
+		/// \param w The stream to write to.
+		/// \param script The script the profiled functions belong to.
+		/// \param metric The value to report for each stack.
+		ZKAPI void write_collapsed(Write* w, DaedalusScript const& script, DaedalusProfileMetric metric) const;
+
+		/// \brief Writes all recorded calls as Chrome trace event JSON (see `chrome://tracing` or Perfetto).
+		/// \param w The stream to write to.
+		/// \param script The script the profiled functions belong to.
+		/// \see #set_trace_enabled
+		ZKAPI void write_chrome_trace(Write* w, DaedalusScript const& script) const;
+
+	private:
+		struct Frame {
+			std::uint32_t symbol;
+			std::uint32_t node;
+			Clock::time_point start;
+			std::uint64_t instructions_start;
+			Clock::duration children_time;
+			std::uint64_t children_instructions;
+		};
+
+		struct Node {
+			std::uint32_t parent;
+			std::uint32_t symbol;
+			std::uint64_t instructions;
+			Clock::duration time;
+		};
+
+		struct Event {
+			std::uint32_t symbol;
+			Clock::time_point start;
+			Clock::duration duration;
+		};
+
+		std::vector<DaedalusProfileEntry> _m_entries;
+		std::vector<std::uint32_t> _m_active;
+		std::vector<Frame> _m_frames;
+		std::vector<Node> _m_nodes;
+		std::unordered_map<std::uint64_t, std::uint32_t> _m_children;
+		std::vector<Event> _m_events;
+
+		Clock::time_point _m_epoch;
+		std::uint64_t _m_instructions {0};
+		bool _m_trace {false};
+	};
+} // namespace zenkit
@@ -5,13 +5,17 @@
 #include "zenkit/Library.hh"
 #include "zenkit/Stream.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <typeinfo>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -60,6 +64,7 @@ namespace zenkit {
 		static constexpr auto MERGED = 1U << 4U;      ///< Unused.
 		static constexpr auto TRAP_ACCESS = 1U << 6U; ///< VM should call trap callback, when symbol accessed.
 		static constexpr auto FUNC_LOCALS = 1U << 7U; ///< VM should call trap callback, when symbol accessed.
+		static constexpr auto OVERRIDDEN = 1U << 8U;  ///< The VM redirects calls to the function to a C++ override.
 
 		// Deprecated entries.
 		ZKREM("renamed to DaedalusSymbolFlag::CONST") static constexpr auto const_ = CONST;
@@ -221,6 +226,19 @@ namespace zenkit {
 		///        instruction onto the stack as a reference.
 		PUSHVV = 245,
 
+		/// \brief Superinstruction for `PUSHI; PUSHV; MOVI`, which assigns an immediate value to `x`.
+		/// \note Superinstructions never appear in compiled scripts. DaedalusScript::load creates them in
+		///       the pre-decoded code by replacing the opcode of the first `PUSHI` of common instruction sequences.
+		/// \see DaedalusCompactInstruction::original_op
+		MOVI_IMM = 250,
+
+		/// \brief Superinstruction for `PUSHI; PUSHV; <comparison>; BZ`, which compares `x` to an immediate value
+		///        and jumps if the comparison is false. `PUSHVV` may be used instead of `PUSHV`.
+		BZ_CMP_IMM = 251,
+
+		/// \brief Superinstruction for `PUSHI; BE`, which calls an external with an immediate argument.
+		BE_IMM = 252,
+
 		add ZKREM("renamed to DaedalusDataType::ADD") = ADD,
 		sub ZKREM("renamed to DaedalusDataType::SUB") = SUB,
 		mul ZKREM("renamed to DaedalusDataType::MUL") = MUL,
@@ -270,7 +288,7 @@ namespace zenkit {
 	/// \brief Represents an object associated with an instance in the script.
 	///
 	/// Every class defined in C++ that can be used as an instance has to inherit from this class.
-	class ZKAPI DaedalusInstance {
+	class ZKAPI DaedalusInstance : public std::enable_shared_from_this<DaedalusInstance> {
 	public:
 		virtual ~DaedalusInstance() = default;
 
@@ -300,6 +318,7 @@ namespace zenkit {
 		friend class DaedalusSymbol;
 		friend class DaedalusScript;
 		friend class DaedalusVm;
+		friend class DaedalusMemberAccessor;
 
 		uint32_t _m_symbol_index {static_cast<uint32_t>(-1)};
 		std::type_info const* _m_type {nullptr};
@@ -605,6 +624,12 @@ namespace zenkit {
 			return (_m_flags & DaedalusSymbolFlag::RETURN) != 0;
 		}
 
+		/// \brief Tests whether calls to the function are redirected to a C++ override by the VM.
+		/// \return `true` if the function is overridden, `false` if not.
+		[[nodiscard]] ZKAPI bool has_override() const noexcept {
+			return (_m_flags & DaedalusSymbolFlag::OVERRIDDEN) != 0;
+		}
+
 		/// \brief brief Tests whether the symbol has local-variables enabled.
 		/// \return return `true` if enabled, `false` if not.
 		[[nodiscard]] ZKAPI bool has_local_variables_enabled() const noexcept {
@@ -641,6 +666,12 @@ namespace zenkit {
 			return _m_index;
 		}
 
+		/// \return The index of the symbol's entry in the function table or `-1` if it is not callable.
+		/// \see DaedalusScript::find_function_info
+		[[nodiscard]] ZKAPI std::uint32_t function_index() const noexcept {
+			return _m_function;
+		}
+
 		/// \return The return type of the symbol.
 		[[nodiscard]] ZKAPI DaedalusDataType rtype() const noexcept {
 			return _m_return_type;
@@ -705,10 +736,22 @@ namespace zenkit {
 
 	private:
 		friend class DaedalusScript;
+		friend class DaedalusVm;
+
+		template <typename R>
+		void load_from(R* r);
+
+		/// \brief Accesses the value of a non-member symbol without checking its type or the index.
+		template <typename T>
+		T* unchecked_value(std::uint16_t index) noexcept {
+			return std::get_if<std::shared_ptr<T[]>>(&_m_value)->get() + index;
+		}
+
 		std::string _m_name;
-		std::variant<std::unique_ptr<std::int32_t[]>,
-		             std::unique_ptr<float[]>,
-		             std::unique_ptr<std::string[]>,
+		// Values are reference-counted so that forks of a script can explicitly share globals.
+		std::variant<std::shared_ptr<std::int32_t[]>,
+		             std::shared_ptr<float[]>,
+		             std::shared_ptr<std::string[]>,
 		             std::shared_ptr<DaedalusInstance>>
 		    _m_value;
 
@@ -731,6 +774,11 @@ namespace zenkit {
 		DaedalusDataType _m_return_type {DaedalusDataType::VOID};
 		std::uint32_t _m_index {static_cast<uint32_t>(-1)};
 		std::type_info const* _m_registered_to {nullptr};
+
+		std::uint32_t _m_function {static_cast<uint32_t>(-1)};
+
+		/// \brief The index of the VM callback bound to this symbol (an external or a function override).
+		std::uint32_t _m_callback {static_cast<uint32_t>(-1)};
 	};
 
 	/// \brief Represents a daedalus VM instruction.
@@ -748,10 +796,261 @@ namespace zenkit {
 		ZKINT static DaedalusInstruction decode(Read* r);
 	};
 
+	/// \brief A compact, pre-decoded form of a DaedalusInstruction.
+	///
+	/// DaedalusScript decodes its whole code section into an array of these once while loading. The array has one
+	/// entry per byte of the code section, so it can be indexed by address directly. Entries which are not at the
+	/// start of an instruction have a #size of `0`.
+	///
+	/// Each entry is 8 bytes in size, so the table takes eight times as much memory as the code section itself. In
+	/// exchange, instructions are not decoded while executing them. `bench_daedalus` compares both ways of looking
+	/// up instructions.
+	struct DaedalusCompactInstruction {
+		DaedalusOpcode op {DaedalusOpcode::NOP};
+		std::uint8_t size {0};
+		std::uint8_t index {0};
+
+		/// \brief Set for `BL` instructions whose target address was resolved to a function symbol while loading.
+		///        In that case #arg contains the index of that symbol instead of the address.
+		bool resolved {false};
+
+		/// \brief The address, symbol index or immediate value of the instruction, depending on #op.
+		std::uint32_t arg {0};
+
+		/// \return The opcode of the instruction in the script. For superinstructions, this is the opcode of
+		///         the first instruction they replace, which is the only one they change.
+		[[nodiscard]] DaedalusOpcode original_op() const noexcept {
+			return op >= DaedalusOpcode::MOVI_IMM && op <= DaedalusOpcode::BE_IMM ? DaedalusOpcode::PUSHI : op;
+		}
+
+		ZKINT static DaedalusCompactInstruction from(DaedalusInstruction const& instr);
+	};
+
+	/// \brief Information about a callable symbol which is computed once while loading the script.
+	///
+	/// Functions, externals, prototypes and instances have an entry in the function table. Parameters and
+	/// local variables are stored as ranges of symbol indices.
+	struct DaedalusFunctionInfo {
+		std::uint32_t symbol {0};           ///< The index of the function's symbol.
+		std::uint32_t params_begin {0};     ///< The index of the first parameter symbol.
+		std::uint32_t params_count {0};     ///< The number of parameter symbols.
+		std::uint32_t locals_begin {0};     ///< The index of the first local variable symbol after the parameters.
+		std::uint32_t locals_count {0};     ///< The number of local variable symbols, excluding parameters.
+		std::uint32_t locals_footprint {0}; ///< The number of stack slots required to save all local variables.
+	};
+
+	/// \brief The result of statically verifying the bytecode of a function.
+	/// \see DaedalusScript::verify_function
+	struct DaedalusFunctionVerification {
+		/// \brief Whether the function passed verification.
+		bool verified {false};
+
+		/// \brief The maximum number of stack slots used by the function itself, including its parameters.
+		std::uint32_t max_stack_depth {0};
+
+		/// \brief The address of the instruction which failed verification.
+		std::uint32_t error_address {0};
+
+		/// \brief Why verification failed or an empty string if it did not.
+		std::string error;
+	};
+
+	/// \brief Case-insensitive hash function for symbol names.
+	///
+	/// Supports heterogeneous lookup, so symbols can be found using a std::string_view without creating
+	/// an upper-case copy of the name first. Only ASCII letters are folded, like std::toupper in the C locale.
+	struct DaedalusSymbolNameHash {
+		using is_transparent = std::true_type;
+
+		[[nodiscard]] std::size_t operator()(std::string_view name) const noexcept {
+			// 64-bit FNV-1a over the upper-case name.
+			std::uint64_t hash = 14695981039346656037ULL;
+			for (auto c : name) {
+				hash ^= static_cast<unsigned char>(c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c);
+				hash *= 1099511628211ULL;
+			}
+			return static_cast<std::size_t>(hash);
+		}
+	};
+
+	/// \brief Case-insensitive equality for symbol names, compatible with DaedalusSymbolNameHash.
+	struct DaedalusSymbolNameEqual {
+		using is_transparent = std::true_type;
+
+		[[nodiscard]] bool operator()(std::string_view a, std::string_view b) const noexcept {
+			if (a.size() != b.size()) return false;
+
+			for (std::size_t i = 0; i < a.size(); ++i) {
+				auto ca = a[i] >= 'a' && a[i] <= 'z' ? a[i] - ('a' - 'A') : a[i];
+				auto cb = b[i] >= 'a' && b[i] <= 'z' ? b[i] - ('a' - 'A') : b[i];
+				if (ca != cb) return false;
+			}
+
+			return true;
+		}
+	};
+
+	/// \brief The immutable parts of a loaded script.
+	///
+	/// The image is created by DaedalusScript::load and shared by all scripts created from it using
+	/// DaedalusScript::fork. It is never modified after loading, so it can be read from multiple threads.
+	struct DaedalusScriptImage {
+		std::vector<std::byte> text;
+		std::vector<DaedalusCompactInstruction> code;
+		std::vector<DaedalusFunctionInfo> functions;
+		std::unordered_map<std::string, uint32_t, DaedalusSymbolNameHash, DaedalusSymbolNameEqual> symbols_by_name;
+		std::unordered_map<std::uint32_t, uint32_t> symbols_by_address;
+		std::uint32_t symbol_count {0};
+		std::uint64_t checksum {0};
+		std::uint8_t version {0};
+	};
+
 	template <typename T>
 	concept DaedalusValue = std::same_as<T, std::string> || std::same_as<T, float> || std::same_as<T, int32_t> ||
 	    (std::is_enum_v<T> && sizeof(T) == 4);
 
+	/// \brief Validated access to a set of members of instances of a single registered class.
+	///
+	/// Accessing a member through DaedalusSymbol checks the type of the instance on every access. An accessor is
+	/// validated once when it is created using DaedalusScript::bind_members and each instance is checked once when
+	/// it is passed to #check, #gather or #scatter, so that reading or writing many members of many instances does not
+	/// repeat these checks.
+	///
+	/// \code
+	/// std::string_view const members[] = {"C_NPC.ATTRIBUTE"};
+	/// auto accessor = script.bind_members("C_NPC", members);
+	///
+	/// std::vector<std::int32_t> attributes(npcs.size() * accessor.count(0));
+	/// accessor.gather<std::int32_t>(0, npcs, attributes);
+	/// \endcode
+	class DaedalusMemberAccessor {
+	public:
+		/// \return The number of bound members.
+		[[nodiscard]] std::size_t size() const noexcept {
+			return _m_members.size();
+		}
+
+		/// \return The symbol of the bound member at the given position.
+		[[nodiscard]] DaedalusSymbol const& member(std::size_t member) const noexcept {
+			return *_m_members[member].symbol;
+		}
+
+		/// \return The number of elements of the bound member at the given position.
+		[[nodiscard]] std::uint32_t count(std::size_t member) const noexcept {
+			return _m_members[member].count;
+		}
+
+		/// \return Whether the members of the given instance may be accessed using this accessor.
+		[[nodiscard]] bool matches(DaedalusInstance const& inst) const noexcept {
+			return inst._m_type == _m_type || (inst._m_type != nullptr && *inst._m_type == *_m_type);
+		}
+
+		/// \brief Validates that the members of the given instance may be accessed using this accessor.
+		/// \throws DaedalusIllegalContextType if the instance is not of the type the class is registered to.
+		ZKAPI void check(DaedalusInstance const& inst) const;
+
+		/// \brief Retrieves the elements of a bound member of an instance without any checks.
+		///
+		/// The instance must have been validated using #check and \p T must match the type of the member.
+		///
+		/// \param inst The instance to access.
+		/// \param member The position of the member in this accessor.
+		/// \return A pointer to the first of #count elements of the member.
+		template <typename T>
+		    requires DaedalusValue<T>
+		[[nodiscard]] T* get(DaedalusInstance& inst, std::size_t member) const noexcept {
+			return reinterpret_cast<T*>(inst.data() + _m_members[member].offset);
+		}
+
+		template <typename T>
+		    requires DaedalusValue<T>
+		[[nodiscard]] T const* get(DaedalusInstance const& inst, std::size_t member) const noexcept {
+			return reinterpret_cast<T const*>(inst.data() + _m_members[member].offset);
+		}
+
+		/// \brief Copies all elements of a bound member of each of the given instances into \p out.
+		///
+		/// The elements of each instance are stored one after another, in the order of the instances. Null instances
+		/// are skipped, leaving their elements in \p out unchanged.
+		///
+		/// \param member The position of the member in this accessor.
+		/// \param instances A range of pointers to the instances to read. May contain null pointers.
+		/// \param out The values read. Must have room for #count elements per instance.
+		/// \throws DaedalusIllegalTypeAccess if \p T does not match the type of the member.
+		/// \throws DaedalusIllegalIndexAccess if \p out is too small.
+		/// \throws DaedalusIllegalContextType if any of the instances is not of the registered type.
+		template <typename T, typename Instances>
+		    requires DaedalusValue<T>
+		void gather(std::size_t member, Instances const& instances, std::span<T> out) const {
+			auto count = this->prepare(member, type_of<T>(), std::size(instances), out.size());
+			auto it = out.begin();
+
+			for (auto const& inst : instances) {
+				if (inst == nullptr) {
+					it += count;
+					continue;
+				}
+
+				if (!this->matches(*inst)) this->check(*inst);
+				it = std::copy_n(this->get<T>(std::as_const(*inst), member), count, it);
+			}
+		}
+
+		/// \brief Copies the values in \p in into a bound member of each of the given instances.
+		///
+		/// This is the inverse of #gather, so \p in contains #count elements per instance. Null instances are
+		/// skipped along with their elements in \p in.
+		///
+		/// \throws DaedalusIllegalTypeAccess if \p T does not match the type of the member.
+		/// \throws DaedalusIllegalIndexAccess if \p in is too small.
+		/// \throws DaedalusIllegalContextType if any of the instances is not of the registered type. Instances before
+		///                                    it have already been written to.
+		template <typename T, typename Instances>
+		    requires DaedalusValue<T>
+		void scatter(std::size_t member, Instances const& instances, std::span<T const> in) const {
+			auto count = this->prepare(member, type_of<T>(), std::size(instances), in.size());
+			auto it = in.begin();
+
+			for (auto const& inst : instances) {
+				if (inst != nullptr) {
+					if (!this->matches(*inst)) this->check(*inst);
+					std::copy_n(it, count, this->get<T>(*inst, member));
+				}
+
+				it += count;
+			}
+		}
+
+	private:
+		friend class DaedalusScript;
+
+		struct Member {
+			DaedalusSymbol const* symbol;
+			std::uint32_t offset;
+			std::uint32_t count;
+		};
+
+		template <typename T>
+		static constexpr DaedalusDataType type_of() noexcept {
+			if constexpr (std::same_as<T, std::string>) {
+				return DaedalusDataType::STRING;
+			} else if constexpr (std::same_as<T, float>) {
+				return DaedalusDataType::FLOAT;
+			} else {
+				return DaedalusDataType::INT;
+			}
+		}
+
+		/// \brief Validates a batched access to a member.
+		/// \return The number of elements of the member.
+		ZKAPI std::uint32_t
+		prepare(std::size_t member, DaedalusDataType type, std::size_t instances, std::size_t values) const;
+
+		DaedalusSymbol const* _m_class {nullptr};
+		std::type_info const* _m_type {nullptr};
+		std::vector<Member> _m_members;
+	};
+
 	/// \brief Represents a compiled daedalus script
 	class DaedalusScript {
 	public:
@@ -759,8 +1058,39 @@ namespace zenkit {
 		ZKAPI DaedalusScript(DaedalusScript const& copy) = delete;
 		ZKAPI DaedalusScript(DaedalusScript&& move) = default;
 
+		/// \brief Loads a compiled script from the given stream.
+		///
+		/// The remainder of the stream is read into memory at once and parsed using load(std::span<std::byte const>).
+		///
+		/// \param r The stream to read from. Positioned right after the script afterwards.
 		ZKAPI void load(Read* r);
 
+		/// \brief Loads a compiled script from a memory buffer.
+		///
+		/// The symbol table is parsed from the buffer directly, without going through a Read stream.
+		///
+		/// \param data The compiled script. Only used while loading.
+		ZKAPI void load(std::span<std::byte const> data);
+
+		/// \brief Loads multiple scripts concurrently, each on its own thread.
+		/// \param readers The streams to read the scripts from. Each stream is only used by a single thread.
+		/// \return The loaded scripts in the order of \p readers.
+		[[nodiscard]] ZKAPI static std::vector<DaedalusScript> load_all(std::span<Read* const> readers);
+
+		/// \brief Creates a new script which shares the immutable parts of this script.
+		///
+		/// The bytecode and the lookup tables are shared. Each fork receives its own copy of all symbols, including
+		/// their names and other metadata, and of all global variables, initialized with their current values in this
+		/// script. This allows running one DaedalusVm per thread without parsing the script again, but each fork still
+		/// takes about as much memory as the symbol table. Instance pointers stored in globals are copied as-is and
+		/// thus refer to the same instances. Registered members are retained, registered externals are not.
+		///
+		/// \param shared Global symbols of this script whose values should be shared with the fork instead of
+		///               being copied. Access to them must be synchronized by the caller if the scripts are used
+		///               on different threads.
+		/// \return The new script.
+		[[nodiscard]] ZKAPI DaedalusScript fork(std::span<DaedalusSymbol const* const> shared = {}) const;
+
 		/// \brief Registers a member offset
 		/// \param name The name of the member in the script
 		/// \param field The field to register
@@ -845,6 +1175,31 @@ namespace zenkit {
 		/// \return A list of function local-variable symbols.
 		[[nodiscard]] ZKAPI std::span<DaedalusSymbol> find_locals_for_function(DaedalusSymbol const* parent);
 
+		/// \brief Retrieves the load-time information about the given callable symbol.
+		/// \param sym The function, external, prototype or instance symbol to get information about.
+		/// \return The information or `nullptr` if the symbol is not callable.
+		[[nodiscard]] DaedalusFunctionInfo const* find_function_info(DaedalusSymbol const* sym) const noexcept {
+			if (sym->_m_function >= _m_image->functions.size()) return nullptr;
+			return &_m_image->functions[sym->_m_function];
+		}
+
+		/// \return All callable symbols of the script. Each symbol refers to its entry via
+		///         DaedalusSymbol::function_index.
+		[[nodiscard]] std::vector<DaedalusFunctionInfo> const& functions() const noexcept {
+			return _m_image->functions;
+		}
+
+		/// \brief Statically verifies the bytecode of the given function.
+		///
+		/// Follows every path through the function and checks that all instructions and branch targets are valid,
+		/// that referenced symbols exist and have the type expected by the instructions using them, that array
+		/// indices are in range and that calls match the signature of the callee. The stack may never underflow
+		/// and must have the same layout whenever two paths meet.
+		///
+		/// \param sym The function, prototype or instance symbol to verify.
+		/// \return The result of the verification.
+		[[nodiscard]] ZKAPI DaedalusFunctionVerification verify_function(DaedalusSymbol const* sym) const;
+
 		/// \brief Retrieves the symbol with the given \p name.
 		/// \param name The name of the symbol to get.
 		/// \return The symbol or `nullptr` if no symbol with that name was found.
@@ -862,9 +1217,28 @@ namespace zenkit {
 		/// \return The instruction.
 		[[nodiscard]] ZKAPI DaedalusInstruction instruction_at(std::uint32_t address) const;
 
+		/// \brief Retrieves the pre-decoded instruction at \p address.
+		/// \param address The address of the instruction to get.
+		/// \return The instruction or `nullptr` if \p address does not point to the start of an instruction.
+		[[nodiscard]] DaedalusCompactInstruction const* compact_instruction_at(std::uint32_t address) const noexcept {
+			if (address >= _m_code.size() || _m_code[address].size == 0) return nullptr;
+			return &_m_code[address];
+		}
+
 		/// \return The total size of the script.
 		[[nodiscard]] ZKAPI std::uint32_t size() const noexcept;
 
+		/// \brief Identifies the bytecode and symbol table of the script.
+		///
+		/// The checksum is calculated while loading the script and covers the code and the name, type, flags,
+		/// size and address of every symbol, but not the values of symbols. Code translated using
+		/// DaedalusTranslator is only used for scripts with the same checksum as the script it was translated from.
+		///
+		/// \return The checksum of the script as loaded.
+		[[nodiscard]] ZKAPI std::uint64_t checksum() const noexcept {
+			return _m_image->checksum;
+		}
+
 		/// \brief Finds the symbol the given instance is currently bound to.
 		/// \param inst The instance to get the symbol for.
 		/// \return The symbol associated with that instance or <tt>nullptr</tt> if the symbol is not associated
@@ -903,6 +1277,17 @@ namespace zenkit {
 
 		[[nodiscard]] ZKAPI std::vector<DaedalusSymbol*> find_class_members(DaedalusSymbol const& cls);
 
+		/// \brief Binds members of a registered class for validated access without per-access checks.
+		/// \param cls The name of the class.
+		/// \param members The names of the members to bind, e.g. `C_NPC.ATTRIBUTE`.
+		/// \return An accessor for the members, in the order given.
+		/// \throws DaedalusSymbolNotFound if the class or one of the members does not exist.
+		/// \throws DaedalusMemberRegistrationError if one of the symbols is not a member of the class.
+		/// \throws DaedalusUnboundMemberAccess if the class or one of the members has not been registered.
+		/// \see DaedalusMemberAccessor
+		[[nodiscard]] ZKAPI DaedalusMemberAccessor bind_members(std::string_view cls,
+		                                                        std::span<std::string_view const> members) const;
+
 		ZKAPI void register_as_opaque(std::string_view class_name) {
 			return register_as_opaque(find_symbol_by_name(class_name));
 		}
@@ -950,12 +1335,20 @@ namespace zenkit {
 
 		ZKAPI DaedalusSymbol* add_temporary_strings_symbol();
 
+		/// \brief Retrieves the symbol with the given \p index without checking whether it exists.
+		[[nodiscard]] DaedalusSymbol* unchecked_symbol(std::uint32_t index) noexcept {
+			return &_m_symbols[index];
+		}
+
 	private:
+		/// \brief Parses a compiled script from memory.
+		/// \return The number of bytes parsed.
+		ZKINT std::size_t parse(std::span<std::byte const> data);
+
 		std::vector<DaedalusSymbol> _m_symbols;
-		std::unordered_map<std::string, uint32_t> _m_symbols_by_name;
-		std::unordered_map<std::uint32_t, uint32_t> _m_symbols_by_address;
+		std::shared_ptr<DaedalusScriptImage const> _m_image {std::make_shared<DaedalusScriptImage>()};
 
-		mutable std::unique_ptr<Read> _m_text;
-		std::uint8_t _m_version {0};
+		/// \brief Cached view of `_m_image->code` which saves an indirection when fetching instructions.
+		std::span<DaedalusCompactInstruction const> _m_code;
 	};
 } // namespace zenkit
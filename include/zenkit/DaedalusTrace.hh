@@ -0,0 +1,98 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "zenkit/DaedalusScript.hh"
+#include "zenkit/Library.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace zenkit {
+	class Write;
+
+	/// \brief A single instruction recorded by a DaedalusTrace.
+	struct DaedalusTraceEntry {
+		static constexpr auto NO_FUNCTION = static_cast<std::uint32_t>(-1);
+
+		std::uint32_t pc {0};                   ///< The address of the instruction.
+		std::uint32_t function {NO_FUNCTION};   ///< The symbol index of the function executing the instruction.
+		std::uint16_t stack_depth {0};          ///< The number of values on the stack before the instruction.
+		DaedalusOpcode op {DaedalusOpcode::NOP}; ///< The opcode as executed, which may be a superinstruction.
+	};
+
+	/// \brief A fixed-size ring buffer of the most recently executed instructions of a DaedalusVm.
+	///
+	/// Recording an instruction only consists of a few relaxed stores, so the trace is cheap enough to be left
+	/// enabled in production and inspected after a script error. The ring buffer is written by the thread running
+	/// the VM only, but it may be read from any thread while the VM is running without locking. Entries overwritten
+	/// while being read are discarded, so readers never observe partially written entries. The trace itself is
+	/// owned by the VM, which destroys it in DaedalusVm::enable_trace, so enabling or disabling the trace must not
+	/// overlap with readers on other threads.
+	///
+	/// Only instructions executed by the bytecode interpreter are recorded. Optimized and translated functions, as
+	/// well as externals, do not appear in the trace.
+	///
+	/// \see DaedalusVm::enable_trace
+	class DaedalusTrace {
+	public:
+		/// \param capacity The number of entries to keep. Rounded up to the next power of two.
+		ZKAPI explicit DaedalusTrace(std::uint32_t capacity);
+
+		/// \brief Records the execution of a single instruction.
+		void record(std::uint32_t pc, DaedalusOpcode op, std::uint32_t stack_depth, std::uint32_t function) noexcept {
+			auto head = _m_head.load(std::memory_order_relaxed);
+			auto* slot = &_m_entries[(head & _m_mask) * 2];
+
+			// The second word of each slot contains the index of the entry, which readers use to detect entries
+			// overwritten while reading them. It is invalidated first, so that a torn read is never accepted.
+			slot[1].store(INVALID, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot[0].store(pc | static_cast<std::uint64_t>(function) << 32, std::memory_order_relaxed);
+			slot[1].store(static_cast<std::uint8_t>(op) | static_cast<std::uint64_t>(stack_depth & 0xFFFF) << 8 |
+			                  (head & SEQUENCE_MASK) << 24,
+			              std::memory_order_release);
+			_m_head.store(head + 1, std::memory_order_release);
+		}
+
+		/// \brief Discards all recorded entries.
+		///
+		/// Must only be called by the thread running the VM.
+		ZKAPI void reset() noexcept;
+
+		/// \return The maximum number of entries kept.
+		[[nodiscard]] std::uint32_t capacity() const noexcept {
+			return _m_mask + 1;
+		}
+
+		/// \return The total number of instructions recorded since the trace was created or reset.
+		[[nodiscard]] std::uint64_t recorded() const noexcept {
+			return _m_head.load(std::memory_order_acquire);
+		}
+
+		/// \return The entries currently kept, starting with the oldest one.
+		[[nodiscard]] ZKAPI std::vector<DaedalusTraceEntry> entries() const;
+
+		/// \brief Writes the entries currently kept as text, one instruction per line, starting with the oldest.
+		///
+		/// Each line contains the name of the function, the address and opcode of the instruction in hexadecimal
+		/// and the stack depth, separated by spaces.
+		///
+		/// \param w The stream to write to.
+		/// \param script The script the traced functions belong to.
+		/// \param limit The maximum number of entries to write. The most recent ones are written.
+		ZKAPI void write(Write* w,
+		                 DaedalusScript const& script,
+		                 std::uint32_t limit = std::numeric_limits<std::uint32_t>::max()) const;
+
+	private:
+		static constexpr std::uint64_t INVALID = static_cast<std::uint64_t>(-1);
+		static constexpr std::uint64_t SEQUENCE_MASK = (std::uint64_t {1} << 40) - 1;
+
+		std::unique_ptr<std::atomic<std::uint64_t>[]> _m_entries;
+		std::atomic<std::uint64_t> _m_head {0};
+		std::uint32_t _m_mask {0};
+	};
+} // namespace zenkit
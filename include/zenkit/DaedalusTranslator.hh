@@ -0,0 +1,47 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "zenkit/Library.hh"
+
+#include <cstdint>
+#include <string_view>
+
+namespace zenkit {
+	class DaedalusScript;
+	class DaedalusSymbol;
+	class Write;
+
+	/// \brief Translates the bytecode of a script to C++ source code ahead of time.
+	///
+	/// Each script function is translated to a C++ function which manipulates the stack and the symbols of the
+	/// DaedalusVm executing it the same way the interpreter would, but without decoding and dispatching
+	/// instructions. The emitted source contains a DaedalusNativeModule holding all translated functions, which is
+	/// registered with register_native_module when the program starts. VMs whose script has the same checksum as
+	/// the translated script call the translated functions instead of interpreting them. All other scripts, like
+	/// modified or modded ones, are still interpreted.
+	///
+	/// \see DaedalusVm::load_native_module
+	class DaedalusTranslator {
+	public:
+		/// \param script The script to translate. It must outlive the translator.
+		ZKAPI explicit DaedalusTranslator(DaedalusScript const& script);
+
+		/// \brief Tests whether the given function can be translated.
+		///
+		/// Functions can not be translated if they contain invalid instructions or branches, calls to unknown
+		/// addresses or if their code runs past the end of the script.
+		///
+		/// \param sym The function, prototype or instance symbol to test.
+		/// \return `true` if the function can be translated, `false` if it has to be interpreted.
+		[[nodiscard]] ZKAPI bool can_translate(DaedalusSymbol const& sym) const;
+
+		/// \brief Writes the C++ source of all translatable functions of the script.
+		/// \param w The stream to write to.
+		/// \param module The name of the DaedalusNativeModule variable to define in the source.
+		/// \return The number of translated functions.
+		ZKAPI std::uint32_t write_source(Write* w, std::string_view module) const;
+
+	private:
+		DaedalusScript const& _m_script;
+	};
+} // namespace zenkit
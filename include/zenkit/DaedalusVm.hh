@@ -1,14 +1,19 @@
 // Copyright © 2021-2023 GothicKit Contributors.
 // SPDX-License-Identifier: MIT
 #pragma once
+#include "zenkit/DaedalusProfiler.hh"
+#include "zenkit/DaedalusTrace.hh"
 #include "zenkit/DaedalusScript.hh"
 #include "zenkit/Library.hh"
 
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <optional>
+#include <span>
 #include <stack>
 #include <string>
 #include <unordered_map>
@@ -69,19 +74,60 @@ namespace zenkit {
 	};
 
 	/// \brief A stack frame in the VM.
-	struct DaedalusStackFrame {
+	/// \deprecated The VM now uses DaedalusStackSlot internally.
+	struct ZKREM("the VM now uses DaedalusStackSlot internally") DaedalusStackFrame {
 		std::shared_ptr<DaedalusInstance> context;
 		bool reference;
 		std::variant<int32_t, float, DaedalusSymbol*, std::shared_ptr<DaedalusInstance>> value;
 		uint16_t index {0};
 	};
 
+	/// \brief A value on the operand stack of the VM.
+	///
+	/// Stack slots are trivially copyable and only 16 bytes in size. Instances are stored as plain pointers, so pushing
+	/// and popping them never touches their reference count. The VM makes sure that they are kept alive while on the
+	/// stack and only creates a new `std::shared_ptr` once a value is handed out to C++ code.
+	struct DaedalusStackSlot {
+		enum class Type : std::uint8_t {
+			INT,
+			FLOAT,
+			INSTANCE,
+			REFERENCE,
+		};
+
+		union {
+			std::int32_t i;
+			float f;
+
+			/// \brief The index of the referenced symbol if #type is Type::REFERENCE.
+			std::uint32_t symbol;
+		};
+
+		Type type;
+
+		/// \brief The array index into the referenced symbol if #type is Type::REFERENCE.
+		std::uint16_t index;
+
+		/// \brief The instance if #type is Type::INSTANCE or the context instance if #type is Type::REFERENCE.
+		DaedalusInstance* instance;
+	};
+
+	static_assert(sizeof(DaedalusStackSlot) <= 16);
+
 	/// \brief A call stack frame in the VM.
 	struct DaedalusCallStackFrame {
 		DaedalusSymbol const* function;
 		std::uint32_t program_counter;
 		std::uint32_t stack_ptr;
 		std::shared_ptr<DaedalusInstance> context;
+
+		/// \brief Whether the function runs with runtime checks even though it was verified, because its stack
+		///        can not be trusted anymore. See DaedalusVmExecutionFlag::UNCHECKED.
+		bool checked {false};
+
+		/// \brief The number of temporary strings in use when the function was called. Strings allocated after
+		///        that are released whenever the function has nothing left on the stack.
+		std::uint32_t temporary_strings {0};
 	};
 
 	namespace DaedalusVmExecutionFlag {
@@ -89,6 +135,35 @@ namespace zenkit {
 		static constexpr std::uint8_t ALLOW_NULL_INSTANCE_ACCESS = 1 << 1;
 		static constexpr std::uint8_t IGNORE_CONST_SPECIFIER = 1 << 2;
 
+		/// \brief Verifies all functions when creating the VM and runs the ones which pass verification without
+		///        most runtime checks. If an external does not honor its declared signature or an instruction fails
+		///        and the exception handler decides to continue, the rest of the function runs with checks again.
+		/// \see DaedalusScript::verify_function
+		static constexpr std::uint8_t UNCHECKED = 1 << 3;
+
+		/// \brief Executes superinstructions like the instruction sequences they replace. Useful for debugging.
+		/// \see DaedalusOpcode::MOVI_IMM
+		static constexpr std::uint8_t DISABLE_SUPERINSTRUCTIONS = 1 << 4;
+
+		/// \brief Does not use translated functions registered using register_native_module.
+		/// \see DaedalusVm::load_native_module
+		static constexpr std::uint8_t DISABLE_NATIVE = 1 << 5;
+
+		/// \brief Lowers all functions to a register-based representation when creating the VM and executes them
+		///        using a matching interpreter.
+		///
+		/// While lowering, arithmetic on constants is folded, reads of local variables are replaced by the value
+		/// assigned to them and branches on constant conditions are removed. Values of `const` symbols are folded
+		/// unless #IGNORE_CONST_SPECIFIER is set, so changing them after creating the VM has no effect on
+		/// optimized functions. Whenever an instruction fails, execution continues in the bytecode interpreter, so
+		/// errors are handled exactly like in unoptimized code.
+		///
+		/// Optimized functions are only used while no access trap is registered and not by time-sliced calls.
+		/// They are not taken into account by the profiler's instruction counts.
+		///
+		/// \see DaedalusVm::is_function_optimized
+		static constexpr std::uint8_t OPTIMIZE = 1 << 6;
+
 		// Deprecated entries.
 		ZKREM("renamed to DaedalusVmExecutionFlag::NONE") static constexpr std::uint8_t none = NONE;
 
@@ -99,6 +174,53 @@ namespace zenkit {
 		static constexpr std::uint8_t vm_ignore_const_specifier = IGNORE_CONST_SPECIFIER;
 	} // namespace DaedalusVmExecutionFlag
 
+	/// \brief The outcome of a time-sliced function call.
+	/// \see DaedalusVm::start_call
+	enum class DaedalusVmExecutionResult : std::uint8_t {
+		FINISHED,  ///< The function returned. Its return value, if any, is on the stack.
+		SUSPENDED, ///< Execution was suspended and can be continued using DaedalusVm::resume.
+	};
+
+	/// \brief Limits the amount of work done by a single time slice.
+	/// \see DaedalusVm::start_call
+	struct DaedalusVmBudget {
+		/// \brief The maximum number of instructions to execute.
+		std::uint64_t instructions {std::numeric_limits<std::uint64_t>::max()};
+
+		/// \brief The maximum wall time to spend. It is checked at least every 1024 instructions.
+		std::chrono::microseconds time {std::chrono::microseconds::max()};
+	};
+
+	class DaedalusVm;
+	struct DaedalusIrFunction;
+
+	/// \brief A script function translated to C++ by DaedalusTranslator.
+	using DaedalusNativeFunction = void (*)(DaedalusVm& vm);
+
+	/// \brief Associates a translated function with the symbol of the script function it was translated from.
+	struct DaedalusNativeFunctionEntry {
+		std::uint32_t symbol;            ///< The index of the function's symbol.
+		DaedalusNativeFunction function; ///< The translated function.
+	};
+
+	/// \brief The registration table of a set of translated functions, as emitted by DaedalusTranslator.
+	struct DaedalusNativeModule {
+		/// \brief The DaedalusScript::checksum of the script the functions were translated from.
+		std::uint64_t checksum;
+
+		/// \brief The translated functions.
+		std::span<DaedalusNativeFunctionEntry const> functions;
+	};
+
+	/// \brief Makes translated functions available to all VMs created afterwards.
+	///
+	/// Sources emitted by DaedalusTranslator call this from a static initializer, so linking them into a program
+	/// is enough for them to be used. A VM only uses the module if its script has a matching checksum.
+	///
+	/// \param module The module to register. It must remain valid until the program exits.
+	/// \see DaedalusVm::load_native_module
+	ZKAPI void register_native_module(DaedalusNativeModule const& module);
+
 	class DaedalusVm : public DaedalusScript {
 	public:
 		static constexpr auto stack_size = 2048;
@@ -214,6 +336,15 @@ namespace zenkit {
 			// Perform initial instance setup
 			this->allocate_instance(instance, sym);
 
+			if constexpr (std::is_copy_assignable_v<_instance_t>) {
+				if (auto const* cached = cached_instance(sym, typeid(_instance_t)); cached != nullptr) {
+					auto* user_ptr = instance->user_ptr;
+					*instance = static_cast<_instance_t const&>(*cached);
+					instance->user_ptr = user_ptr;
+					return;
+				}
+			}
+
 			// set the proper instances
 			auto old_instance = _m_instance;
 			auto old_self_instance = _m_self_sym != nullptr ? _m_self_sym->get_instance() : nullptr;
@@ -221,15 +352,84 @@ namespace zenkit {
 
 			if (_m_self_sym) _m_self_sym->set_instance(_m_instance);
 
+			auto external_calls = _m_external_calls;
 			unsafe_call(sym);
 
 			// reset the VM state
 			_m_instance = old_instance;
 			if (_m_self_sym) _m_self_sym->set_instance(old_self_instance);
+
+			if constexpr (std::is_copy_assignable_v<_instance_t>) {
+				if (_m_instance_cache_enabled && !_m_instance_cache.contains(sym->index())) {
+					if (_m_external_calls != external_calls || accesses_globals(sym)) {
+						mark_instance_impure(sym);
+					} else {
+						cache_instance(sym, std::make_shared<_instance_t const>(*instance));
+					}
+				}
+			}
 		}
 
 		std::shared_ptr<DaedalusInstance> init_opaque_instance(DaedalusSymbol* sym);
 
+		/// \brief Enables or disables caching the results of instance functions.
+		///
+		/// While enabled, the state of an instance is remembered after its instance function, including the
+		/// prototypes it calls, has run for the first time. Later calls to #init_instance for the same symbol copy
+		/// the remembered state instead of running the function again. Disabling the cache drops all remembered
+		/// instances.
+		///
+		/// This is only correct for instance functions which do nothing but set members of the instance depending
+		/// on constants. Instances are marked impure automatically if their function calls an external or an
+		/// overridden function while being initialized, or if it or any script function it may call reads or
+		/// writes a variable other than a constant, a member, its own parameters and locals, or the instance being
+		/// initialized. Other side effects must be marked using #mark_instance_impure. Instance types which are not
+		/// copy-assignable, like instances created by #init_opaque_instance, are never cached. Registering an
+		/// external or overriding a function drops all cached instances.
+		///
+		/// A cache hit copy-assigns the whole remembered `_instance_t` to the instance, which overwrites all of its
+		/// members, including those added by the engine which are not registered with the script, as well as the
+		/// symbol index and type stored in DaedalusInstance. Only DaedalusInstance::user_ptr is kept.
+		///
+		/// \param enable `true` to enable the cache and `false` to disable it.
+		ZKAPI void set_instance_cache_enable(bool enable);
+
+		/// \brief Always runs the instance function of the given instance, even if the instance cache is enabled.
+		/// \param sym The instance symbol.
+		ZKAPI void mark_instance_impure(DaedalusSymbol const* sym);
+
+		/// \return Whether #init_instance copies a cached instance for the given symbol instead of running its
+		///         instance function.
+		[[nodiscard]] ZKAPI bool is_instance_cached(DaedalusSymbol const* sym) const;
+
+		/// \brief Drops all cached instances, for example after global variables read by instance functions
+		///        have changed. Instances marked impure remain impure.
+		ZKAPI void clear_instance_cache();
+
+		/// \brief Writes the state of all global variables and instances to a binary snapshot.
+		///
+		/// The snapshot contains the values of all mutable integer, float, string and function variables, including
+		/// constants if DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER is set. For each instance symbol, it
+		/// contains the instance it refers to and, if that instance was initialized for the symbol itself, the
+		/// values of all registered members of the instance. Values are stored in a compact binary form keyed by
+		/// symbol index, so the snapshot can only be loaded into a VM for the same script.
+		///
+		/// \param w The stream to write the snapshot to.
+		/// \see #load_snapshot
+		ZKAPI void save_snapshot(Write* w) const;
+
+		/// \brief Restores the state saved using #save_snapshot.
+		///
+		/// Instances are not created by restoring a snapshot. Member values are restored into the instance which is
+		/// currently bound to the symbol they were saved for, if that instance was initialized for the symbol, and
+		/// references to instances are restored to the instance currently bound to the referenced symbol. The
+		/// whole snapshot is read and validated before anything is restored, so the VM is left unchanged if loading
+		/// fails.
+		///
+		/// \param r The stream to read the snapshot from.
+		/// \throws DaedalusVmException if the snapshot is invalid or was taken from a VM for a different script.
+		ZKAPI void load_snapshot(Read* r);
+
 		/// \brief Allocates an instance with the given type and name and returns it.
 		///
 		/// In contrast to #init_instance, this function will only create an instance of _instance_t and assign
@@ -320,14 +520,14 @@ namespace zenkit {
 		ZKAPI void push_int(std::int32_t value);
 		ZKAPI void push_float(float value);
 		ZKAPI void push_instance(std::shared_ptr<DaedalusInstance> value);
-		ZKAPI void push_reference(DaedalusSymbol* value, std::uint8_t index = 0);
+		ZKAPI void push_reference(DaedalusSymbol* value, std::uint16_t index = 0);
 		ZKAPI void push_string(std::string_view value);
 
 		[[nodiscard]] ZKAPI std::int32_t pop_int();
 		[[nodiscard]] ZKAPI float pop_float();
 		[[nodiscard]] ZKAPI std::shared_ptr<DaedalusInstance> pop_instance();
 		[[nodiscard]] ZKAPI std::string const& pop_string();
-		[[nodiscard]] ZKAPI std::tuple<DaedalusSymbol*, std::uint8_t, std::shared_ptr<DaedalusInstance>>
+		[[nodiscard]] ZKAPI std::tuple<DaedalusSymbol*, std::uint16_t, std::shared_ptr<DaedalusInstance>>
 		pop_reference();
 		[[nodiscard]] ZKAPI bool top_is_reference() const;
 
@@ -455,7 +655,7 @@ namespace zenkit {
 			}
 
 			// *evil template hacking ensues*
-			_m_externals[sym] = [callback](DaedalusVm& machine) {
+			bind_callback(sym, [callback](DaedalusVm& machine) {
 				if constexpr (std::same_as<void, R>) {
 					if constexpr (sizeof...(P) > 0) {
 						auto v = machine.pop_values_for_external<P...>();
@@ -470,7 +670,7 @@ namespace zenkit {
 						machine.push_value_from_external(callback());
 					}
 				}
-			};
+			});
 		}
 
 		/// \brief Registers an external function.
@@ -542,7 +742,7 @@ namespace zenkit {
 			}
 
 			// *evil template hacking ensues*
-			_m_function_overrides[sym->address()] = [callback, sym](DaedalusVm& machine) {
+			bind_callback(sym, [callback, sym](DaedalusVm& machine) {
 				machine.push_call(sym);
 				if constexpr (std::same_as<void, R>) {
 					if constexpr (sizeof...(P) > 0) {
@@ -559,7 +759,8 @@ namespace zenkit {
 					}
 				}
 				machine.pop_call();
-			};
+			});
+			sym->_m_flags |= DaedalusSymbolFlag::OVERRIDDEN;
 		}
 
 		/// \brief Overrides a function in Daedalus code with an external naked call.
@@ -574,7 +775,8 @@ namespace zenkit {
 			if (sym == nullptr) throw DaedalusSymbolNotFound {std::string {name}};
 			if (sym->is_external()) throw DaedalusVmException {"symbol " + sym->name() + " is already an external"};
 
-			_m_function_overrides[sym->address()] = [callback](DaedalusVm& machine) { callback(machine); };
+			bind_callback(sym, [callback](DaedalusVm& machine) { callback(machine); });
+			sym->_m_flags |= DaedalusSymbolFlag::OVERRIDDEN;
 		}
 
 		/// \brief Overrides a function in Daedalus code with an external definition.
@@ -638,6 +840,39 @@ namespace zenkit {
 		///
 		/// \param sym The symbol to unsafe_call.
 		ZKAPI void unsafe_call(DaedalusSymbol const* sym);
+
+		/// \brief Calls the given symbol as a function, suspending execution once the given budget is exhausted.
+		///
+		/// Works like #unsafe_call, except that execution stops as soon as the budget is used up or an external
+		/// calls #request_suspend. The program counter, call stack and stack are retained while suspended and
+		/// execution can be continued using #resume. Other functions may be called while a call is suspended.
+		///
+		/// Arguments must be pushed onto the stack before starting the call. Once the call has finished, its return
+		/// value, if any, is left on the stack.
+		///
+		/// \param sym The function to call.
+		/// \param budget The amount of work to do before suspending.
+		/// \return Whether the function returned or execution was suspended.
+		/// \throws DaedalusVmException if another call is currently suspended.
+		ZKAPI DaedalusVmExecutionResult start_call(DaedalusSymbol const* sym, DaedalusVmBudget const& budget);
+
+		/// \brief Continues executing a call suspended by #start_call.
+		/// \param budget The amount of work to do before suspending again.
+		/// \return Whether the function returned or execution was suspended again.
+		/// \throws DaedalusVmException if no call is suspended.
+		ZKAPI DaedalusVmExecutionResult resume(DaedalusVmBudget const& budget);
+
+		/// \brief Requests suspending the current time-sliced call as soon as control returns to it.
+		///
+		/// This is intended to be called from externals which start asynchronous operations. The request is
+		/// ignored by calls which have not been started using #start_call or #resume.
+		ZKAPI void request_suspend() noexcept;
+
+		/// \return Whether a call started by #start_call is currently suspended.
+		[[nodiscard]] ZKAPI bool is_suspended() const noexcept {
+			return _m_suspended;
+		}
+
 		ZKAPI void unsafe_jump(uint32_t address);
 		ZKAPI std::shared_ptr<DaedalusInstance> unsafe_get_gi();
 		ZKAPI void unsafe_set_gi(std::shared_ptr<DaedalusInstance> i);
@@ -670,6 +905,92 @@ namespace zenkit {
 		/// \brief Prints the contents of the function call stack and the VMs stack to stderr.
 		ZKAPI void print_stack_trace() const;
 
+		/// \brief Enables or disables profiling of script function calls.
+		///
+		/// Enabling the profiler discards any previously recorded data. Calls are only recorded if ZenKit was built
+		/// with `ZK_ENABLE_VM_PROFILER`, otherwise the profiler remains empty.
+		///
+		/// \param enable `true` to enable profiling, `false` to disable it.
+		/// \see DaedalusProfiler
+		ZKAPI void enable_profiler(bool enable);
+
+		/// \return The profiler of this VM or `nullptr` if profiling is not enabled.
+		[[nodiscard]] ZKAPI DaedalusProfiler* profiler() const noexcept {
+			return _m_profiler.get();
+		}
+
+		/// \brief Enables or disables recording the most recently executed instructions.
+		///
+		/// Enabling the trace discards any previously recorded instructions. The most recent entries of the trace are
+		/// printed along with the stack trace whenever a script error is not handled.
+		///
+		/// Calling this function destroys the current trace, so it must not overlap with other threads reading it.
+		/// Pointers returned by #trace are invalidated.
+		///
+		/// \param capacity The number of instructions to keep, or `0` to disable the trace.
+		/// \see DaedalusTrace
+		ZKAPI void enable_trace(std::uint32_t capacity);
+
+		/// \return The instruction trace of this VM or `nullptr` if tracing is not enabled. Valid until the next
+		///         call to #enable_trace.
+		[[nodiscard]] ZKAPI DaedalusTrace* trace() const noexcept {
+			return _m_trace.get();
+		}
+
+		/// \return Whether the given function passed verification and runs without runtime checks.
+		/// \see DaedalusVmExecutionFlag::UNCHECKED
+		[[nodiscard]] ZKAPI bool is_function_verified(DaedalusSymbol const* sym) const noexcept {
+			return sym->function_index() < _m_function_verified.size() && _m_function_verified[sym->function_index()];
+		}
+
+		/// \return Whether the given function is executed by the interpreter for optimized functions.
+		/// \see DaedalusVmExecutionFlag::OPTIMIZE
+		[[nodiscard]] ZKAPI bool is_function_optimized(DaedalusSymbol const* sym) const noexcept {
+			return sym->function_index() < _m_ir.size() && _m_ir[sym->function_index()] != nullptr;
+		}
+
+		/// \brief Executes the functions in the given module natively instead of interpreting them.
+		///
+		/// Translated functions are called instead of interpreting the script function whenever a script function is
+		/// called, unless it is overridden. Errors are passed to the exception handler just like in interpreted code.
+		/// Translated functions can not be suspended, so time-sliced calls only suspend in interpreted code, and they
+		/// are not taken into account by execution budgets or the profiler's instruction counts.
+		///
+		/// VMs automatically load the first module passed to register_native_module which matches their script
+		/// unless DaedalusVmExecutionFlag::DISABLE_NATIVE is set.
+		///
+		/// \param module The translated functions.
+		/// \return `true` if the module was loaded and `false` if it was translated from a different script.
+		ZKAPI bool load_native_module(DaedalusNativeModule const& module);
+
+		/// \return Whether calls to the given function execute a translated function.
+		[[nodiscard]] ZKAPI bool has_native_function(DaedalusSymbol const* sym) const noexcept {
+			return native_function(sym) != nullptr;
+		}
+
+		// Primitives used by functions translated using DaedalusTranslator. Each of them executes the instruction
+		// of the same name just like the interpreter does.
+		ZKAPI void native_pushv(std::uint32_t symbol);
+		ZKAPI void native_pushvv(std::uint32_t symbol, std::uint8_t index);
+		ZKAPI void native_movi();
+		ZKAPI void native_movf();
+		ZKAPI void native_movs();
+		ZKAPI void native_movvi();
+		ZKAPI void native_addmovi();
+		ZKAPI void native_submovi();
+		ZKAPI void native_mulmovi();
+		ZKAPI void native_divmovi();
+		ZKAPI void native_gmovi(std::uint32_t symbol);
+		ZKAPI void native_bl(std::uint32_t symbol);
+		ZKAPI void native_be(std::uint32_t symbol);
+
+		/// \brief Passes an error raised by a translated function to the exception handler.
+		/// \param err The error.
+		/// \param pc The address of the instruction which failed. Set to the address to continue at.
+		/// \return `true` if the function should continue at \p pc and `false` if it should return.
+		/// \throws DaedalusScriptError if there is no exception handler or it decided to fail.
+		ZKAPI bool native_handle_error(DaedalusScriptError const& err, std::uint32_t& pc);
+
 		/// \return The current program counter (or instruction index) the VM is at.
 		[[nodiscard]] ZKAPI uint32_t pc() const noexcept {
 			return _m_pc;
@@ -696,9 +1017,113 @@ namespace zenkit {
 		                      std::string_view value);
 
 	protected:
-		/// \brief Runs the instruction at the current program counter and advances it properly.
-		/// \return false, the instruction executed was a op_return instruction, otherwise true.
-		ZKINT bool exec();
+		/// \brief Runs instructions starting at the current program counter until the current function returns.
+		///
+		/// Functions called from script code are executed by the same loop, so \p base is the size of the
+		/// call stack at which a return leaves the loop.
+		///
+		/// \param base The call stack size of the function being run.
+		/// \param budget Limits for time-sliced execution or `nullptr` to run to completion.
+		/// \return `true` if the function returned and `false` if execution was suspended.
+		ZKINT bool run(std::size_t base, DaedalusVmBudget const* budget);
+
+		/// \brief Runs the lowered code of the function in the topmost call stack frame.
+		/// \return `true` if the function returned and `false` if it has to be continued at the current program
+		///         counter by the bytecode interpreter.
+		/// \see DaedalusVmExecutionFlag::OPTIMIZE
+		ZKINT bool run_optimized(DaedalusIrFunction const& fn);
+
+		/// \brief Pops the current call stack frame and continues after the instruction which called it.
+		ZKINT void return_to_caller();
+
+		/// \brief Calls the given script function, executing its translated function if there is one.
+		ZKINT void invoke_function(DaedalusSymbol const* sym);
+
+		/// \brief Calls the given translated function in a new call stack frame.
+		ZKINT void invoke_native(DaedalusSymbol const* sym, DaedalusNativeFunction native);
+
+		/// \brief Calls the given function in a new call stack frame, executing its lowered code.
+		ZKINT void invoke_optimized(DaedalusSymbol const* sym, DaedalusIrFunction const& fn);
+
+		/// \brief Calls the given external, making sure its return value is on the stack even if it fails.
+		ZKINT void invoke_external(DaedalusSymbol* sym);
+
+		/// \brief Executes `ADDMOVI`, `SUBMOVI`, `MULMOVI` or `DIVMOVI` for translated functions.
+		ZKINT void native_update_int(DaedalusOpcode op);
+
+		/// \brief Executes `ADDMOVI`, `SUBMOVI`, `MULMOVI` or `DIVMOVI` with the given operands.
+		ZKINT void unsafe_update_int(DaedalusOpcode op,
+		                             DaedalusInstance* context,
+		                             DaedalusSymbol* ref,
+		                             std::uint16_t index,
+		                             std::int32_t value);
+
+		/// \return The translated function to execute for the given function or `nullptr` if it is interpreted.
+		[[nodiscard]] DaedalusNativeFunction native_function(DaedalusSymbol const* sym) const noexcept {
+			auto index = sym->function_index();
+			return index < _m_native.size() ? _m_native[index] : nullptr;
+		}
+
+		/// \return The lowered code to execute for the given function or `nullptr` if it is interpreted.
+		[[nodiscard]] DaedalusIrFunction const* optimized_function(DaedalusSymbol const* sym) const noexcept {
+			auto index = sym->function_index();
+			return index < _m_ir.size() && !_m_access_trap ? _m_ir[index].get() : nullptr;
+		}
+
+		/// \brief Pops a reference from the stack without taking ownership of its context instance.
+		/// \return The referenced symbol, the array index and the context instance.
+		ZKINT std::tuple<DaedalusSymbol*, std::uint16_t, DaedalusInstance*> unsafe_pop_reference();
+
+		/// \brief Keeps the given instance alive until it is popped or the VM returns from its outermost call.
+		///
+		/// Since stack slots do not own their instances, this is used whenever the VM might drop the last
+		/// reference to an instance which could still be referenced from the stack. Each instance is pinned once.
+		ZKINT void pin_instance(std::shared_ptr<DaedalusInstance> instance);
+
+		/// \brief Releases the pin of the given instance, unless it is still referenced from the stack.
+		ZKINT void unpin_instance(DaedalusInstance* instance);
+
+		/// \brief Finds the owner of an instance referenced from the stack to hand it out to C++ code.
+		/// \throws DaedalusVmException if the instance is not owned by a std::shared_ptr known to the VM.
+		[[nodiscard]] ZKINT std::shared_ptr<DaedalusInstance> share_instance(DaedalusInstance* instance) const;
+
+		ZKINT std::int32_t unsafe_get_int(DaedalusInstance* context, DaedalusSymbol* ref, std::uint16_t index) const;
+		ZKINT float unsafe_get_float(DaedalusInstance* context, DaedalusSymbol* ref, std::uint16_t index) const;
+		ZKINT void unsafe_set_int(DaedalusInstance* context, DaedalusSymbol* ref, std::uint16_t index, std::int32_t value);
+		ZKINT void unsafe_set_float(DaedalusInstance* context, DaedalusSymbol* ref, std::uint16_t index, float value);
+		ZKINT void
+		unsafe_set_string(DaedalusInstance* context, DaedalusSymbol* ref, std::uint16_t index, std::string_view value);
+
+		/// \brief Pops an integer pushed by a verified function, skipping the checks done by #pop_int.
+		ZKINT std::int32_t pop_int_verified();
+
+		/// \brief Pops a float pushed by a verified function, skipping the checks done by #pop_float.
+		ZKINT float pop_float_verified();
+
+		/// \brief Pops an integer or float reference pushed by a verified function.
+		ZKINT std::tuple<DaedalusSymbol*, std::uint16_t, DaedalusInstance*> pop_reference_verified();
+
+		/// \brief Tests whether an external or override left the stack the way DaedalusScript::verify_function
+		///        expects, so that verified code can keep running without checks after calling it.
+		/// \param sym The external or overridden function which was called.
+		/// \param stack_ptr The stack pointer before the call.
+		[[nodiscard]] ZKINT bool honors_signature(DaedalusSymbol const* sym, std::uint32_t stack_ptr) const noexcept;
+
+		/// \brief Resolves the variable pushed by the given instruction for use by a superinstruction.
+		/// \param push The `PUSHV` or `PUSHVV` instruction.
+		/// \param assign Whether the variable is going to be assigned to.
+		/// \return The integer storage of the variable or `nullptr` if the sequence replaced by the
+		///         superinstruction has to be executed instead, because it could fail or trigger an access trap.
+		ZKINT std::int32_t* superinstruction_operand(DaedalusCompactInstruction const& push, bool assign);
+
+		/// \brief Binds a callback to the given symbol, replacing any callback previously bound to it.
+		///
+		/// Callbacks live in a flat table and each symbol stores the index of its entry, so dispatching
+		/// externals and function overrides does not require a hash lookup.
+		///
+		/// \param sym The external or overridden function to bind the callback to.
+		/// \param callback The callback to invoke instead of the function.
+		ZKAPI void bind_callback(DaedalusSymbol* sym, std::function<void(DaedalusVm&)> callback);
 
 		/// \brief Validates the given address and jumps to it (sets the program counter).
 		/// \param address The address to jump to.
@@ -718,6 +1143,20 @@ namespace zenkit {
 		/// call stack entry refers to was called.
 		ZKINT void pop_call();
 
+		/// \brief Removes the topmost call stack frame without fixing up the stack.
+		///
+		/// Part of #pop_call implementation
+		ZKINT void discard_call();
+
+		/// \brief Pops the call stack frames left behind by a script error.
+		///
+		/// Frames above \p call_stack_size are popped as if their functions returned, the stack pointer is reset
+		/// and temporaries are released if no function is running anymore.
+		///
+		/// \param call_stack_size The size of the call stack before the failed call.
+		/// \param stack_ptr The stack pointer to restore.
+		ZKINT void unwind_call_stack(std::size_t call_stack_size, std::uint32_t stack_ptr) noexcept;
+
 		/// \brief Pushes a function local variables onto the call stack.
 		///
 		/// Part of #push_call implementation
@@ -990,19 +1429,55 @@ namespace zenkit {
 			}
 		}
 
-		/// \brief Mark the temporary string at the given index as free.
-		void mark_free_string(uint32_t index);
+		/// \return The cached instance for the given symbol, or `nullptr` if there is none or the cache is disabled.
+		[[nodiscard]] ZKAPI DaedalusInstance const* cached_instance(DaedalusSymbol const* sym,
+		                                                           std::type_info const& type) const;
+		ZKAPI void cache_instance(DaedalusSymbol const* sym, std::shared_ptr<DaedalusInstance const> instance);
 
-		/// \brief Obtain a random free temporary string index.
-		uint32_t get_free_string();
+		/// \return Whether the instance function of \p sym or a script function it may call accesses a variable
+		///         which makes the instance impure.
+		/// \see set_instance_cache_enable
+		[[nodiscard]] ZKAPI bool accesses_globals(DaedalusSymbol const* sym) const;
+
+		/// \brief Allocates a temporary string for #push_string.
+		///
+		/// Temporary strings are allocated by bumping a counter. They keep their capacity when released, so pushing
+		/// strings does not allocate memory once the VM has warmed up. Strings pushed while a script function runs
+		/// are released by #release_statement_temporaries as soon as the function has nothing left on the stack,
+		/// which is after each statement, and all others are released by #release_temporaries. References to
+		/// popped strings thus stay valid until the external which popped them returns or, outside of script
+		/// functions, until the next call.
+		///
+		/// \return The index of the string in the temporary strings symbol.
+		ZKINT std::uint16_t allocate_temporary_string();
+
+		/// \brief Releases the temporary strings allocated by the current script function if it has nothing left
+		///        on the stack. Called after instructions which consume strings, like `MOVS` and `BE`.
+		ZKINT void release_statement_temporaries() noexcept;
+
+		/// \brief Releases pinned instances and temporary strings not referenced from the stack anymore. Only
+		///        called while no function is running.
+		ZKINT void release_temporaries();
+
+		/// \return The number of temporary strings up to and including the last one referenced from the stack.
+		[[nodiscard]] ZKINT std::uint32_t referenced_temporary_strings() const;
 
 	private:
-		std::array<DaedalusStackFrame, stack_size> _m_stack;
+		friend struct CallGuard;
+
+		std::array<DaedalusStackSlot, stack_size> _m_stack;
 		uint16_t _m_stack_ptr {0};
+		std::vector<std::shared_ptr<DaedalusInstance>> _m_pinned_instances;
 
 		std::vector<DaedalusCallStackFrame> _m_call_stack;
-		std::unordered_map<DaedalusSymbol*, std::function<void(DaedalusVm&)>> _m_externals;
-		std::unordered_map<uint32_t, std::function<void(DaedalusVm&)>> _m_function_overrides;
+		std::vector<std::uint32_t> _m_function_depth;   ///< Active calls per entry of the function table.
+		std::vector<std::uint8_t> _m_function_verified; ///< Verification results per entry of the function table.
+		std::vector<DaedalusNativeFunction> _m_native;  ///< Translated functions per entry of the function table.
+
+		/// \brief Lowered code per entry of the function table. See DaedalusVmExecutionFlag::OPTIMIZE.
+		std::vector<std::shared_ptr<DaedalusIrFunction const>> _m_ir;
+
+		std::vector<std::function<void(DaedalusVm&)>> _m_callbacks;
 		std::optional<std::function<void(DaedalusVm&, DaedalusSymbol&)>> _m_default_external {std::nullopt};
 		std::function<void(DaedalusSymbol&)> _m_access_trap;
 		std::optional<std::function<
@@ -1016,11 +1491,27 @@ namespace zenkit {
 		DaedalusSymbol* _m_item_sym;
 
 		DaedalusSymbol* _m_temporary_strings;
-		std::stack<uint32_t> _m_temporary_strings_free {};
+		std::uint32_t _m_temporary_strings_used {0};
+
+		/// \brief Storage of temporary strings replaced while growing, which may still be referenced.
+		std::vector<std::shared_ptr<std::string[]>> _m_temporary_strings_retired;
+
+		/// \brief Instances remembered by the instance cache by symbol index, or `nullptr` for impure instances.
+		std::unordered_map<std::uint32_t, std::shared_ptr<DaedalusInstance const>> _m_instance_cache;
+		bool _m_instance_cache_enabled {false};
+
+		/// \brief The number of calls to externals and overridden functions, used to detect impure instances.
+		std::uint32_t _m_external_calls {0};
 
 		std::shared_ptr<DaedalusInstance> _m_instance;
 		std::uint32_t _m_pc {0};
 		std::uint8_t _m_flags {DaedalusVmExecutionFlag::NONE};
+		std::unique_ptr<DaedalusProfiler> _m_profiler;
+		std::unique_ptr<DaedalusTrace> _m_trace;
+
+		std::size_t _m_suspended_base {0};
+		bool _m_suspended {false};
+		bool _m_suspend_requested {false};
 	};
 
 	/// \brief A VM exception handler which handles some and pretends to handle other VM exceptions.
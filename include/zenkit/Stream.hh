@@ -5,10 +5,16 @@
 #include "zenkit/Logger.hh"
 #include "zenkit/Misc.hh"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <filesystem>
 #include <functional>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <span>
+#include <type_traits>
 #include <vector>
 
 namespace zenkit {
@@ -39,12 +45,12 @@ namespace zenkit {
 	///   <tr>
 	///     <td>Read::from(::FILE*)</td>
 	///     <td>Uses a C-style FILE* as the data source. Note that the input stream pointed to is required to be
-	///     seekable, thus stdin is not fully supported.</td>
+	///     seekable, thus stdin is not fully supported. Reads are buffered, see Read::buffered.</td>
 	///   </tr>
 	///   <tr>
 	///     <td>Read::from(std::istream*)</td>
 	///     <td>Uses a C++-style input stream as the data source. Note that the input stream is required to be seekable,
-	///     thus std::cin is not fully supported.</td>
+	///     thus std::cin is not fully supported. Reads are buffered, see Read::buffered.</td>
 	///   </tr>
 	///   <tr>
 	///     <td>Read::from(std::byte const*, size_t)</td>
@@ -76,6 +82,9 @@ namespace zenkit {
 	/// Read::seek, Read::tell and Read::eof member functions.</p>
 	class ZKAPI Read {
 	public:
+		/// \brief The default size of the buffer used by Read::buffered.
+		static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
 		virtual ~Read() noexcept = default;
 
 		[[nodiscard]] char read_char() noexcept;
@@ -93,26 +102,235 @@ namespace zenkit {
 		[[nodiscard]] Mat3 read_mat3() noexcept;
 		[[nodiscard]] Mat4 read_mat4() noexcept;
 
+		/// \brief Reads consecutive values into \p values using a single call to #read.
+		///
+		/// The values are copied verbatim, so this may only be used for types with the same size and layout as their
+		/// serialized form, like integers, floats, Vec2, Vec3 and structs made of these without padding in between.
+		/// Values which could not be read because the end of the stream was reached are zeroed.
+		///
+		/// \param values The values to read.
+		/// \return The number of values read completely.
+		template <typename T, size_t N>
+		    requires std::is_trivially_copyable_v<T>
+		size_t read_array(std::span<T, N> values) noexcept {
+			auto* bytes = reinterpret_cast<std::byte*>(values.data());
+			auto len = this->read(bytes, values.size_bytes());
+			std::memset(bytes + len, 0, values.size_bytes() - len);
+			return len / sizeof(T);
+		}
+
+		/// \brief Reads up to the next `\0`, `\r` or `\n` without allocating if possible.
+		///
+		/// For streams with a #view, the returned view points into the stream's memory. Otherwise, the line is copied
+		/// into \p buffer. Either way, the view is only valid until \p buffer or the stream are modified.
+		///
+		/// \param skipws Whether to skip whitespace after the end of the line, like #read_line.
+		/// \param buffer Storage for the line if the stream is not contiguous. May be reused between calls.
+		/// \return The line, without the terminator.
+		[[nodiscard]] std::string_view read_line_view(bool skipws, std::string& buffer) noexcept;
+
 		[[nodiscard]] virtual std::string read_line_then_ignore(std::string_view chars) noexcept;
 
 		virtual size_t read(void* buf, size_t len) noexcept = 0;
 		virtual void seek(ssize_t off, Whence whence) noexcept = 0;
 		[[nodiscard]] virtual size_t tell() const noexcept = 0;
 		[[nodiscard]] virtual bool eof() const noexcept = 0;
+
+		/// \brief Returns the complete contents of the stream if they are available in contiguous memory.
+		///
+		/// Memory-backed streams, including memory-mapped files and files opened from a Vfs, return their buffer.
+		/// The current position of the stream, as returned by #tell, is an offset into the returned span. Parsers may
+		/// use this to read from a ReadSpan instead, which avoids a virtual call for every value read.
+		///
+		/// \return The contents of the stream or an empty span if they are not available in memory.
+		/// \see proto::read_contiguous
+		[[nodiscard]] virtual std::span<std::byte const> view() const noexcept;
+
+		/// \brief Wraps the given stream so that it is read in blocks of \p buffer_size bytes.
+		///
+		/// Small reads are served from the buffer, while reads of at least \p buffer_size bytes bypass it. Seeking
+		/// within the buffered block does not touch the underlying stream. When the returned stream is destroyed,
+		/// the underlying stream is positioned at the last byte actually read.
+		///
+		/// \param stream The stream to wrap.
+		/// \param buffer_size The size of the buffer in bytes.
+		/// \return The buffered stream.
+		[[nodiscard]] static std::unique_ptr<Read> buffered(std::unique_ptr<Read> stream,
+		                                                    size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
 #ifdef _ZK_WITH_ZIPPED_VDF
 		[[nodiscard]] static std::unique_ptr<Read> from_zipped(std::unique_ptr<Read> stream);
 #endif
 
-		[[nodiscard]] static std::unique_ptr<Read> from(FILE* stream);
-		[[nodiscard]] static std::unique_ptr<Read> from(std::istream* stream);
+		/// \param stream The stream to read from.
+		/// \param buffer_size The size of the read buffer or 0 to disable buffering.
+		[[nodiscard]] static std::unique_ptr<Read> from(FILE* stream, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+		/// \param stream The stream to read from.
+		/// \param buffer_size The size of the read buffer or 0 to disable buffering.
+		[[nodiscard]] static std::unique_ptr<Read> from(std::istream* stream,
+		                                                size_t buffer_size = DEFAULT_BUFFER_SIZE);
 		[[nodiscard]] static std::unique_ptr<Read> from(std::byte const* bytes, size_t len);
 		[[nodiscard]] static std::unique_ptr<Read> from(std::vector<std::byte> const* vector);
 		[[nodiscard]] static std::unique_ptr<Read> from(std::vector<std::byte> vector);
 		[[nodiscard]] static std::unique_ptr<Read> from(std::filesystem::path const& path);
 	};
 
+	/// \brief A non-virtual cursor over a contiguous memory buffer.
+	///
+	/// <p>Provides the same functions for reading primitives as Read, but all of them are inlined, so reading a value
+	/// compiles down to a bounds check and a copy. The buffer is never copied and thus must remain valid as long as
+	/// the cursor is in use. Reading past the end of the buffer behaves like reading past the end of a Read.</p>
+	///
+	/// <p>Parsers which are hot enough to benefit from this are written as templates over the type of the stream
+	/// and instantiated for both Read and ReadSpan.</p>
+	///
+	/// \see proto::read_contiguous
+	class ReadSpan {
+	public:
+		explicit ReadSpan(std::span<std::byte const> data) noexcept : _m_data(data) {}
+
+		[[nodiscard]] char read_char() noexcept {
+			return read_any<char>();
+		}
+
+		[[nodiscard]] int8_t read_byte() noexcept {
+			return read_any<int8_t>();
+		}
+
+		[[nodiscard]] uint8_t read_ubyte() noexcept {
+			return read_any<uint8_t>();
+		}
+
+		[[nodiscard]] int16_t read_short() noexcept {
+			return read_any<int16_t>();
+		}
+
+		[[nodiscard]] uint16_t read_ushort() noexcept {
+			return read_any<uint16_t>();
+		}
+
+		[[nodiscard]] int32_t read_int() noexcept {
+			return read_any<int32_t>();
+		}
+
+		[[nodiscard]] uint32_t read_uint() noexcept {
+			return read_any<uint32_t>();
+		}
+
+		[[nodiscard]] float read_float() noexcept {
+			return read_any<float>();
+		}
+
+		[[nodiscard]] Vec2 read_vec2() noexcept {
+			return read_any<Vec2>();
+		}
+
+		[[nodiscard]] Vec3 read_vec3() noexcept {
+			return read_any<Vec3>();
+		}
+
+		[[nodiscard]] std::string read_string(size_t len) noexcept {
+			std::string str(len, '\0');
+			this->read(str.data(), len);
+			return str;
+		}
+
+		/// \brief Reads up to the next `\0`, `\r` or `\n`, like Read::read_line.
+		[[nodiscard]] std::string read_line(bool skipws) noexcept {
+			return std::string {this->read_line_view(skipws)};
+		}
+
+		/// \brief Reads up to the next `\0`, `\r` or `\n`, like Read::read_line_then_ignore.
+		[[nodiscard]] std::string read_line_then_ignore(std::string_view chars) noexcept {
+			return std::string {this->read_line_view_then_ignore(chars)};
+		}
+
+		/// \brief Like #read_line, but returns a view into the buffer instead of copying the line.
+		[[nodiscard]] std::string_view read_line_view(bool skipws) noexcept {
+			return this->read_line_view_then_ignore(skipws ? WHITESPACE : std::string_view {});
+		}
+
+		/// \brief Like #read_line_then_ignore, but returns a view into the buffer instead of copying the line.
+		[[nodiscard]] std::string_view read_line_view_then_ignore(std::string_view chars) noexcept {
+			auto const* data = reinterpret_cast<char const*>(_m_data.data());
+			auto const* begin = data + _m_position;
+			auto const* end = data + _m_data.size();
+
+			// Find the first terminator in a single pass, so that the cost only depends on the length of the line.
+			auto const* it = std::find_if(begin, end, [](char c) { return c == '\n' || c == '\r' || c == '\0'; });
+
+			std::string_view line {begin, static_cast<size_t>(it - begin)};
+			if (it == end) {
+				_m_position = _m_data.size();
+				return line;
+			}
+
+			// Don't ignore the given chars if we're at the end of a C-style string.
+			if (*it++ != '\0' && !chars.empty()) {
+				while (it != end && *it != '\0' && chars.find(*it) != std::string_view::npos) {
+					++it;
+				}
+
+				// A trailing null-byte is consumed, like Read::read_line_then_ignore does.
+				if (it + 1 == end && *it == '\0') ++it;
+			}
+
+			_m_position = static_cast<size_t>(it - data);
+			return line;
+		}
+
+		/// \brief Reads consecutive values into \p values, like Read::read_array.
+		template <typename T, size_t N>
+		    requires std::is_trivially_copyable_v<T>
+		size_t read_array(std::span<T, N> values) noexcept {
+			auto* bytes = reinterpret_cast<std::byte*>(values.data());
+			auto len = this->read(bytes, values.size_bytes());
+			std::memset(bytes + len, 0, values.size_bytes() - len);
+			return len / sizeof(T);
+		}
+
+		size_t read(void* buf, size_t len) noexcept {
+			len = len > _m_data.size() - _m_position ? _m_data.size() - _m_position : len;
+			std::memcpy(buf, _m_data.data() + _m_position, len);
+			_m_position += len;
+			return len;
+		}
+
+		void seek(ssize_t off, Whence whence) noexcept {
+			auto base = whence == Whence::BEG ? 0 : whence == Whence::CUR ? _m_position : _m_data.size();
+			auto position = static_cast<size_t>(static_cast<ssize_t>(base) + off);
+			if (position > _m_data.size()) return;
+			_m_position = position;
+		}
+
+		[[nodiscard]] size_t tell() const noexcept {
+			return _m_position;
+		}
+
+		[[nodiscard]] bool eof() const noexcept {
+			return _m_position >= _m_data.size();
+		}
+
+	private:
+		static constexpr std::string_view WHITESPACE = " \t\r\n\v\f";
+
+		template <typename T>
+		[[nodiscard]] T read_any() noexcept {
+			T v {};
+			this->read(&v, sizeof v);
+			return v;
+		}
+
+		std::span<std::byte const> _m_data;
+		size_t _m_position {0};
+	};
+
 	class Write ZKAPI {
 	public:
+		/// \brief The default size of the buffer used by Write::buffered.
+		static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
 		virtual ~Write() noexcept = default;
 
 		void write_char(char v) noexcept;
@@ -135,14 +353,71 @@ namespace zenkit {
 		virtual void seek(ssize_t off, Whence whence) noexcept = 0;
 		[[nodiscard]] virtual size_t tell() const noexcept = 0;
 
-		[[nodiscard]] static std::unique_ptr<Write> to(std::filesystem::path const& path);
-		[[nodiscard]] static std::unique_ptr<Write> to(FILE* stream);
-		[[nodiscard]] static std::unique_ptr<Write> to(std::ostream* stream);
+		/// \brief Overwrites data written earlier without moving the cursor.
+		///
+		/// This is meant for filling in sizes and offsets once they are known. The default implementation seeks to
+		/// \p offset, writes the data and seeks back. Buffered streams apply the patch in memory if the data at
+		/// \p offset has not been written out yet and defer it until the next #flush otherwise.
+		///
+		/// \param offset The absolute position of the data to overwrite.
+		/// \param buf The data to write.
+		/// \param len The number of bytes to write.
+		virtual void patch(size_t offset, void const* buf, size_t len) noexcept;
+
+		/// \brief Passes all buffered data, including deferred patches, to the underlying device.
+		virtual void flush() noexcept;
+
+		/// \param path The path of the file to write to.
+		/// \param buffer_size The size of the write buffer or 0 to disable buffering.
+		[[nodiscard]] static std::unique_ptr<Write> to(std::filesystem::path const& path,
+		                                               size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+		/// \param stream The stream to write to.
+		/// \param buffer_size The size of the write buffer or 0 to disable buffering.
+		[[nodiscard]] static std::unique_ptr<Write> to(FILE* stream, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+		/// \param stream The stream to write to.
+		/// \param buffer_size The size of the write buffer or 0 to disable buffering.
+		[[nodiscard]] static std::unique_ptr<Write> to(std::ostream* stream, size_t buffer_size = DEFAULT_BUFFER_SIZE);
 		[[nodiscard]] static std::unique_ptr<Write> to(std::byte* bytes, size_t len);
 		[[nodiscard]] static std::unique_ptr<Write> to(std::vector<std::byte>* vector);
+
+		/// \brief Wraps the given stream so that small writes are collected in a buffer of \p buffer_size bytes.
+		///
+		/// Writes of at least \p buffer_size bytes bypass the buffer. Seeking within the buffered block and
+		/// patching data in it does not touch the underlying stream. All data is flushed when the returned stream is
+		/// destroyed or #flush is called.
+		///
+		/// \param stream The stream to wrap.
+		/// \param buffer_size The size of the buffer in bytes.
+		/// \return The buffered stream.
+		[[nodiscard]] static std::unique_ptr<Write> buffered(std::unique_ptr<Write> stream,
+		                                                     size_t buffer_size = DEFAULT_BUFFER_SIZE);
 	};
 
 	namespace proto {
+		/// \brief Calls \p fn with the fastest available cursor over \p r.
+		///
+		/// If \p r is memory-backed, \p fn is called with a ReadSpan positioned at the current position of \p r,
+		/// otherwise it is called with \p r itself. Afterwards, \p r is positioned after the last byte read by \p fn.
+		///
+		/// \param r The stream to read from.
+		/// \param fn A generic callable accepting either a `Read*` or a `ReadSpan*`.
+		template <typename F>
+		void read_contiguous(Read* r, F&& fn) {
+			auto data = r->view();
+			if (data.empty()) {
+				fn(r);
+				return;
+			}
+
+			auto begin = r->tell();
+			ReadSpan span {data};
+			span.seek(static_cast<ssize_t>(begin), Whence::BEG);
+			fn(&span);
+			r->seek(static_cast<ssize_t>(span.tell() - begin), Whence::CUR);
+		}
+
 		template <typename T>
 		    requires std::is_enum_v<T>
 		void read_chunked(Read* r, char const* name, std::function<bool(Read*, T)> const& cb) {
@@ -216,15 +491,13 @@ namespace zenkit {
 		void write_chunk(Write* w, T v, std::function<void(Write*)> const& cb) {
 			w->write_ushort(static_cast<uint16_t>(v));
 
-			auto size_off = static_cast<ssize_t>(w->tell());
+			auto size_off = w->tell();
 			w->write_uint(0);
 
 			cb(w);
 
-			auto len = static_cast<ssize_t>(w->tell()) - size_off - static_cast<ssize_t>(sizeof(uint32_t));
-			w->seek(size_off, Whence::BEG);
-			w->write_uint(static_cast<uint32_t>(len));
-			w->seek(len, Whence::CUR);
+			auto len = static_cast<uint32_t>(w->tell() - size_off - sizeof(uint32_t));
+			w->patch(size_off, &len, sizeof len);
 		}
 	} // namespace proto
 } // namespace zenkit
@@ -180,8 +180,10 @@ namespace zenkit {
 	    : header(std::move(head)), read(read), _m_owned(std::move(owned)) {}
 
 	void ArchiveHeader::load(Read* r) {
+		std::string buffer;
+
 		try {
-			if (r->read_line(true) != "ZenGin Archive") {
+			if (r->read_line_view(true, buffer) != "ZenGin Archive") {
 				ZKLOGE("ReadArchive", "Invalid Header");
 				throw ParserError {"ReadArchive", "magic missing"};
 			}
@@ -198,7 +200,7 @@ namespace zenkit {
 
 			this->archiver = r->read_line(true);
 
-			if (auto fmt = r->read_line(true); fmt == "ASCII") {
+			if (auto fmt = r->read_line_view(true, buffer); fmt == "ASCII") {
 				this->format = ArchiveFormat::ASCII;
 			} else if (fmt == "BINARY") {
 				this->format = ArchiveFormat::BINARY;
@@ -0,0 +1,267 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include "zenkit/DaedalusCallGraph.hh"
+#include "zenkit/DaedalusScript.hh"
+#include "zenkit/Stream.hh"
+
+#include "Internal.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+
+namespace zenkit {
+	static constexpr auto UNBOUNDED = DaedalusCallGraphNode::UNBOUNDED;
+
+	namespace {
+		enum class VisitState : std::uint8_t {
+			NEW,
+			ACTIVE,
+			DONE,
+		};
+
+		std::uint32_t add_depth(std::uint32_t a, std::uint32_t b) {
+			return a == UNBOUNDED || b == UNBOUNDED ? UNBOUNDED : a + b;
+		}
+
+		/// \return Whether the `PUSHI` instruction at \p pc is the start of an assignment to a function variable.
+		bool is_function_assignment(DaedalusScript const& script, std::uint32_t pc) {
+			auto const* push = script.compact_instruction_at(pc);
+			auto const* var = script.compact_instruction_at(pc + push->size);
+			if (var == nullptr) return false;
+
+			auto op = var->original_op();
+			if (op != DaedalusOpcode::PUSHV && op != DaedalusOpcode::PUSHVI) return false;
+
+			auto const* target = script.find_symbol_by_index(var->arg);
+			if (target == nullptr || target->type() != DaedalusDataType::FUNCTION) return false;
+
+			auto const* move = script.compact_instruction_at(pc + push->size + var->size);
+			return move != nullptr && move->original_op() == DaedalusOpcode::MOVVF;
+		}
+
+		/// \brief Appends all references made by instructions reachable from the start of \p sym to \p edges.
+		void collect_edges(DaedalusScript const& script, DaedalusSymbol const& sym, std::vector<DaedalusCallEdge>& edges) {
+			std::unordered_set<std::uint32_t> seen;
+			std::vector<std::uint32_t> pending {sym.address()};
+
+			while (!pending.empty()) {
+				auto pc = pending.back();
+				pending.pop_back();
+
+				while (seen.insert(pc).second) {
+					auto const* instr = script.compact_instruction_at(pc);
+					if (instr == nullptr) break;
+
+					auto op = instr->original_op();
+					if (op == DaedalusOpcode::RSR) break;
+
+					if (op == DaedalusOpcode::BL && instr->resolved) {
+						edges.push_back({sym.index(), instr->arg, pc, DaedalusCallKind::CALL});
+					} else if (op == DaedalusOpcode::BE) {
+						edges.push_back({sym.index(), instr->arg, pc, DaedalusCallKind::EXTERNAL});
+					} else if (op == DaedalusOpcode::GMOVI) {
+						edges.push_back({sym.index(), instr->arg, pc, DaedalusCallKind::INSTANCE});
+					} else if (op == DaedalusOpcode::PUSHI && is_function_assignment(script, pc)) {
+						// The immediate is the symbol index of the function being assigned.
+						auto const* target = script.find_symbol_by_index(instr->arg);
+						if (target != nullptr && script.find_function_info(target) != nullptr) {
+							edges.push_back({sym.index(), instr->arg, pc, DaedalusCallKind::REFERENCE});
+						}
+					} else if (op == DaedalusOpcode::B) {
+						pc = instr->arg;
+						continue;
+					} else if (op == DaedalusOpcode::BZ) {
+						pending.push_back(instr->arg);
+					}
+
+					pc += instr->size;
+				}
+			}
+		}
+
+		char const* kind_name(DaedalusCallKind kind) {
+			switch (kind) {
+			case DaedalusCallKind::CALL:
+				return "call";
+			case DaedalusCallKind::EXTERNAL:
+				return "external";
+			case DaedalusCallKind::INSTANCE:
+				return "instance";
+			case DaedalusCallKind::REFERENCE:
+				return "reference";
+			}
+
+			return "unknown";
+		}
+
+		std::string depth_json(std::uint32_t depth) {
+			return depth == UNBOUNDED ? "null" : std::to_string(depth);
+		}
+	} // namespace
+
+	DaedalusCallGraph::DaedalusCallGraph(DaedalusScript const& script) : _m_script(script) {
+		auto const& functions = script.functions();
+		_m_nodes.resize(functions.size());
+
+		for (std::size_t i = 0; i < functions.size(); ++i) {
+			auto& node = _m_nodes[i];
+			auto const* sym = script.find_symbol_by_index(functions[i].symbol);
+
+			node.symbol = functions[i].symbol;
+			node.edges_begin = static_cast<std::uint32_t>(_m_edges.size());
+
+			if (!sym->is_external()) {
+				auto verification = script.verify_function(sym);
+				node.verified = verification.verified;
+				node.stack_depth = verification.max_stack_depth;
+
+				collect_edges(script, *sym, _m_edges);
+				std::sort(_m_edges.begin() + node.edges_begin, _m_edges.end(), [](auto const& a, auto const& b) {
+					return a.address < b.address;
+				});
+			}
+
+			node.edges_count = static_cast<std::uint32_t>(_m_edges.size()) - node.edges_begin;
+		}
+
+		// Compute the depths of all nodes using a depth-first search along calls. Reaching a node which is still
+		// being visited means that it may recurse, which makes all functions on the path to it unbounded.
+		std::vector<VisitState> state(_m_nodes.size(), VisitState::NEW);
+
+		auto visit = [&](auto& self, std::size_t index) -> void {
+			auto& node = _m_nodes[index];
+			state[index] = VisitState::ACTIVE;
+
+			std::uint32_t call_depth = 0;
+			std::uint32_t stack_depth = 0;
+			for (auto const& edge : this->edges(node)) {
+				if (edge.kind != DaedalusCallKind::CALL) continue;
+
+				auto callee = script.find_symbol_by_index(edge.callee)->function_index();
+				if (state[callee] == VisitState::NEW) self(self, callee);
+
+				if (state[callee] == VisitState::ACTIVE) {
+					call_depth = stack_depth = UNBOUNDED;
+					continue;
+				}
+
+				call_depth = std::max(call_depth, _m_nodes[callee].max_call_depth);
+				stack_depth = std::max(stack_depth, _m_nodes[callee].max_stack_depth);
+			}
+
+			auto const* sym = script.find_symbol_by_index(node.symbol);
+			node.max_call_depth = sym->is_external() ? 0 : add_depth(call_depth, 1);
+			node.max_stack_depth = add_depth(stack_depth, node.stack_depth);
+			state[index] = VisitState::DONE;
+		};
+
+		for (std::size_t i = 0; i < _m_nodes.size(); ++i) {
+			if (state[i] == VisitState::NEW) visit(visit, i);
+		}
+	}
+
+	DaedalusCallGraphNode const* DaedalusCallGraph::node(DaedalusSymbol const& sym) const noexcept {
+		auto index = sym.function_index();
+		if (index >= _m_nodes.size() || _m_nodes[index].symbol != sym.index()) return nullptr;
+		return &_m_nodes[index];
+	}
+
+	std::vector<std::uint32_t> DaedalusCallGraph::reachable(std::span<DaedalusSymbol const* const> roots) const {
+		std::vector<bool> seen(_m_script.symbols().size(), false);
+		std::vector<std::uint32_t> pending;
+
+		for (auto const* root : roots) {
+			if (root == nullptr || seen[root->index()]) continue;
+			seen[root->index()] = true;
+			pending.push_back(root->index());
+		}
+
+		while (!pending.empty()) {
+			auto const* node = this->node(*_m_script.find_symbol_by_index(pending.back()));
+			pending.pop_back();
+			if (node == nullptr) continue;
+
+			for (auto const& edge : this->edges(*node)) {
+				if (edge.callee >= seen.size() || seen[edge.callee]) continue;
+				seen[edge.callee] = true;
+				pending.push_back(edge.callee);
+			}
+		}
+
+		std::vector<std::uint32_t> result;
+		for (std::uint32_t i = 0; i < seen.size(); ++i) {
+			if (seen[i]) result.push_back(i);
+		}
+
+		return result;
+	}
+
+	std::vector<std::uint32_t> DaedalusCallGraph::unreachable(std::span<DaedalusSymbol const* const> roots) const {
+		auto reached = this->reachable(roots);
+
+		std::vector<std::uint32_t> result;
+		for (auto const& node : _m_nodes) {
+			if (_m_script.find_symbol_by_index(node.symbol)->is_external()) continue;
+			if (std::binary_search(reached.begin(), reached.end(), node.symbol)) continue;
+			result.push_back(node.symbol);
+		}
+
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	void DaedalusCallGraph::write_json(Write* w, std::span<DaedalusSymbol const* const> roots) const {
+		std::vector<std::uint32_t> reached;
+		if (!roots.empty()) reached = this->reachable(roots);
+
+		w->write_string("{\"functions\":[");
+
+		char buf[128];
+		for (auto i = 0u; i < _m_nodes.size(); ++i) {
+			auto const& node = _m_nodes[i];
+			auto const* sym = _m_script.find_symbol_by_index(node.symbol);
+
+			std::snprintf(buf, sizeof buf, "{\"symbol\":%u,\"name\":\"", node.symbol);
+			w->write_string(i == 0 ? "\n" : ",\n");
+			w->write_string(buf);
+			w->write_string(escape_json(sym->name()));
+
+			std::snprintf(buf,
+			              sizeof buf,
+			              "\",\"external\":%s,\"verified\":%s,\"stack_depth\":%u,",
+			              sym->is_external() ? "true" : "false",
+			              node.verified ? "true" : "false",
+			              node.stack_depth);
+			w->write_string(buf);
+			w->write_string("\"max_call_depth\":" + depth_json(node.max_call_depth));
+			w->write_string(",\"max_stack_depth\":" + depth_json(node.max_stack_depth));
+
+			if (!roots.empty()) {
+				auto is_reachable = std::binary_search(reached.begin(), reached.end(), node.symbol);
+				w->write_string(is_reachable ? ",\"reachable\":true" : ",\"reachable\":false");
+			}
+
+			w->write_string("}");
+		}
+
+		w->write_string("\n],\"edges\":[");
+
+		for (auto i = 0u; i < _m_edges.size(); ++i) {
+			auto const& edge = _m_edges[i];
+
+			std::snprintf(buf,
+			              sizeof buf,
+			              "{\"caller\":%u,\"callee\":%u,\"address\":%u,\"kind\":\"%s\"}",
+			              edge.caller,
+			              edge.callee,
+			              edge.address,
+			              kind_name(edge.kind));
+			w->write_string(i == 0 ? "\n" : ",\n");
+			w->write_string(buf);
+		}
+
+		w->write_string("\n]}\n");
+	}
+} // namespace zenkit
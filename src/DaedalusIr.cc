@@ -0,0 +1,532 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include "DaedalusIr.hh"
+
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace zenkit {
+	namespace {
+		using Kind = DaedalusIrOperandKind;
+
+		/// \brief The maximum number of values kept in operands instead of on the stack. If a block pushes more
+		///        values than this, it is continued in the bytecode interpreter.
+		constexpr std::size_t MAX_LIVE_VALUES = 256;
+
+		DaedalusIrOperand constant(std::int32_t value) {
+			return {Kind::CONSTANT, 0, value};
+		}
+
+		DaedalusIrOperand reg(std::uint32_t number) {
+			return {Kind::REGISTER, 0, static_cast<std::int32_t>(number)};
+		}
+
+		DaedalusIrOperand variable(std::uint32_t symbol, std::uint8_t index) {
+			return {Kind::VARIABLE, index, static_cast<std::int32_t>(symbol)};
+		}
+
+		std::uint64_t variable_key(DaedalusIrOperand const& var) {
+			return static_cast<std::uint64_t>(static_cast<std::uint32_t>(var.value)) << 8 | var.index;
+		}
+
+		std::optional<DaedalusIrOpcode> lowered_opcode(DaedalusOpcode op) {
+			switch (op) {
+			case DaedalusOpcode::ADD:
+				return DaedalusIrOpcode::ADD;
+			case DaedalusOpcode::SUB:
+				return DaedalusIrOpcode::SUB;
+			case DaedalusOpcode::MUL:
+				return DaedalusIrOpcode::MUL;
+			case DaedalusOpcode::DIV:
+				return DaedalusIrOpcode::DIV;
+			case DaedalusOpcode::MOD:
+				return DaedalusIrOpcode::MOD;
+			case DaedalusOpcode::OR:
+				return DaedalusIrOpcode::OR;
+			case DaedalusOpcode::ANDB:
+				return DaedalusIrOpcode::ANDB;
+			case DaedalusOpcode::LT:
+				return DaedalusIrOpcode::LT;
+			case DaedalusOpcode::GT:
+				return DaedalusIrOpcode::GT;
+			case DaedalusOpcode::LSL:
+				return DaedalusIrOpcode::LSL;
+			case DaedalusOpcode::LSR:
+				return DaedalusIrOpcode::LSR;
+			case DaedalusOpcode::LTE:
+				return DaedalusIrOpcode::LTE;
+			case DaedalusOpcode::EQ:
+				return DaedalusIrOpcode::EQ;
+			case DaedalusOpcode::NEQ:
+				return DaedalusIrOpcode::NEQ;
+			case DaedalusOpcode::GTE:
+				return DaedalusIrOpcode::GTE;
+			case DaedalusOpcode::ORR:
+				return DaedalusIrOpcode::ORR;
+			case DaedalusOpcode::AND:
+				return DaedalusIrOpcode::AND;
+			case DaedalusOpcode::PLUS:
+				return DaedalusIrOpcode::PLUS;
+			case DaedalusOpcode::NEGATE:
+				return DaedalusIrOpcode::NEGATE;
+			case DaedalusOpcode::NOT:
+				return DaedalusIrOpcode::NOT;
+			case DaedalusOpcode::CMPL:
+				return DaedalusIrOpcode::CMPL;
+			case DaedalusOpcode::MOVI:
+			case DaedalusOpcode::MOVVF:
+				return DaedalusIrOpcode::MOVI;
+			case DaedalusOpcode::ADDMOVI:
+				return DaedalusIrOpcode::ADDMOVI;
+			case DaedalusOpcode::SUBMOVI:
+				return DaedalusIrOpcode::SUBMOVI;
+			case DaedalusOpcode::MULMOVI:
+				return DaedalusIrOpcode::MULMOVI;
+			case DaedalusOpcode::DIVMOVI:
+				return DaedalusIrOpcode::DIVMOVI;
+			default:
+				return std::nullopt;
+			}
+		}
+
+		/// \brief Evaluates the binary instruction \p op with `a` on top of the stack and `b` below it.
+		/// \return The result or std::nullopt if the instruction fails or its result is undefined.
+		std::optional<std::int32_t> fold(DaedalusOpcode op, std::int32_t a, std::int32_t b) {
+			// Integers wrap around on overflow, like they do in the interpreter in practice.
+			auto ua = static_cast<std::uint32_t>(a);
+			auto ub = static_cast<std::uint32_t>(b);
+
+			switch (op) {
+			case DaedalusOpcode::ADD:
+				return static_cast<std::int32_t>(ua + ub);
+			case DaedalusOpcode::SUB:
+				return static_cast<std::int32_t>(ua - ub);
+			case DaedalusOpcode::MUL:
+				return static_cast<std::int32_t>(ua * ub);
+			case DaedalusOpcode::DIV:
+				if (b == 0 || (a == std::numeric_limits<std::int32_t>::min() && b == -1)) return std::nullopt;
+				return a / b;
+			case DaedalusOpcode::MOD:
+				if (b == 0 || (a == std::numeric_limits<std::int32_t>::min() && b == -1)) return std::nullopt;
+				return a % b;
+			case DaedalusOpcode::OR:
+				return a | b;
+			case DaedalusOpcode::ANDB:
+				return a & b;
+			case DaedalusOpcode::LT:
+				return a < b;
+			case DaedalusOpcode::GT:
+				return a > b;
+			case DaedalusOpcode::LSL:
+				if (b < 0 || b > 31) return std::nullopt;
+				return static_cast<std::int32_t>(ua << b);
+			case DaedalusOpcode::LSR:
+				if (b < 0 || b > 31) return std::nullopt;
+				return a >> b;
+			case DaedalusOpcode::LTE:
+				return a <= b;
+			case DaedalusOpcode::EQ:
+				return a == b;
+			case DaedalusOpcode::NEQ:
+				return a != b;
+			case DaedalusOpcode::GTE:
+				return a >= b;
+			case DaedalusOpcode::ORR:
+				return a || b;
+			case DaedalusOpcode::AND:
+				return a && b;
+			default:
+				return std::nullopt;
+			}
+		}
+
+		/// \brief Evaluates the unary instruction \p op.
+		std::optional<std::int32_t> fold(DaedalusOpcode op, std::int32_t a) {
+			switch (op) {
+			case DaedalusOpcode::PLUS:
+				return a;
+			case DaedalusOpcode::NEGATE:
+				return static_cast<std::int32_t>(0U - static_cast<std::uint32_t>(a));
+			case DaedalusOpcode::NOT:
+				return !a;
+			case DaedalusOpcode::CMPL:
+				return ~a;
+			default:
+				return std::nullopt;
+			}
+		}
+
+		/// \brief Lowers the bytecode of a single function.
+		///
+		/// The operand stack is simulated while lowering. Pushing a constant or a variable reference does not emit
+		/// any code, it only adds an operand to the simulated stack. Instructions consuming values take their
+		/// operands from the simulated stack or, if it is empty, from the real one. Anything which expects values
+		/// on the real stack, like calls or branches, first spills all simulated values onto it.
+		class Lowering {
+		public:
+			Lowering(DaedalusScript const& script, DaedalusFunctionInfo const& info, bool fold_constants)
+			    : _m_script(script), _m_info(info), _m_fold_constants(fold_constants) {}
+
+			DaedalusIrFunction lower(std::uint32_t entry) {
+				find_labels(entry);
+
+				_m_pending.push_back(entry);
+				while (!_m_pending.empty()) {
+					auto address = _m_pending.back();
+					_m_pending.pop_back();
+
+					if (_m_blocks.contains(address)) continue;
+					lower_block(address);
+				}
+
+				for (auto [index, target] : _m_fixups) {
+					_m_function.code[index].arg = _m_blocks.at(target);
+				}
+
+				return std::move(_m_function);
+			}
+
+		private:
+			[[nodiscard]] bool is_instruction(std::uint32_t address) const {
+				return _m_script.compact_instruction_at(address) != nullptr;
+			}
+
+			/// \brief Finds all branch targets reachable from the entry point, which is where blocks start.
+			void find_labels(std::uint32_t entry) {
+				std::unordered_set<std::uint32_t> visited;
+				std::vector<std::uint32_t> pending {entry};
+
+				while (!pending.empty()) {
+					auto pc = pending.back();
+					pending.pop_back();
+
+					for (;;) {
+						auto const* instr = _m_script.compact_instruction_at(pc);
+						if (instr == nullptr || !visited.insert(pc).second) break;
+
+						auto op = instr->original_op();
+						if (op == DaedalusOpcode::RSR) break;
+
+						if ((op == DaedalusOpcode::B || op == DaedalusOpcode::BZ) && is_instruction(instr->arg)) {
+							_m_labels.insert(instr->arg);
+							pending.push_back(instr->arg);
+						}
+
+						if (op == DaedalusOpcode::B) break;
+						pc += instr->size;
+					}
+				}
+			}
+
+			void lower_block(std::uint32_t address) {
+				_m_stack.clear();
+				_m_copies.clear();
+				_m_blocks[address] = static_cast<std::uint32_t>(_m_function.code.size());
+
+				for (auto pc = address;;) {
+					auto const* instr = _m_script.compact_instruction_at(pc);
+					if (instr == nullptr) return exit(pc);
+
+					auto op = instr->original_op();
+					switch (op) {
+					case DaedalusOpcode::NOP:
+						break;
+					case DaedalusOpcode::PUSHI:
+						_m_stack.push_back(constant(static_cast<std::int32_t>(instr->arg)));
+						break;
+					case DaedalusOpcode::PUSHV:
+					case DaedalusOpcode::PUSHVI:
+					case DaedalusOpcode::PUSHVV:
+						if (_m_script.find_symbol_by_index(instr->arg) == nullptr) return exit(pc);
+						_m_stack.push_back(variable(instr->arg, op == DaedalusOpcode::PUSHVV ? instr->index : 0));
+						break;
+					case DaedalusOpcode::ADD:
+					case DaedalusOpcode::SUB:
+					case DaedalusOpcode::MUL:
+					case DaedalusOpcode::DIV:
+					case DaedalusOpcode::MOD:
+					case DaedalusOpcode::OR:
+					case DaedalusOpcode::ANDB:
+					case DaedalusOpcode::LT:
+					case DaedalusOpcode::GT:
+					case DaedalusOpcode::LSL:
+					case DaedalusOpcode::LSR:
+					case DaedalusOpcode::LTE:
+					case DaedalusOpcode::EQ:
+					case DaedalusOpcode::NEQ:
+					case DaedalusOpcode::GTE:
+					case DaedalusOpcode::ORR:
+					case DaedalusOpcode::AND:
+						binary(pc, op);
+						break;
+					case DaedalusOpcode::PLUS:
+					case DaedalusOpcode::NEGATE:
+					case DaedalusOpcode::NOT:
+					case DaedalusOpcode::CMPL:
+						unary(pc, op);
+						break;
+					case DaedalusOpcode::MOVI:
+					case DaedalusOpcode::MOVVF:
+					case DaedalusOpcode::ADDMOVI:
+					case DaedalusOpcode::SUBMOVI:
+					case DaedalusOpcode::MULMOVI:
+					case DaedalusOpcode::DIVMOVI:
+						store(pc, op);
+						break;
+					case DaedalusOpcode::MOVF:
+					case DaedalusOpcode::MOVS:
+					case DaedalusOpcode::MOVVI:
+					case DaedalusOpcode::GMOVI:
+						stack(pc, op, instr->arg);
+						break;
+					case DaedalusOpcode::BL:
+						// Calls to unresolved addresses are left to the interpreter, which reports them.
+						if (!instr->resolved) return exit(pc);
+						call(pc, DaedalusIrOpcode::CALL, instr->arg);
+						break;
+					case DaedalusOpcode::BE:
+						call(pc, DaedalusIrOpcode::CALL_EXTERNAL, instr->arg);
+						break;
+					case DaedalusOpcode::RSR: {
+						auto ins = begin(pc, DaedalusIrOpcode::RETURN);
+						ins.spill_count = ins.live_count;
+						commit(ins);
+						return;
+					}
+					case DaedalusOpcode::B:
+						if (!is_instruction(instr->arg)) return exit(pc);
+						return jump(pc, instr->arg);
+					case DaedalusOpcode::BZ:
+						if (!is_instruction(instr->arg)) return exit(pc);
+						if (!branch(pc, instr->arg)) return;
+						break;
+					default:
+						return exit(pc);
+					}
+
+					pc += instr->size;
+					if (_m_stack.size() > MAX_LIVE_VALUES) return exit(pc);
+
+					// Code following a branch target is lowered as a new block, since the state of the stack
+					// depends on where execution came from.
+					if (_m_labels.contains(pc)) {
+						if (!_m_stack.empty() || _m_blocks.contains(pc)) return jump(pc, pc);
+
+						_m_blocks[pc] = static_cast<std::uint32_t>(_m_function.code.size());
+						_m_copies.clear();
+					}
+				}
+			}
+
+			/// \brief Starts an instruction, remembering the current contents of the simulated stack.
+			DaedalusIrInstruction begin(std::uint32_t pc, DaedalusIrOpcode op) {
+				DaedalusIrInstruction ins {};
+				ins.op = op;
+				ins.pc = pc;
+				ins.live_begin = static_cast<std::uint32_t>(_m_function.live.size());
+				ins.live_count = static_cast<std::uint16_t>(_m_stack.size());
+				_m_function.live.insert(_m_function.live.end(), _m_stack.begin(), _m_stack.end());
+				return ins;
+			}
+
+			/// \brief Drops an instruction started using #begin which turned out not to be required.
+			void discard(DaedalusIrInstruction const& ins) {
+				_m_function.live.resize(ins.live_begin);
+			}
+
+			std::uint32_t commit(DaedalusIrInstruction const& ins) {
+				_m_function.code.push_back(ins);
+				return static_cast<std::uint32_t>(_m_function.code.size() - 1);
+			}
+
+			DaedalusIrOperand pop() {
+				if (_m_stack.empty()) return {};
+
+				auto operand = _m_stack.back();
+				_m_stack.pop_back();
+				return operand;
+			}
+
+			/// \brief Replaces reads of constants and of local variables with a known value by that value.
+			DaedalusIrOperand resolve(DaedalusIrOperand const& operand) const {
+				if (operand.kind != Kind::VARIABLE) return operand;
+
+				if (auto it = _m_copies.find(variable_key(operand)); it != _m_copies.end()) {
+					return it->second;
+				}
+
+				auto const* sym = _m_script.find_symbol_by_index(static_cast<std::uint32_t>(operand.value));
+				if (_m_fold_constants && sym->is_const() && !sym->is_member() &&
+				    sym->type() == DaedalusDataType::INT && operand.index < sym->count()) {
+					return constant(sym->get_int(operand.index));
+				}
+
+				return operand;
+			}
+
+			/// \return Whether the given variable is a local integer of the function, whose value is known after
+			///         assigning to it until the next call.
+			[[nodiscard]] bool is_local(DaedalusIrOperand const& var) const {
+				auto index = static_cast<std::uint32_t>(var.value);
+				auto is_param = index >= _m_info.params_begin && index - _m_info.params_begin < _m_info.params_count;
+				auto is_var = index >= _m_info.locals_begin && index - _m_info.locals_begin < _m_info.locals_count;
+				if (!is_param && !is_var) return false;
+
+				auto const* sym = _m_script.find_symbol_by_index(index);
+				return !sym->is_member() && !sym->is_const() && sym->type() == DaedalusDataType::INT &&
+				    var.index < sym->count();
+			}
+
+			std::uint32_t allocate() {
+				return _m_function.registers++;
+			}
+
+			void binary(std::uint32_t pc, DaedalusOpcode op) {
+				auto ins = begin(pc, *lowered_opcode(op));
+				ins.a = resolve(pop());
+				ins.b = resolve(pop());
+
+				if (ins.a.kind == Kind::CONSTANT && ins.b.kind == Kind::CONSTANT) {
+					if (auto value = fold(op, ins.a.value, ins.b.value)) {
+						discard(ins);
+						_m_stack.push_back(constant(*value));
+						return;
+					}
+				}
+
+				ins.arg = allocate();
+				commit(ins);
+				_m_stack.push_back(reg(ins.arg));
+			}
+
+			void unary(std::uint32_t pc, DaedalusOpcode op) {
+				auto ins = begin(pc, *lowered_opcode(op));
+				ins.a = resolve(pop());
+
+				if (ins.a.kind == Kind::CONSTANT) {
+					if (auto value = fold(op, ins.a.value)) {
+						discard(ins);
+						_m_stack.push_back(constant(*value));
+						return;
+					}
+				}
+
+				ins.arg = allocate();
+				commit(ins);
+				_m_stack.push_back(reg(ins.arg));
+			}
+
+			void store(std::uint32_t pc, DaedalusOpcode op) {
+				// Assignments to references which are already on the stack are done by the interpreter's code.
+				if (_m_stack.empty() || _m_stack.back().kind != Kind::VARIABLE) return stack(pc, op, 0);
+
+				auto ins = begin(pc, *lowered_opcode(op));
+				ins.b = pop();
+				ins.a = resolve(pop());
+				ins.arg = DaedalusIrInstruction::NO_REGISTER;
+
+				auto key = variable_key(ins.b);
+				_m_copies.erase(key);
+
+				if (ins.op == DaedalusIrOpcode::MOVI && is_local(ins.b)) {
+					if (ins.a.kind == Kind::CONSTANT || ins.a.kind == Kind::REGISTER) {
+						_m_copies[key] = ins.a;
+					} else {
+						ins.arg = allocate();
+						_m_copies[key] = reg(ins.arg);
+					}
+				}
+
+				commit(ins);
+			}
+
+			void stack(std::uint32_t pc, DaedalusOpcode op, std::uint32_t arg) {
+				if (!_m_stack.empty() && _m_stack.back().kind == Kind::VARIABLE) {
+					_m_copies.erase(variable_key(_m_stack.back()));
+				} else if (op != DaedalusOpcode::GMOVI) {
+					// The target is not known, so any local may change.
+					_m_copies.clear();
+				}
+
+				auto ins = begin(pc, DaedalusIrOpcode::STACK);
+				ins.code = op;
+				ins.arg = arg;
+				ins.spill_count = ins.live_count;
+				commit(ins);
+				_m_stack.clear();
+			}
+
+			void call(std::uint32_t pc, DaedalusIrOpcode op, std::uint32_t symbol) {
+				auto ins = begin(pc, op);
+				ins.arg = symbol;
+				ins.spill_count = ins.live_count;
+				commit(ins);
+
+				// The callee may change anything, even locals of this function if it is passed a reference to them.
+				_m_stack.clear();
+				_m_copies.clear();
+			}
+
+			void exit(std::uint32_t pc) {
+				auto ins = begin(pc, DaedalusIrOpcode::EXIT);
+				ins.spill_count = ins.live_count;
+				commit(ins);
+			}
+
+			void jump(std::uint32_t pc, std::uint32_t target) {
+				auto ins = begin(pc, DaedalusIrOpcode::JUMP);
+				ins.spill_count = ins.live_count;
+				_m_fixups.emplace_back(commit(ins), target);
+				_m_pending.push_back(target);
+			}
+
+			/// \return Whether execution may continue after the branch.
+			bool branch(std::uint32_t pc, std::uint32_t target) {
+				auto ins = begin(pc, DaedalusIrOpcode::JUMP_ZERO);
+				ins.a = resolve(pop());
+
+				if (ins.a.kind == Kind::CONSTANT) {
+					discard(ins);
+					if (ins.a.value != 0) return true;
+
+					jump(pc, target);
+					return false;
+				}
+
+				ins.spill_count = static_cast<std::uint16_t>(_m_stack.size());
+				_m_fixups.emplace_back(commit(ins), target);
+				_m_pending.push_back(target);
+				_m_stack.clear();
+				return true;
+			}
+
+			DaedalusScript const& _m_script;
+			DaedalusFunctionInfo const& _m_info;
+			bool _m_fold_constants;
+
+			DaedalusIrFunction _m_function;
+			std::unordered_set<std::uint32_t> _m_labels;
+			std::unordered_map<std::uint32_t, std::uint32_t> _m_blocks;
+			std::vector<std::uint32_t> _m_pending;
+			std::vector<std::pair<std::uint32_t, std::uint32_t>> _m_fixups;
+
+			/// \brief The values the interpreter would have on the stack, above those which are actually on it.
+			std::vector<DaedalusIrOperand> _m_stack;
+
+			/// \brief The known values of local variables.
+			std::unordered_map<std::uint64_t, DaedalusIrOperand> _m_copies;
+		};
+	} // namespace
+
+	std::shared_ptr<DaedalusIrFunction const>
+	lower_function(DaedalusScript const& script, DaedalusSymbol const& sym, bool fold_constants) {
+		auto const* info = script.find_function_info(&sym);
+		if (info == nullptr || sym.is_external() || script.compact_instruction_at(sym.address()) == nullptr) {
+			return nullptr;
+		}
+
+		Lowering lowering {script, *info, fold_constants};
+		return std::make_shared<DaedalusIrFunction const>(lowering.lower(sym.address()));
+	}
+} // namespace zenkit
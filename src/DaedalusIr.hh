@@ -0,0 +1,138 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "zenkit/DaedalusScript.hh"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace zenkit {
+	/// \brief Operations of the register-based representation of script functions.
+	///
+	/// Unless noted otherwise, `a` and `b` are integer operands, which correspond to the values called `a` and `b`
+	/// in the documentation of DaedalusOpcode, and `arg` is the register receiving the result.
+	enum class DaedalusIrOpcode : std::uint8_t {
+		ADD,
+		SUB,
+		MUL,
+		DIV,
+		MOD,
+		OR,
+		ANDB,
+		LT,
+		GT,
+		LSL,
+		LSR,
+		LTE,
+		EQ,
+		NEQ,
+		GTE,
+		ORR,
+		AND,
+		PLUS,
+		NEGATE,
+		NOT,
+		CMPL,
+
+		/// \brief Writes `a` to the variable `b` and, unless `arg` is DaedalusIrInstruction::NO_REGISTER, to
+		///        register `arg`.
+		MOVI,
+
+		/// \brief Updates the variable `b` using `a`, like the bytecode instruction of the same name.
+		ADDMOVI,
+		SUBMOVI,
+		MULMOVI,
+		DIVMOVI,
+
+		/// \brief Continues at instruction `arg`.
+		JUMP,
+
+		/// \brief Continues at instruction `arg` if `a` is zero.
+		JUMP_ZERO,
+
+		/// \brief Calls the script function with symbol index `arg`, like `BL`.
+		CALL,
+
+		/// \brief Calls the external with symbol index `arg`, like `BE`.
+		CALL_EXTERNAL,
+
+		/// \brief Executes DaedalusIrInstruction::code on the operand stack, like the bytecode interpreter.
+		STACK,
+
+		/// \brief Returns from the function.
+		RETURN,
+
+		/// \brief Continues executing the function in the bytecode interpreter, starting at `pc`.
+		EXIT,
+	};
+
+	enum class DaedalusIrOperandKind : std::uint8_t {
+		STACK,    ///< The value is popped from the operand stack of the VM.
+		CONSTANT, ///< The value is known while lowering.
+		REGISTER, ///< The value is the result of a previous instruction.
+		VARIABLE, ///< The value is read from a variable when it is used.
+	};
+
+	struct DaedalusIrOperand {
+		DaedalusIrOperandKind kind {DaedalusIrOperandKind::STACK};
+
+		/// \brief The array index of a variable.
+		std::uint8_t index {0};
+
+		/// \brief The value of a constant, the number of a register or the symbol index of a variable.
+		std::int32_t value {0};
+	};
+
+	struct DaedalusIrInstruction {
+		static constexpr auto NO_REGISTER = std::numeric_limits<std::uint32_t>::max();
+
+		DaedalusIrOpcode op {DaedalusIrOpcode::EXIT};
+
+		/// \brief The bytecode instruction executed by DaedalusIrOpcode::STACK.
+		DaedalusOpcode code {DaedalusOpcode::NOP};
+
+		/// \brief The number of entries of the #live set which are pushed onto the operand stack before the
+		///        instruction is executed, because it expects them there.
+		std::uint16_t spill_count {0};
+
+		/// \brief The number of values the bytecode interpreter has on the stack before executing #pc, but which
+		///        are still held in operands instead.
+		std::uint16_t live_count {0};
+
+		/// \brief The index of the first entry of the live set in DaedalusIrFunction::live.
+		std::uint32_t live_begin {0};
+
+		/// \brief The address of the bytecode instruction this instruction was lowered from.
+		std::uint32_t pc {0};
+
+		std::uint32_t arg {0};
+		DaedalusIrOperand a {};
+		DaedalusIrOperand b {};
+	};
+
+	/// \brief A script function lowered to registers.
+	///
+	/// Each result is assigned to a new register, so registers are never overwritten. Values live in registers
+	/// only within a basic block: at branches and calls, all values the bytecode interpreter would have on the
+	/// stack are pushed onto it, so each block starts with the stack as it would be in the interpreter.
+	///
+	/// Every instruction remembers the values the interpreter would have had on the stack before executing the
+	/// bytecode instruction it was lowered from. This allows abandoning the lowered code for the bytecode at any
+	/// instruction, which is done whenever an instruction fails.
+	struct DaedalusIrFunction {
+		std::vector<DaedalusIrInstruction> code;
+		std::vector<DaedalusIrOperand> live;
+		std::uint32_t registers {0};
+	};
+
+	/// \brief Lowers the given function to registers, folding constants, propagating copies of local variables and
+	///        removing branches on constant conditions.
+	/// \param script The script containing the function.
+	/// \param sym The function, prototype or instance to lower.
+	/// \param fold_constants Whether the values of constant symbols may be folded.
+	/// \return The lowered function or `nullptr` if \p sym has no code.
+	std::shared_ptr<DaedalusIrFunction const>
+	lower_function(DaedalusScript const& script, DaedalusSymbol const& sym, bool fold_constants);
+} // namespace zenkit
@@ -0,0 +1,172 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include "zenkit/DaedalusProfiler.hh"
+#include "zenkit/DaedalusScript.hh"
+#include "zenkit/Stream.hh"
+
+#include "Internal.hh"
+
+#include <cstdio>
+#include <string>
+
+namespace zenkit {
+	static constexpr auto NO_NODE = static_cast<std::uint32_t>(-1);
+
+	namespace {
+		std::string_view symbol_name(DaedalusScript const& script, std::uint32_t index) {
+			auto* sym = script.find_symbol_by_index(index);
+			return sym == nullptr ? std::string_view {"<unknown>"} : std::string_view {sym->name()};
+		}
+
+		double to_microseconds(DaedalusProfiler::Clock::duration d) {
+			return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()) / 1000.0;
+		}
+	} // namespace
+
+	DaedalusProfiler::DaedalusProfiler() {
+		this->reset();
+	}
+
+	void DaedalusProfiler::enter(DaedalusSymbol const& sym) {
+		auto index = sym.index();
+		if (index >= _m_entries.size()) {
+			_m_entries.resize(index + 1);
+			_m_active.resize(index + 1, 0);
+		}
+
+		// Find or create the call stack node of this call.
+		auto parent = _m_frames.empty() ? NO_NODE : _m_frames.back().node;
+		auto key = static_cast<std::uint64_t>(parent) << 32 | index;
+		auto [it, inserted] = _m_children.try_emplace(key, static_cast<std::uint32_t>(_m_nodes.size()));
+		if (inserted) {
+			_m_nodes.push_back({parent, index, 0, Clock::duration::zero()});
+		}
+
+		_m_entries[index].symbol = index;
+		_m_entries[index].calls += 1;
+		_m_active[index] += 1;
+
+		_m_frames.push_back({index, it->second, Clock::now(), _m_instructions, Clock::duration::zero(), 0});
+	}
+
+	void DaedalusProfiler::leave() {
+		if (_m_frames.empty()) return;
+
+		auto now = Clock::now();
+		auto frame = _m_frames.back();
+		_m_frames.pop_back();
+
+		auto time = now - frame.start;
+		auto instructions = _m_instructions - frame.instructions_start;
+
+		auto& entry = _m_entries[frame.symbol];
+		entry.instructions_exclusive += instructions - frame.children_instructions;
+		entry.time_exclusive += std::chrono::duration_cast<std::chrono::nanoseconds>(time - frame.children_time);
+
+		// Only count the outermost call of recursive functions, otherwise time would be counted more than once.
+		if (--_m_active[frame.symbol] == 0) {
+			entry.instructions_inclusive += instructions;
+			entry.time_inclusive += std::chrono::duration_cast<std::chrono::nanoseconds>(time);
+		}
+
+		auto& node = _m_nodes[frame.node];
+		node.instructions += instructions - frame.children_instructions;
+		node.time += time - frame.children_time;
+
+		if (!_m_frames.empty()) {
+			_m_frames.back().children_time += time;
+			_m_frames.back().children_instructions += instructions;
+		}
+
+		if (_m_trace) {
+			_m_events.push_back({frame.symbol, frame.start, time});
+		}
+	}
+
+	void DaedalusProfiler::unwind(std::size_t depth) {
+		while (_m_frames.size() > depth) {
+			leave();
+		}
+	}
+
+	void DaedalusProfiler::reset() {
+		_m_entries.clear();
+		_m_active.clear();
+		_m_frames.clear();
+		_m_nodes.clear();
+		_m_children.clear();
+		_m_events.clear();
+		_m_instructions = 0;
+		_m_epoch = Clock::now();
+	}
+
+	void DaedalusProfiler::set_trace_enabled(bool enable) noexcept {
+		_m_trace = enable;
+	}
+
+	std::vector<DaedalusProfileEntry> DaedalusProfiler::entries() const {
+		std::vector<DaedalusProfileEntry> entries;
+		for (auto& entry : _m_entries) {
+			if (entry.calls == 0) continue;
+			entries.push_back(entry);
+		}
+		return entries;
+	}
+
+	DaedalusProfileEntry const* DaedalusProfiler::entry(DaedalusSymbol const& sym) const {
+		if (sym.index() >= _m_entries.size() || _m_entries[sym.index()].calls == 0) return nullptr;
+		return &_m_entries[sym.index()];
+	}
+
+	void DaedalusProfiler::write_collapsed(Write* w, DaedalusScript const& script, DaedalusProfileMetric metric) const {
+		std::vector<std::uint32_t> path;
+		std::string line;
+
+		for (auto& node : _m_nodes) {
+			std::uint64_t value = 0;
+			if (metric == DaedalusProfileMetric::INSTRUCTIONS) {
+				value = node.instructions;
+			} else {
+				value = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(node.time).count());
+			}
+
+			if (value == 0) continue;
+
+			path.clear();
+			for (auto* n = &node; n != nullptr; n = n->parent == NO_NODE ? nullptr : &_m_nodes[n->parent]) {
+				path.push_back(n->symbol);
+			}
+
+			line.clear();
+			for (auto i = path.size(); i > 0; --i) {
+				line.append(symbol_name(script, path[i - 1]));
+				line.push_back(i > 1 ? ';' : ' ');
+			}
+
+			line.append(std::to_string(value));
+			w->write_line(line);
+		}
+	}
+
+	void DaedalusProfiler::write_chrome_trace(Write* w, DaedalusScript const& script) const {
+		w->write_string("{\"traceEvents\":[");
+
+		char buf[96];
+		for (auto i = 0u; i < _m_events.size(); ++i) {
+			auto& event = _m_events[i];
+
+			w->write_string(i == 0 ? "\n" : ",\n");
+			w->write_string("{\"name\":\"");
+			w->write_string(escape_json(symbol_name(script, event.symbol)));
+
+			std::snprintf(buf,
+			              sizeof buf,
+			              "\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+			              to_microseconds(event.start - _m_epoch),
+			              to_microseconds(event.duration));
+			w->write_string(buf);
+		}
+
+		w->write_string("\n]}\n");
+	}
+} // namespace zenkit
@@ -6,6 +6,9 @@
 #include "Internal.hh"
 
 #include <algorithm>
+#include <cstring>
+#include <future>
+#include <unordered_set>
 
 namespace zenkit {
 	DaedalusSymbolNotFound::DaedalusSymbolNotFound(std::string&& sym_name)
@@ -87,40 +90,351 @@ namespace zenkit {
 		return s;
 	}
 
+	DaedalusCompactInstruction DaedalusCompactInstruction::from(DaedalusInstruction const& instr) {
+		DaedalusCompactInstruction s {};
+		s.op = instr.op;
+		s.size = instr.size;
+		s.index = instr.index;
+
+		switch (instr.op) {
+		case DaedalusOpcode::BL:
+		case DaedalusOpcode::BZ:
+		case DaedalusOpcode::B:
+			s.arg = instr.address;
+			break;
+		case DaedalusOpcode::PUSHI:
+			s.arg = static_cast<std::uint32_t>(instr.immediate);
+			break;
+		default:
+			s.arg = instr.symbol;
+			break;
+		}
+
+		return s;
+	}
+
+	namespace {
+		bool is_comparison(DaedalusOpcode op) {
+			switch (op) {
+			case DaedalusOpcode::EQ:
+			case DaedalusOpcode::NEQ:
+			case DaedalusOpcode::LT:
+			case DaedalusOpcode::GT:
+			case DaedalusOpcode::LTE:
+			case DaedalusOpcode::GTE:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		/// \brief Replaces the first instruction of common instruction sequences with a superinstruction.
+		///
+		/// The other instructions of a sequence are left as-is, so jumps into the middle of a sequence keep working
+		/// and the VM can fall back to executing the sequence instruction by instruction.
+		void fuse_superinstructions(std::vector<DaedalusCompactInstruction>& code) {
+			auto at = [&code](std::size_t address) -> DaedalusCompactInstruction const* {
+				return address < code.size() && code[address].size != 0 ? &code[address] : nullptr;
+			};
+
+			for (std::size_t address = 0; address < code.size(); ++address) {
+				auto& instr = code[address];
+				if (instr.size == 0 || instr.op != DaedalusOpcode::PUSHI) continue;
+
+				auto next = address + instr.size;
+				auto* push = at(next);
+				if (push == nullptr) continue;
+
+				if (push->op == DaedalusOpcode::BE) {
+					instr.op = DaedalusOpcode::BE_IMM;
+					continue;
+				}
+
+				if (push->op != DaedalusOpcode::PUSHV && push->op != DaedalusOpcode::PUSHVV) continue;
+
+				next += push->size;
+				auto* op = at(next);
+				if (op == nullptr) continue;
+
+				if (op->op == DaedalusOpcode::MOVI) {
+					instr.op = DaedalusOpcode::MOVI_IMM;
+				} else if (auto* bz = at(next + op->size); is_comparison(op->op) && bz != nullptr &&
+				           bz->op == DaedalusOpcode::BZ) {
+					instr.op = DaedalusOpcode::BZ_CMP_IMM;
+				}
+			}
+		}
+
+		/// \brief Incrementally computes a 64-bit FNV-1a hash.
+		struct Fnv1a {
+			void update(void const* data, std::size_t size) noexcept {
+				auto const* bytes = static_cast<std::uint8_t const*>(data);
+				for (std::size_t i = 0; i < size; ++i) {
+					value = (value ^ bytes[i]) * 0x100000001B3;
+				}
+			}
+
+			template <typename T>
+			void update(T const& v) noexcept {
+				update(&v, sizeof v);
+			}
+
+			std::uint64_t value {0xCBF29CE484222325};
+		};
+	} // namespace
+
 	void DaedalusScript::load(Read* r) {
-		this->_m_version = r->read_ubyte();
+		auto begin = r->tell();
+		r->seek(0, Whence::END);
+		auto end = r->tell();
+		r->seek(static_cast<ssize_t>(begin), Whence::BEG);
+
+		// Reading the symbol table field by field through the stream is slow, so parse it from memory directly if
+		// possible, and read the whole script at once otherwise.
+		if (auto view = r->view(); !view.empty()) {
+			auto size = this->parse(view.subspan(begin, end - begin));
+			r->seek(static_cast<ssize_t>(begin + size), Whence::BEG);
+			return;
+		}
+
+		std::vector<std::byte> data(end - begin);
+		data.resize(r->read(data.data(), data.size()));
+
+		auto size = this->parse(data);
+		r->seek(static_cast<ssize_t>(begin + size), Whence::BEG);
+	}
+
+	void DaedalusScript::load(std::span<std::byte const> data) {
+		(void) this->parse(data);
+	}
+
+	std::vector<DaedalusScript> DaedalusScript::load_all(std::span<Read* const> readers) {
+		std::vector<std::future<DaedalusScript>> pending;
+		pending.reserve(readers.size());
+
+		for (auto* r : readers) {
+			pending.push_back(std::async(std::launch::async, [r] {
+				DaedalusScript script;
+				script.load(r);
+				return script;
+			}));
+		}
+
+		std::vector<DaedalusScript> scripts;
+		scripts.reserve(readers.size());
+
+		for (auto& future : pending) {
+			scripts.push_back(future.get());
+		}
+
+		return scripts;
+	}
+
+	std::size_t DaedalusScript::parse(std::span<std::byte const> data) {
+		ReadSpan cursor {data};
+		auto* r = &cursor;
+
+		auto image = std::make_shared<DaedalusScriptImage>();
+		image->version = r->read_ubyte();
+
 		auto symbol_count = r->read_uint();
+		image->symbol_count = symbol_count;
 
+		this->_m_symbols.clear();
 		this->_m_symbols.resize(symbol_count);
-		this->_m_symbols_by_name.reserve(symbol_count + 1);
-		this->_m_symbols_by_address.reserve(symbol_count);
+		image->symbols_by_name.reserve(symbol_count + 1);
+		image->symbols_by_address.reserve(symbol_count);
 
 		r->seek(static_cast<ssize_t>(symbol_count * sizeof(std::uint32_t)), Whence::CUR); // Sort table
 		// The sort table is a list of indexes into the symbol table sorted lexicographically by symbol name!
 
 		for (std::uint32_t i = 0; i < symbol_count; ++i) {
 			auto& sym = this->_m_symbols[i];
-			sym.load(r);
+			sym.load_from(r);
 
-			this->_m_symbols_by_name[sym.name()] = i;
+			image->symbols_by_name[sym.name()] = i;
 			sym._m_index = i;
 
 			if (sym.type() == DaedalusDataType::PROTOTYPE || sym.type() == DaedalusDataType::INSTANCE ||
 			    (sym.type() == DaedalusDataType::FUNCTION && sym.is_const() && !sym.is_member())) {
-				this->_m_symbols_by_address[sym.address()] = i;
+				image->symbols_by_address[sym.address()] = i;
+
+				sym._m_function = static_cast<std::uint32_t>(image->functions.size());
+				image->functions.push_back({i, 0, 0, 0, 0, 0});
 			}
 		}
 
+		for (auto& fn : image->functions) {
+			auto& sym = this->_m_symbols[fn.symbol];
+			fn.params_begin = std::min(fn.symbol + 1, symbol_count);
+			fn.params_count = std::min(sym.count(), symbol_count - fn.params_begin);
+			fn.locals_begin = fn.params_begin + fn.params_count;
+
+			// Locals follow the parameters and are named `<FUNCTION>.<LOCAL>`.
+			auto end = fn.locals_begin;
+			for (; end < symbol_count; ++end) {
+				auto& name = this->_m_symbols[end].name();
+				if (name.size() <= sym.name().size() || name[sym.name().size()] != '.' ||
+				    name.compare(0, sym.name().size(), sym.name()) != 0) {
+					break;
+				}
+
+				auto& local = this->_m_symbols[end];
+				switch (local.type()) {
+				case DaedalusDataType::FLOAT:
+				case DaedalusDataType::FUNCTION:
+				case DaedalusDataType::INT:
+				case DaedalusDataType::STRING:
+					fn.locals_footprint += local.count();
+					break;
+				case DaedalusDataType::INSTANCE:
+					fn.locals_footprint += 1;
+					break;
+				default:
+					break;
+				}
+			}
+
+			fn.locals_count = end - fn.locals_begin;
+		}
+
 		std::uint32_t text_size = r->read_uint();
-		std::vector code(text_size, std::byte {});
-		r->read(code.data(), text_size);
+		image->text.resize(text_size);
+		r->read(image->text.data(), text_size);
+
+		// Decode the entire code section up-front so that the VM never has to go through the stream again.
+		image->code.resize(text_size);
+
+		auto text = Read::from(&image->text);
+		while (text->tell() < text_size) {
+			auto address = static_cast<std::uint32_t>(text->tell());
+			auto& instr = image->code[address];
+			instr = DaedalusCompactInstruction::from(DaedalusInstruction::decode(text.get()));
+
+			// Resolve call targets now so that the VM does not have to look them up by address for every call.
+			if (instr.op == DaedalusOpcode::BL) {
+				if (auto it = image->symbols_by_address.find(instr.arg); it != image->symbols_by_address.end()) {
+					instr.arg = it->second;
+					instr.resolved = true;
+				}
+			}
+		}
+
+		fuse_superinstructions(image->code);
+
+		Fnv1a hash;
+		hash.update(image->version);
+		hash.update(symbol_count);
+		for (auto& sym : this->_m_symbols) {
+			hash.update(sym._m_name.data(), sym._m_name.size());
+			hash.update(sym._m_type);
+			hash.update(sym._m_flags);
+			hash.update(sym._m_count);
+			hash.update(sym._m_address);
+			hash.update(sym._m_parent);
+		}
+		hash.update(image->text.data(), image->text.size());
+		image->checksum = hash.value;
 
-		this->_m_text = Read::from(std::move(code));
+		this->_m_code = image->code;
+		this->_m_image = std::move(image);
+		return cursor.tell();
+	}
+
+	DaedalusScript DaedalusScript::fork(std::span<DaedalusSymbol const* const> shared) const {
+		DaedalusScript script {};
+		script._m_image = _m_image;
+		script._m_code = _m_code;
+		script._m_symbols.resize(_m_symbols.size());
+
+		std::unordered_set<DaedalusSymbol const*> shared_symbols {shared.begin(), shared.end()};
+
+		// Symbols added after loading, like the temporary strings of a DaedalusVm, are copied as well.
+		for (std::uint32_t i = 0; i < _m_symbols.size(); ++i) {
+			auto const& src = _m_symbols[i];
+			auto& dst = script._m_symbols[i];
+
+			dst._m_name = src._m_name;
+			dst._m_address = src._m_address;
+			dst._m_parent = src._m_parent;
+			dst._m_class_offset = src._m_class_offset;
+			dst._m_count = src._m_count;
+			dst._m_type = src._m_type;
+			dst._m_flags = src._m_flags & ~DaedalusSymbolFlag::OVERRIDDEN;
+			dst._m_generated = src._m_generated;
+			dst._m_file_index = src._m_file_index;
+			dst._m_line_start = src._m_line_start;
+			dst._m_line_count = src._m_line_count;
+			dst._m_char_start = src._m_char_start;
+			dst._m_char_count = src._m_char_count;
+			dst._m_member_offset = src._m_member_offset;
+			dst._m_class_size = src._m_class_size;
+			dst._m_return_type = src._m_return_type;
+			dst._m_index = src._m_index;
+			dst._m_registered_to = src._m_registered_to;
+			dst._m_function = src._m_function;
+
+			if (shared_symbols.contains(&src)) {
+				dst._m_value = src._m_value;
+				continue;
+			}
+
+			// Non-constant function symbols always store exactly one value.
+			auto length = src._m_type == DaedalusDataType::FUNCTION ? 1 : src._m_count;
+			std::visit(
+			    [&dst, length](auto const& value) {
+				    using T = std::remove_cvref_t<decltype(value)>;
+				    if constexpr (std::is_same_v<T, std::shared_ptr<DaedalusInstance>>) {
+					    dst._m_value = value;
+				    } else if (value != nullptr) {
+					    T copy {new typename T::element_type[length]};
+					    std::copy_n(value.get(), length, copy.get());
+					    dst._m_value = std::move(copy);
+				    }
+			    },
+			    src._m_value);
+		}
+
+		return script;
 	}
 
 	DaedalusInstruction DaedalusScript::instruction_at(std::uint32_t address) const {
-		_m_text->seek(address, Whence::BEG);
-		return DaedalusInstruction::decode(_m_text.get());
+		auto* compact = compact_instruction_at(address);
+		if (compact == nullptr) {
+			// Not the start of an instruction we know of, so decode whatever is there.
+			auto text = Read::from(&_m_image->text);
+			text->seek(address, Whence::BEG);
+			return DaedalusInstruction::decode(text.get());
+		}
+
+		DaedalusInstruction instr {};
+		instr.op = compact->original_op();
+		instr.size = compact->size;
+		instr.index = compact->index;
+
+		switch (instr.op) {
+		case DaedalusOpcode::BL:
+			instr.address = compact->resolved ? _m_symbols[compact->arg].address() : compact->arg;
+			break;
+		case DaedalusOpcode::BZ:
+		case DaedalusOpcode::B:
+			instr.address = compact->arg;
+			break;
+		case DaedalusOpcode::PUSHI:
+			instr.immediate = static_cast<std::int32_t>(compact->arg);
+			break;
+		case DaedalusOpcode::BE:
+		case DaedalusOpcode::PUSHV:
+		case DaedalusOpcode::PUSHVI:
+		case DaedalusOpcode::GMOVI:
+		case DaedalusOpcode::PUSHVV:
+			instr.symbol = compact->arg;
+			break;
+		default:
+			break;
+		}
+
+		return instr;
 	}
 
 	DaedalusSymbol const* DaedalusScript::find_symbol_by_index(std::uint32_t index) const {
@@ -131,10 +445,7 @@ namespace zenkit {
 	}
 
 	DaedalusSymbol const* DaedalusScript::find_symbol_by_name(std::string_view name) const {
-		std::string up {name};
-		std::transform(up.begin(), up.end(), up.begin(), toupper);
-
-		if (auto it = _m_symbols_by_name.find(up); it != _m_symbols_by_name.end()) {
+		if (auto it = _m_image->symbols_by_name.find(name); it != _m_image->symbols_by_name.end()) {
 			return find_symbol_by_index(it->second);
 		}
 
@@ -142,7 +453,7 @@ namespace zenkit {
 	}
 
 	DaedalusSymbol const* DaedalusScript::find_symbol_by_address(std::uint32_t address) const {
-		if (auto it = _m_symbols_by_address.find(address); it != _m_symbols_by_address.end()) {
+		if (auto it = _m_image->symbols_by_address.find(address); it != _m_image->symbols_by_address.end()) {
 			return find_symbol_by_index(it->second);
 		}
 
@@ -157,10 +468,7 @@ namespace zenkit {
 	}
 
 	DaedalusSymbol* DaedalusScript::find_symbol_by_name(std::string_view name) {
-		std::string up {name};
-		std::transform(up.begin(), up.end(), up.begin(), toupper);
-
-		if (auto it = _m_symbols_by_name.find(up); it != _m_symbols_by_name.end()) {
+		if (auto it = _m_image->symbols_by_name.find(name); it != _m_image->symbols_by_name.end()) {
 			return find_symbol_by_index(it->second);
 		}
 
@@ -168,7 +476,7 @@ namespace zenkit {
 	}
 
 	DaedalusSymbol* DaedalusScript::find_symbol_by_address(std::uint32_t address) {
-		if (auto it = _m_symbols_by_address.find(address); it != _m_symbols_by_address.end()) {
+		if (auto it = _m_image->symbols_by_address.find(address); it != _m_image->symbols_by_address.end()) {
 			return find_symbol_by_index(it->second);
 		}
 
@@ -198,6 +506,10 @@ namespace zenkit {
 	}
 
 	std::span<DaedalusSymbol> DaedalusScript::find_locals_for_function(DaedalusSymbol const* parent) {
+		if (auto* fn = find_function_info(parent); fn != nullptr) {
+			return std::span<DaedalusSymbol>(_m_symbols.begin() + fn->locals_begin, fn->locals_count);
+		}
+
 		std::uint32_t const first = parent->index() + 1 + parent->count();
 		for (size_t i = first; i < _m_symbols.size(); ++i) {
 			auto& name = _m_symbols[i].name();
@@ -215,6 +527,257 @@ namespace zenkit {
 		                                       _m_symbols.begin() + parent->index() + parent->count() + 1);
 	}
 
+	namespace {
+		/// \brief The kind of value in a stack slot, as tracked by DaedalusScript::verify_function.
+		enum class VerifiedSlot : std::uint8_t {
+			INT,
+			FLOAT,
+			INSTANCE,
+			REF_INT,
+			REF_FLOAT,
+			REF_STRING,
+			REF_INSTANCE,
+			REF_OTHER,
+		};
+
+		/// \return The kind of slot pushed when referencing a symbol of the given type.
+		VerifiedSlot verified_reference(DaedalusDataType type) {
+			switch (type) {
+			case DaedalusDataType::INT:
+			case DaedalusDataType::FUNCTION:
+				return VerifiedSlot::REF_INT;
+			case DaedalusDataType::FLOAT:
+				return VerifiedSlot::REF_FLOAT;
+			case DaedalusDataType::STRING:
+				return VerifiedSlot::REF_STRING;
+			case DaedalusDataType::INSTANCE:
+				return VerifiedSlot::REF_INSTANCE;
+			default:
+				return VerifiedSlot::REF_OTHER;
+			}
+		}
+
+		/// \return The kind of slot pushed when returning or passing a value of the given type.
+		VerifiedSlot verified_value(DaedalusDataType type) {
+			switch (type) {
+			case DaedalusDataType::INT:
+			case DaedalusDataType::FUNCTION:
+				return VerifiedSlot::INT;
+			case DaedalusDataType::FLOAT:
+				return VerifiedSlot::FLOAT;
+			case DaedalusDataType::INSTANCE:
+				return VerifiedSlot::INSTANCE;
+			default:
+				return verified_reference(type);
+			}
+		}
+
+		/// \return Whether a slot of the given kind can be popped as a value of the given type.
+		bool verified_accepts(DaedalusDataType type, VerifiedSlot slot) {
+			switch (type) {
+			case DaedalusDataType::INT:
+			case DaedalusDataType::FUNCTION:
+				return slot == VerifiedSlot::INT || slot == VerifiedSlot::REF_INT;
+			case DaedalusDataType::FLOAT:
+				// Float constants are pushed as integers.
+				return slot == VerifiedSlot::FLOAT || slot == VerifiedSlot::INT || slot == VerifiedSlot::REF_FLOAT;
+			case DaedalusDataType::STRING:
+				return slot == VerifiedSlot::REF_STRING;
+			case DaedalusDataType::INSTANCE:
+				return slot == VerifiedSlot::INSTANCE || slot == VerifiedSlot::REF_INSTANCE;
+			default:
+				return false;
+			}
+		}
+	} // namespace
+
+	DaedalusFunctionVerification DaedalusScript::verify_function(DaedalusSymbol const* sym) const {
+		DaedalusFunctionVerification result {};
+		auto fail = [&result](std::uint32_t address, std::string&& error) {
+			result.error_address = address;
+			result.error = std::move(error);
+			return result;
+		};
+
+		auto* fn = find_function_info(sym);
+		if (fn == nullptr || sym->is_external()) {
+			return fail(0, sym->name() + " is not a function");
+		}
+
+		std::vector<VerifiedSlot> stack;
+		for (auto i = 0u; i < fn->params_count; ++i) {
+			stack.push_back(verified_value(_m_symbols[fn->params_begin + i].type()));
+		}
+
+		auto pop = [&stack](DaedalusDataType type) {
+			if (stack.empty() || !verified_accepts(type, stack.back())) return false;
+			stack.pop_back();
+			return true;
+		};
+
+		auto pop_reference = [&stack](VerifiedSlot slot) {
+			if (stack.empty() || stack.back() != slot) return false;
+			stack.pop_back();
+			return true;
+		};
+
+		// The stack layout seen when first reaching an address. All other paths reaching it must agree.
+		std::unordered_map<std::uint32_t, std::vector<VerifiedSlot>> seen;
+		std::vector<std::pair<std::uint32_t, std::vector<VerifiedSlot>>> pending;
+		pending.emplace_back(sym->address(), std::move(stack));
+		result.max_stack_depth = fn->params_count;
+
+		while (!pending.empty()) {
+			auto address = pending.back().first;
+			stack = std::move(pending.back().second);
+			pending.pop_back();
+
+			for (auto done = false; !done;) {
+				if (auto [it, inserted] = seen.try_emplace(address, stack); !inserted) {
+					if (it->second != stack) return fail(address, "stack layout differs between paths");
+					break;
+				}
+
+				auto* instr = compact_instruction_at(address);
+				if (instr == nullptr) return fail(address, "not an instruction");
+
+				DaedalusSymbol const* target = nullptr;
+				auto next = address + instr->size;
+
+				switch (instr->original_op()) {
+				case DaedalusOpcode::ADD:
+				case DaedalusOpcode::SUB:
+				case DaedalusOpcode::MUL:
+				case DaedalusOpcode::DIV:
+				case DaedalusOpcode::MOD:
+				case DaedalusOpcode::OR:
+				case DaedalusOpcode::ANDB:
+				case DaedalusOpcode::LT:
+				case DaedalusOpcode::GT:
+				case DaedalusOpcode::ORR:
+				case DaedalusOpcode::AND:
+				case DaedalusOpcode::LSL:
+				case DaedalusOpcode::LSR:
+				case DaedalusOpcode::LTE:
+				case DaedalusOpcode::EQ:
+				case DaedalusOpcode::NEQ:
+				case DaedalusOpcode::GTE:
+					if (!pop(DaedalusDataType::INT) || !pop(DaedalusDataType::INT)) {
+						return fail(address, "expected two integers");
+					}
+					stack.push_back(VerifiedSlot::INT);
+					break;
+				case DaedalusOpcode::PLUS:
+				case DaedalusOpcode::NEGATE:
+				case DaedalusOpcode::NOT:
+				case DaedalusOpcode::CMPL:
+					if (!pop(DaedalusDataType::INT)) return fail(address, "expected an integer");
+					stack.push_back(VerifiedSlot::INT);
+					break;
+				case DaedalusOpcode::NOP:
+					break;
+				case DaedalusOpcode::RSR:
+					done = true;
+					break;
+				case DaedalusOpcode::B:
+					next = instr->arg;
+					break;
+				case DaedalusOpcode::BZ:
+					if (!pop(DaedalusDataType::INT)) return fail(address, "expected an integer");
+					pending.emplace_back(instr->arg, stack);
+					break;
+				case DaedalusOpcode::BL:
+				case DaedalusOpcode::BE: {
+					if (instr->op == DaedalusOpcode::BL) {
+						target = instr->resolved ? find_symbol_by_index(instr->arg) : nullptr;
+						if (target == nullptr) return fail(address, "call target is not a function");
+					} else {
+						target = find_symbol_by_index(instr->arg);
+						if (target == nullptr || !target->is_external()) return fail(address, "not an external");
+					}
+
+					auto* callee = find_function_info(target);
+					if (callee == nullptr || stack.size() < callee->params_count) {
+						return fail(address, "not enough arguments for " + target->name());
+					}
+
+					// Externals check their arguments themselves, so only the arguments of script functions
+					// need to have the right types.
+					for (auto i = callee->params_count; i > 0; --i) {
+						if (instr->op == DaedalusOpcode::BE) {
+							stack.pop_back();
+						} else if (!pop(_m_symbols[callee->params_begin + i - 1].type())) {
+							return fail(address, "wrong argument type for " + target->name());
+						}
+					}
+
+					if (target->has_return()) {
+						stack.push_back(verified_value(target->rtype()));
+					}
+					break;
+				}
+				case DaedalusOpcode::PUSHI:
+					stack.push_back(VerifiedSlot::INT);
+					break;
+				case DaedalusOpcode::PUSHV:
+				case DaedalusOpcode::PUSHVI:
+				case DaedalusOpcode::PUSHVV:
+					target = find_symbol_by_index(instr->arg);
+					if (target == nullptr) return fail(address, "no symbol with index " + std::to_string(instr->arg));
+
+					// Access traps may replace the value, so it is not known statically.
+					if (target->has_access_trap()) return fail(address, "access trap on " + target->name());
+
+					if (instr->index >= target->count()) {
+						return fail(address, "index out of range for " + target->name());
+					}
+
+					stack.push_back(verified_reference(target->type()));
+					break;
+				case DaedalusOpcode::MOVI:
+				case DaedalusOpcode::MOVVF:
+				case DaedalusOpcode::ADDMOVI:
+				case DaedalusOpcode::SUBMOVI:
+				case DaedalusOpcode::MULMOVI:
+				case DaedalusOpcode::DIVMOVI:
+					if (!pop_reference(VerifiedSlot::REF_INT) || !pop(DaedalusDataType::INT)) {
+						return fail(address, "expected an integer assignment");
+					}
+					break;
+				case DaedalusOpcode::MOVF:
+					if (!pop_reference(VerifiedSlot::REF_FLOAT) || !pop(DaedalusDataType::FLOAT)) {
+						return fail(address, "expected a float assignment");
+					}
+					break;
+				case DaedalusOpcode::MOVS:
+					if (!pop_reference(VerifiedSlot::REF_STRING) || !pop(DaedalusDataType::STRING)) {
+						return fail(address, "expected a string assignment");
+					}
+					break;
+				case DaedalusOpcode::MOVVI:
+					if (!pop_reference(VerifiedSlot::REF_INSTANCE) || !pop(DaedalusDataType::INSTANCE)) {
+						return fail(address, "expected an instance assignment");
+					}
+					break;
+				case DaedalusOpcode::GMOVI:
+					target = find_symbol_by_index(instr->arg);
+					if (target == nullptr || target->type() != DaedalusDataType::INSTANCE) {
+						return fail(address, "not an instance");
+					}
+					break;
+				default:
+					return fail(address, "unsupported instruction");
+				}
+
+				result.max_stack_depth = std::max(result.max_stack_depth, static_cast<std::uint32_t>(stack.size()));
+				address = next;
+			}
+		}
+
+		result.verified = true;
+		return result;
+	}
+
 	std::vector<DaedalusSymbol*> DaedalusScript::find_class_members(DaedalusSymbol const& cls) {
 		std::vector<DaedalusSymbol*> members {};
 
@@ -226,6 +789,53 @@ namespace zenkit {
 		return members;
 	}
 
+	DaedalusMemberAccessor DaedalusScript::bind_members(std::string_view cls,
+	                                                   std::span<std::string_view const> members) const {
+		auto* cls_sym = find_symbol_by_name(cls);
+		if (cls_sym == nullptr) throw DaedalusSymbolNotFound {std::string {cls}};
+		if (cls_sym->_m_registered_to == nullptr) throw DaedalusUnboundMemberAccess {cls_sym};
+
+		DaedalusMemberAccessor accessor;
+		accessor._m_class = cls_sym;
+		accessor._m_type = cls_sym->_m_registered_to;
+		accessor._m_members.reserve(members.size());
+
+		for (auto name : members) {
+			auto* sym = find_symbol_by_name(name);
+			if (sym == nullptr) throw DaedalusSymbolNotFound {std::string {name}};
+			if (!sym->is_member() || sym->parent() != cls_sym->index())
+				throw DaedalusMemberRegistrationError {sym, "not a member of " + cls_sym->name()};
+			if (sym->_m_member_offset == static_cast<std::uint32_t>(-1)) throw DaedalusUnboundMemberAccess {sym};
+
+			accessor._m_members.push_back({sym, sym->_m_member_offset, sym->count()});
+		}
+
+		return accessor;
+	}
+
+	void DaedalusMemberAccessor::check(DaedalusInstance const& inst) const {
+		if (matches(inst)) return;
+		throw DaedalusIllegalContextType {_m_class, inst._m_type != nullptr ? *inst._m_type : typeid(inst)};
+	}
+
+	std::uint32_t DaedalusMemberAccessor::prepare(std::size_t member,
+	                                              DaedalusDataType type,
+	                                              std::size_t instances,
+	                                              std::size_t values) const {
+		auto const& m = _m_members.at(member);
+		auto actual = m.symbol->type();
+
+		if (actual != type && !(type == DaedalusDataType::INT && actual == DaedalusDataType::FUNCTION)) {
+			throw DaedalusIllegalTypeAccess {m.symbol, type};
+		}
+
+		if (values < instances * m.count) {
+			throw DaedalusIllegalIndexAccess {m.symbol, values};
+		}
+
+		return m.count;
+	}
+
 	void DaedalusScript::register_as_opaque(DaedalusSymbol* sym) {
 		auto members = find_class_members(*sym);
 
@@ -272,18 +882,14 @@ namespace zenkit {
 		sym._m_generated = true;
 		sym._m_type = DaedalusDataType::STRING;
 		sym._m_count = 1;
-		sym._m_value = std::unique_ptr<std::string[]> {new std::string[sym._m_count]};
+		sym._m_value = std::shared_ptr<std::string[]> {new std::string[sym._m_count]};
 		sym._m_index = static_cast<std::uint32_t>(_m_symbols.size());
 
 		return &_m_symbols.emplace_back(std::move(sym));
 	}
 
 	std::uint32_t DaedalusScript::size() const noexcept {
-		auto off = _m_text->tell();
-		_m_text->seek(0, Whence::END);
-		auto size = _m_text->tell();
-		_m_text->seek(static_cast<ssize_t>(off), Whence::BEG);
-		return static_cast<uint32_t>(size);
+		return static_cast<uint32_t>(_m_code.size());
 	}
 
 	void zk_internal_escape(std::string& s) {
@@ -306,6 +912,11 @@ namespace zenkit {
 	}
 
 	void DaedalusSymbol::load(Read* r) {
+		this->load_from(r);
+	}
+
+	template <typename R>
+	void DaedalusSymbol::load_from(R* r) {
 		if (r->read_uint() != 0) {
 			this->_m_name = r->read_line(false);
 
@@ -340,19 +951,19 @@ namespace zenkit {
 		if (!this->is_member()) {
 			switch (this->_m_type) {
 			case DaedalusDataType::FLOAT: {
-				std::unique_ptr<float[]> value {new float[this->_m_count]};
+				std::shared_ptr<float[]> value {new float[this->_m_count]};
 				r->read(value.get(), this->_m_count * sizeof(float));
 				this->_m_value = std::move(value);
 				break;
 			}
 			case DaedalusDataType::INT: {
-				std::unique_ptr<std::int32_t[]> value {new std::int32_t[this->_m_count]};
+				std::shared_ptr<std::int32_t[]> value {new std::int32_t[this->_m_count]};
 				r->read(value.get(), this->_m_count * sizeof(std::uint32_t));
 				this->_m_value = std::move(value);
 				break;
 			}
 			case DaedalusDataType::STRING: {
-				std::unique_ptr<std::string[]> value {new std::string[this->_m_count]};
+				std::shared_ptr<std::string[]> value {new std::string[this->_m_count]};
 				for (std::uint32_t i = 0; i < this->_m_count; ++i) {
 					value[i] = r->read_line(false);
 					zk_internal_escape(value[i]);
@@ -369,7 +980,7 @@ namespace zenkit {
 				break;
 			case DaedalusDataType::FUNCTION:
 				if (!this->is_const()) {
-					this->_m_value = std::unique_ptr<std::int32_t[]>(new int32_t[1]);
+					this->_m_value = std::shared_ptr<std::int32_t[]>(new int32_t[1]);
 				}
 				this->_m_address = r->read_int();
 				break;
@@ -430,7 +1041,7 @@ namespace zenkit {
 			return *get_member_ptr<std::string>(index, context);
 		}
 
-		return std::get<std::unique_ptr<std::string[]>>(_m_value)[index];
+		return std::get<std::shared_ptr<std::string[]>>(_m_value)[index];
 	}
 
 	float DaedalusSymbol::get_float(std::uint16_t index, DaedalusInstance const* context) const {
@@ -454,7 +1065,7 @@ namespace zenkit {
 			return *get_member_ptr<float>(static_cast<uint8_t>(index), context);
 		}
 
-		return std::get<std::unique_ptr<float[]>>(_m_value)[index];
+		return std::get<std::shared_ptr<float[]>>(_m_value)[index];
 	}
 
 	std::int32_t DaedalusSymbol::get_int(std::uint16_t index, DaedalusInstance const* context) const {
@@ -478,7 +1089,7 @@ namespace zenkit {
 			return *get_member_ptr<std::int32_t>(index, context);
 		}
 
-		return std::get<std::unique_ptr<std::int32_t[]>>(_m_value)[index];
+		return std::get<std::shared_ptr<std::int32_t[]>>(_m_value)[index];
 	}
 
 	void DaedalusSymbol::set_string(std::string_view value, std::uint16_t index, DaedalusInstance* context) {
@@ -502,7 +1113,7 @@ namespace zenkit {
 
 			*get_member_ptr<std::string>(index, context) = value;
 		} else {
-			std::get<std::unique_ptr<std::string[]>>(_m_value).get()[index] = value;
+			std::get<std::shared_ptr<std::string[]>>(_m_value).get()[index] = value;
 		}
 	}
 
@@ -527,7 +1138,7 @@ namespace zenkit {
 
 			*get_member_ptr<float>(index, context) = value;
 		} else {
-			std::get<std::unique_ptr<float[]>>(_m_value)[index] = value;
+			std::get<std::shared_ptr<float[]>>(_m_value)[index] = value;
 		}
 	}
 
@@ -552,7 +1163,7 @@ namespace zenkit {
 
 			*get_member_ptr<std::int32_t>(index, context) = value;
 		} else {
-			std::get<std::unique_ptr<std::int32_t[]>>(_m_value)[index] = value;
+			std::get<std::shared_ptr<std::int32_t[]>>(_m_value)[index] = value;
 		}
 	}
 
@@ -575,9 +1186,9 @@ namespace zenkit {
 	void DaedalusSymbol::grow(uint32_t n) {
 		auto& value = this->_m_value;
 
-		if (std::holds_alternative<std::unique_ptr<std::string[]>>(value)) {
-			auto new_value = std::make_unique<std::string[]>(this->_m_count + n);
-			auto& old_value = std::get<std::unique_ptr<std::string[]>>(value);
+		if (std::holds_alternative<std::shared_ptr<std::string[]>>(value)) {
+			auto new_value = std::shared_ptr<std::string[]>(new std::string[this->_m_count + n]);
+			auto& old_value = std::get<std::shared_ptr<std::string[]>>(value);
 
 			// Move strings from the current value into the new, larger array.
 			for (uint32_t i = 0; i < this->_m_count; ++i) {
@@ -585,15 +1196,15 @@ namespace zenkit {
 			}
 
 			this->_m_value = std::move(new_value);
-		} else if (std::holds_alternative<std::unique_ptr<std::int32_t[]>>(value)) {
-			auto new_value = std::make_unique<std::int32_t[]>(this->_m_count + n);
-			auto& old_value = std::get<std::unique_ptr<std::int32_t[]>>(value);
+		} else if (std::holds_alternative<std::shared_ptr<std::int32_t[]>>(value)) {
+			auto new_value = std::shared_ptr<std::int32_t[]>(new std::int32_t[this->_m_count + n]());
+			auto& old_value = std::get<std::shared_ptr<std::int32_t[]>>(value);
 
 			std::copy_n(&old_value[0], this->_m_count, &new_value[0]);
 			this->_m_value = std::move(new_value);
-		} else if (std::holds_alternative<std::unique_ptr<float[]>>(value)) {
-			auto new_value = std::make_unique<float[]>(this->_m_count + n);
-			auto& old_value = std::get<std::unique_ptr<float[]>>(value);
+		} else if (std::holds_alternative<std::shared_ptr<float[]>>(value)) {
+			auto new_value = std::shared_ptr<float[]>(new float[this->_m_count + n]());
+			auto& old_value = std::get<std::shared_ptr<float[]>>(value);
 
 			std::copy_n(&old_value[0], this->_m_count, &new_value[0]);
 			this->_m_value = std::move(new_value);
@@ -0,0 +1,76 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include "zenkit/DaedalusTrace.hh"
+#include "zenkit/Stream.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <string>
+
+namespace zenkit {
+	DaedalusTrace::DaedalusTrace(std::uint32_t capacity) {
+		auto size = std::bit_ceil(std::max(capacity, std::uint32_t {1}));
+
+		_m_mask = size - 1;
+		_m_entries = std::make_unique<std::atomic<std::uint64_t>[]>(std::size_t {size} * 2);
+		this->reset();
+	}
+
+	void DaedalusTrace::reset() noexcept {
+		// Entries are validated using their index, so stale entries must not match the indices used after the reset.
+		for (std::size_t i = 0; i < std::size_t {capacity()} * 2; ++i) {
+			_m_entries[i].store(INVALID, std::memory_order_relaxed);
+		}
+
+		_m_head.store(0, std::memory_order_release);
+	}
+
+	std::vector<DaedalusTraceEntry> DaedalusTrace::entries() const {
+		auto head = _m_head.load(std::memory_order_acquire);
+		auto begin = head > capacity() ? head - capacity() : 0;
+
+		std::vector<DaedalusTraceEntry> out;
+		out.reserve(head - begin);
+
+		for (auto i = begin; i < head; ++i) {
+			auto const* slot = &_m_entries[(i & _m_mask) * 2];
+
+			auto meta = slot[1].load(std::memory_order_acquire);
+			auto data = slot[0].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			// The entry was overwritten while reading it.
+			if (meta != slot[1].load(std::memory_order_relaxed) || meta >> 24 != (i & SEQUENCE_MASK)) continue;
+
+			DaedalusTraceEntry entry;
+			entry.pc = static_cast<std::uint32_t>(data);
+			entry.function = static_cast<std::uint32_t>(data >> 32);
+			entry.stack_depth = static_cast<std::uint16_t>(meta >> 8);
+			entry.op = static_cast<DaedalusOpcode>(meta & 0xFF);
+			out.push_back(entry);
+		}
+
+		return out;
+	}
+
+	void DaedalusTrace::write(Write* w, DaedalusScript const& script, std::uint32_t limit) const {
+		auto items = this->entries();
+		auto first = items.size() > limit ? items.size() - limit : 0;
+
+		for (auto i = first; i < items.size(); ++i) {
+			auto const& entry = items[i];
+			auto const* sym = script.find_symbol_by_index(entry.function);
+
+			char buf[48];
+			std::snprintf(buf,
+			              sizeof buf,
+			              " %08x %02x %u",
+			              entry.pc,
+			              static_cast<unsigned>(entry.op),
+			              static_cast<unsigned>(entry.stack_depth));
+
+			w->write_line((sym == nullptr ? std::string {"<unknown>"} : sym->name()) + buf);
+		}
+	}
+} // namespace zenkit
@@ -0,0 +1,310 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include "zenkit/DaedalusTranslator.hh"
+#include "zenkit/DaedalusScript.hh"
+#include "zenkit/Stream.hh"
+
+#include <cstdio>
+#include <limits>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace zenkit {
+	namespace {
+		/// \brief The code of a function which is going to be translated.
+		struct FunctionBody {
+			std::set<std::uint32_t> instructions; ///< The addresses of all reachable instructions.
+			std::set<std::uint32_t> labels;       ///< The addresses of all branch targets.
+		};
+
+		bool is_translatable(DaedalusOpcode op) {
+			switch (op) {
+			case DaedalusOpcode::ADD:
+			case DaedalusOpcode::SUB:
+			case DaedalusOpcode::MUL:
+			case DaedalusOpcode::DIV:
+			case DaedalusOpcode::MOD:
+			case DaedalusOpcode::OR:
+			case DaedalusOpcode::ANDB:
+			case DaedalusOpcode::LT:
+			case DaedalusOpcode::GT:
+			case DaedalusOpcode::MOVI:
+			case DaedalusOpcode::ORR:
+			case DaedalusOpcode::AND:
+			case DaedalusOpcode::LSL:
+			case DaedalusOpcode::LSR:
+			case DaedalusOpcode::LTE:
+			case DaedalusOpcode::EQ:
+			case DaedalusOpcode::NEQ:
+			case DaedalusOpcode::GTE:
+			case DaedalusOpcode::ADDMOVI:
+			case DaedalusOpcode::SUBMOVI:
+			case DaedalusOpcode::MULMOVI:
+			case DaedalusOpcode::DIVMOVI:
+			case DaedalusOpcode::PLUS:
+			case DaedalusOpcode::NEGATE:
+			case DaedalusOpcode::NOT:
+			case DaedalusOpcode::CMPL:
+			case DaedalusOpcode::NOP:
+			case DaedalusOpcode::RSR:
+			case DaedalusOpcode::BL:
+			case DaedalusOpcode::BE:
+			case DaedalusOpcode::PUSHI:
+			case DaedalusOpcode::PUSHV:
+			case DaedalusOpcode::PUSHVI:
+			case DaedalusOpcode::MOVS:
+			case DaedalusOpcode::MOVSS:
+			case DaedalusOpcode::MOVVF:
+			case DaedalusOpcode::MOVF:
+			case DaedalusOpcode::MOVVI:
+			case DaedalusOpcode::B:
+			case DaedalusOpcode::BZ:
+			case DaedalusOpcode::GMOVI:
+			case DaedalusOpcode::PUSHVV:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		/// \brief Collects all instructions reachable from the start of the given function.
+		/// \return `false` if the function can not be translated.
+		bool collect_function_body(DaedalusScript const& script, DaedalusSymbol const& sym, FunctionBody& body) {
+			if (sym.is_external() || script.find_function_info(&sym) == nullptr) return false;
+
+			std::vector<std::uint32_t> pending {sym.address()};
+			while (!pending.empty()) {
+				auto pc = pending.back();
+				pending.pop_back();
+
+				for (;;) {
+					if (!body.instructions.insert(pc).second) break;
+
+					auto const* instr = script.compact_instruction_at(pc);
+					if (instr == nullptr) return false;
+
+					auto op = instr->original_op();
+					if (!is_translatable(op)) return false;
+
+					if (op == DaedalusOpcode::RSR) break;
+					if (op == DaedalusOpcode::BL && !instr->resolved) return false;
+
+					if (op == DaedalusOpcode::B || op == DaedalusOpcode::BZ) {
+						body.labels.insert(instr->arg);
+						pending.push_back(instr->arg);
+						if (op == DaedalusOpcode::B) break;
+					}
+
+					pc += instr->size;
+				}
+			}
+
+			return true;
+		}
+
+		std::string comment_safe(std::string_view name) {
+			std::string out {name};
+			for (auto& c : out) {
+				auto u = static_cast<unsigned char>(c);
+				if (u < 0x20 || u >= 0x7F) c = '?';
+			}
+			return out;
+		}
+
+		std::string int_literal(std::int32_t v) {
+			// The negation of the smallest integer does not fit into an int, so it can't be written as a literal.
+			if (v == std::numeric_limits<std::int32_t>::min()) return "-2147483647 - 1";
+			return std::to_string(v);
+		}
+
+		std::string binary(char const* expression) {
+			return std::string {"{ auto a = vm.pop_int(); auto b = vm.pop_int(); vm.push_int("} + expression + "); }";
+		}
+
+		std::string translate(DaedalusCompactInstruction const& instr) {
+			auto arg = std::to_string(instr.arg);
+
+			switch (instr.original_op()) {
+			case DaedalusOpcode::ADD:
+				return binary("a + b");
+			case DaedalusOpcode::SUB:
+				return binary("a - b");
+			case DaedalusOpcode::MUL:
+				return binary("a * b");
+			case DaedalusOpcode::DIV:
+				return "{ auto a = vm.pop_int(); auto b = vm.pop_int(); "
+				       "if (b == 0) throw zenkit::DaedalusVmException {\"vm: division by zero\"}; "
+				       "vm.push_int(a / b); }";
+			case DaedalusOpcode::MOD:
+				return "{ auto a = vm.pop_int(); auto b = vm.pop_int(); "
+				       "if (b == 0) throw zenkit::DaedalusVmException {\"vm: division by zero\"}; "
+				       "vm.push_int(a % b); }";
+			case DaedalusOpcode::OR:
+				return binary("a | b");
+			case DaedalusOpcode::ANDB:
+				return binary("a & b");
+			case DaedalusOpcode::LT:
+				return binary("a < b");
+			case DaedalusOpcode::GT:
+				return binary("a > b");
+			case DaedalusOpcode::LSL:
+				return binary("a << b");
+			case DaedalusOpcode::LSR:
+				return binary("a >> b");
+			case DaedalusOpcode::LTE:
+				return binary("a <= b");
+			case DaedalusOpcode::EQ:
+				return binary("a == b");
+			case DaedalusOpcode::NEQ:
+				return binary("a != b");
+			case DaedalusOpcode::GTE:
+				return binary("a >= b");
+			case DaedalusOpcode::ORR:
+				return binary("a || b");
+			case DaedalusOpcode::AND:
+				return binary("a && b");
+			case DaedalusOpcode::PLUS:
+				return "vm.push_int(+vm.pop_int());";
+			case DaedalusOpcode::NEGATE:
+				return "vm.push_int(-vm.pop_int());";
+			case DaedalusOpcode::NOT:
+				return "vm.push_int(!vm.pop_int());";
+			case DaedalusOpcode::CMPL:
+				return "vm.push_int(~vm.pop_int());";
+			case DaedalusOpcode::NOP:
+				return "// nop";
+			case DaedalusOpcode::RSR:
+				return "return;";
+			case DaedalusOpcode::BL:
+				return "vm.native_bl(" + arg + ");";
+			case DaedalusOpcode::BE:
+				return "vm.native_be(" + arg + ");";
+			case DaedalusOpcode::PUSHI:
+				return "vm.push_int(" + int_literal(static_cast<std::int32_t>(instr.arg)) + ");";
+			case DaedalusOpcode::PUSHV:
+			case DaedalusOpcode::PUSHVI:
+				return "vm.native_pushv(" + arg + ");";
+			case DaedalusOpcode::PUSHVV:
+				return "vm.native_pushvv(" + arg + ", " + std::to_string(instr.index) + ");";
+			case DaedalusOpcode::MOVI:
+			case DaedalusOpcode::MOVVF:
+				return "vm.native_movi();";
+			case DaedalusOpcode::MOVF:
+				return "vm.native_movf();";
+			case DaedalusOpcode::MOVS:
+				return "vm.native_movs();";
+			case DaedalusOpcode::MOVSS:
+				return "throw zenkit::DaedalusVmException {\"not implemented: movss\"};";
+			case DaedalusOpcode::ADDMOVI:
+				return "vm.native_addmovi();";
+			case DaedalusOpcode::SUBMOVI:
+				return "vm.native_submovi();";
+			case DaedalusOpcode::MULMOVI:
+				return "vm.native_mulmovi();";
+			case DaedalusOpcode::DIVMOVI:
+				return "vm.native_divmovi();";
+			case DaedalusOpcode::MOVVI:
+				return "vm.native_movvi();";
+			case DaedalusOpcode::GMOVI:
+				return "vm.native_gmovi(" + arg + ");";
+			case DaedalusOpcode::B:
+				return "goto L" + arg + ";";
+			case DaedalusOpcode::BZ:
+				return "if (vm.pop_int() == 0) goto L" + arg + ";";
+			default:
+				return "";
+			}
+		}
+	} // namespace
+
+	DaedalusTranslator::DaedalusTranslator(DaedalusScript const& script) : _m_script(script) {}
+
+	bool DaedalusTranslator::can_translate(DaedalusSymbol const& sym) const {
+		FunctionBody body;
+		return collect_function_body(_m_script, sym, body);
+	}
+
+	std::uint32_t DaedalusTranslator::write_source(Write* w, std::string_view module) const {
+		char checksum[24];
+		std::snprintf(checksum, sizeof checksum, "0x%016llx", static_cast<unsigned long long>(_m_script.checksum()));
+
+		w->write_line("// Translated from a Daedalus script with checksum " + std::string {checksum} +
+		              " by DaedalusTranslator.");
+		w->write_line("// Do not edit. Changes to the script require translating it again.");
+		w->write_line("#include <zenkit/DaedalusVm.hh>");
+		w->write_line("");
+		w->write_line("#include <cstdint>");
+		w->write_line("");
+		w->write_line("namespace {");
+
+		std::vector<std::uint32_t> translated;
+		for (auto& fn : _m_script.functions()) {
+			auto const* sym = _m_script.find_symbol_by_index(fn.symbol);
+
+			FunctionBody body;
+			if (!collect_function_body(_m_script, *sym, body)) continue;
+
+			// Every instruction is a case of the switch, so that execution can continue after any of them once the
+			// exception handler has dealt with an error. Branches jump to labels directly.
+			w->write_line("\t// " + comment_safe(sym->name()));
+			w->write_line("\tvoid f" + std::to_string(fn.symbol) + "(zenkit::DaedalusVm& vm) {");
+			w->write_line("\t\tstd::uint32_t pc = " + std::to_string(sym->address()) + ";");
+			w->write_line("\t\tfor (;;) {");
+			w->write_line("\t\t\ttry {");
+			w->write_line("\t\t\t\tswitch (pc) {");
+
+			for (auto address : body.instructions) {
+				auto const& instr = *_m_script.compact_instruction_at(address);
+				auto label = std::to_string(address);
+
+				w->write_line("\t\t\t\tcase " + label + ":");
+				if (body.labels.contains(address)) {
+					w->write_line("\t\t\t\tL" + label + ":");
+				}
+
+				w->write_line("\t\t\t\t\tpc = " + label + ";");
+				w->write_line("\t\t\t\t\t" + translate(instr));
+
+				if (instr.original_op() != DaedalusOpcode::RSR && instr.original_op() != DaedalusOpcode::B) {
+					w->write_line("\t\t\t\t\t[[fallthrough]];");
+				}
+			}
+
+			w->write_line("\t\t\t\tdefault:");
+			w->write_line("\t\t\t\t\treturn;");
+			w->write_line("\t\t\t\t}");
+			w->write_line("\t\t\t} catch (zenkit::DaedalusScriptError const& err) {");
+			w->write_line("\t\t\t\tif (!vm.native_handle_error(err, pc)) return;");
+			w->write_line("\t\t\t}");
+			w->write_line("\t\t}");
+			w->write_line("\t}");
+			w->write_line("");
+			translated.push_back(fn.symbol);
+		}
+
+		if (!translated.empty()) {
+			w->write_line("\tzenkit::DaedalusNativeFunctionEntry const FUNCTIONS[] = {");
+			for (auto symbol : translated) {
+				w->write_line("\t    {" + std::to_string(symbol) + ", f" + std::to_string(symbol) + "},");
+			}
+			w->write_line("\t};");
+		}
+
+		w->write_line("} // namespace");
+		w->write_line("");
+
+		auto module_name = std::string {module};
+		auto functions = translated.empty() ? std::string {"{}"} : std::string {"FUNCTIONS"};
+		w->write_line("extern zenkit::DaedalusNativeModule const " + module_name + ";");
+		w->write_line("zenkit::DaedalusNativeModule const " + module_name + " {" + checksum + "ULL, " + functions +
+		              "};");
+		w->write_line("");
+		w->write_line("namespace {");
+		w->write_line("\t[[maybe_unused]] bool const REGISTERED = (zenkit::register_native_module(" + module_name +
+		              "), true);");
+		w->write_line("} // namespace");
+
+		return static_cast<std::uint32_t>(translated.size());
+	}
+} // namespace zenkit
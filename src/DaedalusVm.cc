@@ -2,10 +2,31 @@
 // SPDX-License-Identifier: MIT
 #include "zenkit/DaedalusVm.hh"
 
+#include "DaedalusIr.hh"
 #include "Internal.hh"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <unordered_set>
 #include <utility>
 
+// Profiling hooks. These compile to nothing unless ZenKit is built with `ZK_ENABLE_VM_PROFILER`.
+#ifdef _ZK_WITH_VM_PROFILER
+#define ZK_VM_PROFILE(call)                                                                                            \
+	do {                                                                                                               \
+		if (_m_profiler != nullptr) _m_profiler->call;                                                                 \
+	} while (false)
+#else
+#define ZK_VM_PROFILE(call)                                                                                            \
+	do {                                                                                                               \
+	} while (false)
+#endif
+
 namespace zenkit {
 	/// \brief A helper class for preventing stack corruption.
 	///
@@ -75,15 +96,141 @@ namespace zenkit {
 		bool _m_inhibited {false};
 	};
 
+	/// \brief A helper class for restoring the call stack after a script error.
+	///
+	/// Script errors which are not handled by the exception handler propagate out of the interpreter loop
+	/// without popping the call stack frames of the functions they interrupted. If an exception leaves the
+	/// scope of this guard, those frames are popped, the stack pointer is restored and the calls recorded by
+	/// the profiler are closed, so that the VM is in the same state as before the call.
+	struct CallGuard {
+		/// \brief Creates a new call guard.
+		/// \param machine The VM this instance is guarding.
+		/// \param call_stack_size The size of the call stack to restore if the guard is triggered.
+		/// \param stack_ptr The stack pointer to restore if the guard is triggered.
+		CallGuard(DaedalusVm* machine, std::size_t call_stack_size, std::uint32_t stack_ptr)
+		    : _m_machine(machine), _m_call_stack_size(call_stack_size), _m_stack_ptr(stack_ptr) {
+			if (auto* profiler = machine->profiler(); profiler != nullptr) {
+				_m_profiler_depth = profiler->depth();
+			}
+		}
+
+		/// \brief Triggers this guard if an exception is propagating.
+		~CallGuard() {
+			if (std::uncaught_exceptions() <= _m_exceptions) return;
+			_m_machine->unwind_call_stack(_m_call_stack_size, _m_stack_ptr);
+
+			// Externals called without a call stack frame are only known to the profiler.
+			if (auto* profiler = _m_machine->profiler(); profiler != nullptr) {
+				profiler->unwind(_m_profiler_depth);
+			}
+		}
+
+	private:
+		DaedalusVm* _m_machine;
+		std::size_t _m_call_stack_size;
+		std::uint32_t _m_stack_ptr;
+		std::size_t _m_profiler_depth {0};
+		int _m_exceptions {std::uncaught_exceptions()};
+	};
+
+	namespace {
+		std::mutex native_modules_lock;
+
+		std::vector<DaedalusNativeModule const*>& native_modules() {
+			static std::vector<DaedalusNativeModule const*> modules;
+			return modules;
+		}
+	} // namespace
+
+	void register_native_module(DaedalusNativeModule const& module) {
+		std::lock_guard lock {native_modules_lock};
+		native_modules().push_back(&module);
+	}
+
 	DaedalusVm::DaedalusVm(DaedalusScript&& scr, std::uint8_t flags) : DaedalusScript(std::move(scr)), _m_flags(flags) {
 		_m_temporary_strings = add_temporary_strings_symbol();
-		_m_temporary_strings_free.push(0);
 
 		_m_self_sym = find_symbol_by_name("SELF");
 		_m_other_sym = find_symbol_by_name("OTHER");
 		_m_victim_sym = find_symbol_by_name("VICTIM");
 		_m_hero_sym = find_symbol_by_name("HERO");
 		_m_item_sym = find_symbol_by_name("ITEM");
+
+		_m_function_depth.resize(functions().size(), 0);
+
+		if (_m_flags & DaedalusVmExecutionFlag::UNCHECKED) {
+			_m_function_verified.resize(functions().size(), 0);
+
+			for (auto& fn : functions()) {
+				auto* sym = find_symbol_by_index(fn.symbol);
+				if (sym->is_external()) continue;
+
+				auto result = verify_function(sym);
+				if (!result.verified) {
+					ZKLOGD("DaedalusVm",
+					       "Running %s with checks: %s at %u",
+					       sym->name().c_str(),
+					       result.error.c_str(),
+					       result.error_address);
+				}
+
+				_m_function_verified[sym->function_index()] = result.verified;
+			}
+		}
+
+		if (_m_flags & DaedalusVmExecutionFlag::OPTIMIZE) {
+			_m_ir.resize(functions().size());
+
+			auto fold_constants = !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER);
+			for (auto& fn : functions()) {
+				auto* sym = find_symbol_by_index(fn.symbol);
+				_m_ir[sym->function_index()] = lower_function(*this, *sym, fold_constants);
+			}
+		}
+
+		if (!(_m_flags & DaedalusVmExecutionFlag::DISABLE_NATIVE)) {
+			DaedalusNativeModule const* module = nullptr;
+			{
+				std::lock_guard lock {native_modules_lock};
+				for (auto* candidate : native_modules()) {
+					if (candidate->checksum == checksum()) {
+						module = candidate;
+						break;
+					}
+				}
+			}
+
+			if (module != nullptr) {
+				this->load_native_module(*module);
+			}
+		}
+	}
+
+	bool DaedalusVm::load_native_module(DaedalusNativeModule const& module) {
+		if (module.checksum != checksum()) {
+			ZKLOGW("DaedalusVm",
+			       "Not loading translated functions: checksum mismatch (%016llx != %016llx)",
+			       static_cast<unsigned long long>(module.checksum),
+			       static_cast<unsigned long long>(checksum()));
+			return false;
+		}
+
+		_m_native.resize(functions().size(), nullptr);
+
+		std::size_t count = 0;
+		for (auto& entry : module.functions) {
+			auto* sym = find_symbol_by_index(entry.symbol);
+			if (sym == nullptr || sym->is_external() || sym->function_index() >= _m_native.size()) {
+				ZKLOGW("DaedalusVm", "Ignoring translated function for symbol %u: not a script function", entry.symbol);
+				continue;
+			}
+
+			_m_native[sym->function_index()] = entry.function;
+			count += 1;
+		}
+
+		ZKLOGI("DaedalusVm", "Loaded %zu translated functions", count);
+		return true;
 	}
 
 	std::shared_ptr<DaedalusInstance> DaedalusVm::init_opaque_instance(DaedalusSymbol* sym) {
@@ -103,15 +250,629 @@ namespace zenkit {
 		return inst;
 	}
 
+	void DaedalusVm::set_instance_cache_enable(bool enable) {
+		_m_instance_cache_enabled = enable;
+		if (!enable) clear_instance_cache();
+	}
+
+	void DaedalusVm::mark_instance_impure(DaedalusSymbol const* sym) {
+		_m_instance_cache.insert_or_assign(sym->index(), nullptr);
+	}
+
+	bool DaedalusVm::is_instance_cached(DaedalusSymbol const* sym) const {
+		if (!_m_instance_cache_enabled) return false;
+
+		auto it = _m_instance_cache.find(sym->index());
+		return it != _m_instance_cache.end() && it->second != nullptr;
+	}
+
+	void DaedalusVm::clear_instance_cache() {
+		std::erase_if(_m_instance_cache, [](auto const& entry) { return entry.second != nullptr; });
+	}
+
+	DaedalusInstance const* DaedalusVm::cached_instance(DaedalusSymbol const* sym, std::type_info const& type) const {
+		if (!_m_instance_cache_enabled) return nullptr;
+
+		auto it = _m_instance_cache.find(sym->index());
+		if (it == _m_instance_cache.end() || it->second == nullptr || *it->second->_m_type != type) return nullptr;
+		return it->second.get();
+	}
+
+	void DaedalusVm::cache_instance(DaedalusSymbol const* sym, std::shared_ptr<DaedalusInstance const> instance) {
+		// Never replaces an entry, so that instances stay impure.
+		_m_instance_cache.try_emplace(sym->index(), std::move(instance));
+	}
+
+	bool DaedalusVm::accesses_globals(DaedalusSymbol const* sym) const {
+		std::unordered_set<std::uint32_t> functions {sym->index()};
+		std::vector<std::uint32_t> pending_functions {sym->index()};
+
+		while (!pending_functions.empty()) {
+			auto const* fn = find_symbol_by_index(pending_functions.back());
+			pending_functions.pop_back();
+
+			auto const* info = find_function_info(fn);
+			auto is_local = [info](std::uint32_t index) {
+				return info != nullptr && index >= info->params_begin &&
+				    index < info->locals_begin + info->locals_count;
+			};
+
+			std::unordered_set<std::uint32_t> seen;
+			std::vector<std::uint32_t> pending {fn->address()};
+
+			while (!pending.empty()) {
+				auto pc = pending.back();
+				pending.pop_back();
+
+				while (seen.insert(pc).second) {
+					auto const* instr = compact_instruction_at(pc);
+					if (instr == nullptr) break;
+
+					auto op = instr->original_op();
+					if (op == DaedalusOpcode::RSR) break;
+
+					if (op == DaedalusOpcode::PUSHV || op == DaedalusOpcode::PUSHVI || op == DaedalusOpcode::PUSHVV ||
+					    op == DaedalusOpcode::GMOVI) {
+						auto const* target = find_symbol_by_index(instr->arg);
+						if (target == nullptr) return true;
+						if (target == sym || target == _m_self_sym) {
+							// The instance being initialized.
+						} else if (op == DaedalusOpcode::GMOVI || !(target->is_const() || target->is_member() ||
+						                                           is_local(target->index()))) {
+							return true;
+						}
+					} else if (op == DaedalusOpcode::BL && instr->resolved) {
+						if (functions.insert(instr->arg).second) pending_functions.push_back(instr->arg);
+					} else if (op == DaedalusOpcode::B) {
+						pc = instr->arg;
+						continue;
+					} else if (op == DaedalusOpcode::BZ) {
+						pending.push_back(instr->arg);
+					}
+
+					pc += instr->size;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	namespace {
+		constexpr std::uint32_t SNAPSHOT_MAGIC = 0x534D565A; // "ZVMS"
+		constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+
+		/// \brief Terminates the list of symbols and stands in for a `NULL` instance reference.
+		constexpr std::uint32_t SNAPSHOT_NONE = std::numeric_limits<std::uint32_t>::max();
+
+		void write_snapshot_values(Write* w, DaedalusDataType type, void const* values, std::uint32_t count) {
+			if (type != DaedalusDataType::STRING) {
+				// Integers, floats and function references are all 32 bits wide.
+				w->write(values, count * sizeof(std::int32_t));
+				return;
+			}
+
+			for (auto i = 0u; i < count; ++i) {
+				auto const& value = static_cast<std::string const*>(values)[i];
+				w->write_uint(static_cast<std::uint32_t>(value.size()));
+				w->write(value.data(), value.size());
+			}
+		}
+
+		/// \brief Values read from a snapshot which are written to their target once the whole snapshot is valid.
+		struct SnapshotValues {
+			DaedalusDataType type;
+			void* target;
+			std::uint32_t count;
+			std::vector<std::int32_t> words {};
+			std::vector<std::string> strings {};
+
+			void commit() noexcept {
+				if (type != DaedalusDataType::STRING) {
+					std::copy_n(words.data(), count, static_cast<std::int32_t*>(target));
+					return;
+				}
+
+				std::move(strings.begin(), strings.end(), static_cast<std::string*>(target));
+			}
+		};
+
+		/// \brief An instance symbol whose value is set to the instance bound to another symbol.
+		struct SnapshotReference {
+			DaedalusSymbol* symbol;
+			DaedalusSymbol* target;
+		};
+
+		/// \return The number of bytes left in the stream before \p end.
+		std::size_t snapshot_remaining(Read const* r, std::size_t end) {
+			return end - std::min(end, r->tell());
+		}
+
+		/// \brief Reads a length-prefixed string, making sure that it does not exceed the rest of the snapshot.
+		std::uint32_t read_snapshot_string_length(Read* r, std::size_t end) {
+			auto size = r->read_uint();
+			if (size > snapshot_remaining(r, end)) {
+				throw DaedalusVmException {"Cannot load snapshot: string of " + std::to_string(size) +
+				                           " bytes exceeds the snapshot"};
+			}
+			return size;
+		}
+
+		void read_snapshot_values(Read* r, std::size_t end, SnapshotValues& values) {
+			if (values.type != DaedalusDataType::STRING) {
+				if (values.count * sizeof(std::int32_t) > snapshot_remaining(r, end)) {
+					throw DaedalusVmException {"Cannot load snapshot: unexpected end of data"};
+				}
+
+				values.words.resize(values.count);
+				r->read(values.words.data(), values.count * sizeof(std::int32_t));
+				return;
+			}
+
+			values.strings.resize(values.count);
+			for (auto& value : values.strings) {
+				value.resize(read_snapshot_string_length(r, end));
+				r->read(value.data(), value.size());
+			}
+		}
+
+		void skip_snapshot_values(Read* r, std::size_t end, DaedalusDataType type, std::uint32_t count) {
+			if (type != DaedalusDataType::STRING) {
+				r->seek(static_cast<ssize_t>(count * sizeof(std::int32_t)), Whence::CUR);
+				return;
+			}
+
+			for (auto i = 0u; i < count; ++i) {
+				r->seek(read_snapshot_string_length(r, end), Whence::CUR);
+			}
+		}
+	} // namespace
+
+	void DaedalusVm::save_snapshot(Write* w) const {
+		auto checksum = this->checksum();
+		w->write_uint(SNAPSHOT_MAGIC);
+		w->write_uint(SNAPSHOT_VERSION);
+		w->write(&checksum, sizeof checksum);
+
+		auto ignore_const = (_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER) != 0;
+		auto const& syms = symbols();
+
+		for (auto const& sym : syms) {
+			if (sym.is_member() || &sym == _m_temporary_strings) continue;
+
+			if (sym.type() == DaedalusDataType::INSTANCE) {
+				auto const& instance = std::get<std::shared_ptr<DaedalusInstance>>(sym._m_value);
+				auto target = instance != nullptr ? instance->_m_symbol_index : SNAPSHOT_NONE;
+
+				// Transient instances are not bound to a symbol, so they can't be restored.
+				if (instance != nullptr && target == SNAPSHOT_NONE) continue;
+
+				w->write_uint(sym.index());
+				w->write_uint(target);
+				if (target != sym.index()) continue;
+
+				// Members follow their class symbol.
+				auto const* cls = &sym;
+				while (cls != nullptr && cls->type() != DaedalusDataType::CLASS) {
+					cls = find_symbol_by_index(cls->parent());
+				}
+
+				std::vector<DaedalusSymbol const*> members;
+				for (auto i = cls != nullptr ? cls->index() + 1 : syms.size(); i < syms.size(); ++i) {
+					auto const& member = syms[i];
+					if (!member.is_member() || member.parent() != cls->index()) break;
+					if (member._m_registered_to == nullptr || *member._m_registered_to != *instance->_m_type) continue;
+					members.push_back(&member);
+				}
+
+				w->write_uint(static_cast<std::uint32_t>(members.size()));
+				for (auto const* member : members) {
+					w->write_uint(member->index());
+					write_snapshot_values(w,
+					                      member->type(),
+					                      instance->data() + member->offset_as_member(),
+					                      member->count());
+				}
+
+				continue;
+			}
+
+			if (sym.is_const() && !ignore_const) continue;
+
+			void const* values = nullptr;
+			if (sym.type() == DaedalusDataType::INT ||
+			    (sym.type() == DaedalusDataType::FUNCTION && !sym.is_const() && !sym.is_external())) {
+				values = std::get<std::shared_ptr<std::int32_t[]>>(sym._m_value).get();
+			} else if (sym.type() == DaedalusDataType::FLOAT) {
+				values = std::get<std::shared_ptr<float[]>>(sym._m_value).get();
+			} else if (sym.type() == DaedalusDataType::STRING) {
+				values = std::get<std::shared_ptr<std::string[]>>(sym._m_value).get();
+			} else {
+				continue;
+			}
+
+			w->write_uint(sym.index());
+			write_snapshot_values(w, sym.type(), values, sym.count());
+		}
+
+		w->write_uint(SNAPSHOT_NONE);
+	}
+
+	void DaedalusVm::load_snapshot(Read* r) {
+		if (r->read_uint() != SNAPSHOT_MAGIC || r->read_uint() != SNAPSHOT_VERSION) {
+			throw DaedalusVmException {"Cannot load snapshot: unsupported format"};
+		}
+
+		std::uint64_t checksum = 0;
+		r->read(&checksum, sizeof checksum);
+		if (checksum != this->checksum()) {
+			throw DaedalusVmException {"Cannot load snapshot: it was saved for a different script"};
+		}
+
+		auto begin = r->tell();
+		r->seek(0, Whence::END);
+		auto end = r->tell();
+		r->seek(static_cast<ssize_t>(begin), Whence::BEG);
+
+		// Nothing is restored until the whole snapshot has been read, so that invalid snapshots leave the VM as-is.
+		std::vector<SnapshotValues> values;
+		std::vector<SnapshotReference> references;
+
+		for (auto index = r->read_uint(); index != SNAPSHOT_NONE; index = r->read_uint()) {
+			auto* sym = find_symbol_by_index(index);
+			if (sym == nullptr || sym->is_member() || r->eof()) {
+				throw DaedalusVmException {"Cannot load snapshot: invalid symbol " + std::to_string(index)};
+			}
+
+			if (sym->type() == DaedalusDataType::INSTANCE) {
+				auto target = r->read_uint();
+				if (target != index) {
+					references.push_back({sym, target != SNAPSHOT_NONE ? find_symbol_by_index(target) : nullptr});
+					continue;
+				}
+
+				auto const& instance = sym->get_instance();
+				auto owned = instance != nullptr && instance->_m_symbol_index == index;
+
+				for (auto count = r->read_uint(); count > 0; --count) {
+					auto* member = find_symbol_by_index(r->read_uint());
+					if (member == nullptr || !member->is_member() || r->eof()) {
+						throw DaedalusVmException {"Cannot load snapshot: invalid member of " + sym->name()};
+					}
+
+					auto restore = owned && member->_m_registered_to != nullptr &&
+					    *member->_m_registered_to == *instance->_m_type;
+					if (restore) {
+						auto* storage = instance->data() + member->offset_as_member();
+						auto& staged = values.emplace_back(SnapshotValues {member->type(), storage, member->count()});
+						read_snapshot_values(r, end, staged);
+					} else {
+						skip_snapshot_values(r, end, member->type(), member->count());
+					}
+				}
+
+				continue;
+			}
+
+			void* target = nullptr;
+			if (auto* ints = std::get_if<std::shared_ptr<std::int32_t[]>>(&sym->_m_value)) {
+				target = ints->get();
+			} else if (auto* floats = std::get_if<std::shared_ptr<float[]>>(&sym->_m_value)) {
+				target = floats->get();
+			} else if (auto* strings = std::get_if<std::shared_ptr<std::string[]>>(&sym->_m_value)) {
+				target = strings->get();
+			}
+
+			if (target == nullptr) {
+				throw DaedalusVmException {"Cannot load snapshot: " + sym->name() + " has no value"};
+			}
+
+			read_snapshot_values(r, end, values.emplace_back(SnapshotValues {sym->type(), target, sym->count()}));
+		}
+
+		for (auto& v : values) {
+			v.commit();
+		}
+
+		// References are restored in order, since they may refer to instance symbols restored before them.
+		for (auto const& ref : references) {
+			ref.symbol->set_instance(ref.target != nullptr ? ref.target->get_instance() : nullptr);
+		}
+	}
+
 	void DaedalusVm::unsafe_call(DaedalusSymbol const* sym) {
+		if (_m_call_stack.empty()) {
+			release_temporaries();
+		}
+
+		// If the call fails, its arguments are dropped from the stack.
+		auto params = sym->type() == DaedalusDataType::FUNCTION ? sym->count() : 0;
+		CallGuard guard {this, _m_call_stack.size(), _m_stack_ptr - std::min<std::uint32_t>(params, _m_stack_ptr)};
+		invoke_function(sym);
+
+		if (_m_call_stack.empty()) {
+			release_temporaries();
+		}
+	}
+
+	void DaedalusVm::invoke_function(DaedalusSymbol const* sym) {
+		if (auto native = native_function(sym); native != nullptr) {
+			invoke_native(sym, native);
+			return;
+		}
+
+		if (auto const* fn = optimized_function(sym); fn != nullptr) {
+			invoke_optimized(sym, *fn);
+			return;
+		}
+
 		push_call(sym);
 		jump(sym->address());
 
 		// execute until an op_return is reached
-		while (exec())
-			;
+		run(_m_call_stack.size(), nullptr);
+
+		pop_call();
+	}
+
+	void DaedalusVm::invoke_native(DaedalusSymbol const* sym, DaedalusNativeFunction native) {
+		push_call(sym);
+
+		try {
+			native(*this);
+		} catch (DaedalusScriptError const&) {
+			// The exception handler decided to fail, so drop everything the function pushed. Popping the frame
+			// then pushes a default return value.
+			_m_stack_ptr = static_cast<std::uint16_t>(_m_call_stack.back().stack_ptr);
+			pop_call();
+			throw;
+		}
+
+		pop_call();
+	}
+
+	void DaedalusVm::invoke_optimized(DaedalusSymbol const* sym, DaedalusIrFunction const& fn) {
+		push_call(sym);
+
+		if (!run_optimized(fn)) {
+			// Continue with the rest of the function in the bytecode interpreter.
+			run(_m_call_stack.size(), nullptr);
+		}
+
+		pop_call();
+	}
+
+	void DaedalusVm::invoke_external(DaedalusSymbol* sym) {
+		// Guard against exceptions during external invocation.
+		StackGuard guard {this, sym->rtype()};
+		++_m_external_calls;
+
+		if (sym->_m_callback < _m_callbacks.size()) {
+			push_call(sym);
+			_m_callbacks[sym->_m_callback](*this);
+			pop_call();
+		} else if (_m_default_external.has_value()) {
+			ZK_VM_PROFILE(enter(*sym));
+			(*_m_default_external)(*this, *sym);
+			ZK_VM_PROFILE(leave());
+		} else {
+			throw DaedalusVmException {"be: no external registered for " + sym->name()};
+		}
+
+		// The stack is left intact.
+		guard.inhibit();
+	}
+
+	bool DaedalusVm::native_handle_error(DaedalusScriptError const& err, std::uint32_t& pc) {
+		_m_pc = pc;
+
+		auto strategy = DaedalusVmExceptionStrategy::FAIL;
+		if (_m_exception_handler) {
+			strategy = (*_m_exception_handler)(*this, err, instruction_at(pc));
+		}
+
+		if (strategy == DaedalusVmExceptionStrategy::FAIL) {
+			ZKLOGE("DaedalusVm", "+++ Error while executing script: %s +++", err.what());
+			print_stack_trace();
+			throw;
+		}
+
+		if (strategy == DaedalusVmExceptionStrategy::RETURN) {
+			return false;
+		}
+
+		pc += instruction_at(pc).size;
+		return true;
+	}
+
+	void DaedalusVm::native_pushv(std::uint32_t symbol) {
+		auto* sym = find_symbol_by_index(symbol);
+		if (sym == nullptr) {
+			throw DaedalusVmException {"pushv: no symbol found for index"};
+		}
+
+		if (sym->has_access_trap() && _m_access_trap) {
+			_m_access_trap(*sym);
+		} else {
+			push_reference(sym, 0);
+		}
+	}
+
+	void DaedalusVm::native_pushvv(std::uint32_t symbol, std::uint8_t index) {
+		auto* sym = find_symbol_by_index(symbol);
+		if (sym == nullptr) {
+			throw DaedalusVmException {"pushvv: no symbol found for index"};
+		}
+
+		push_reference(sym, index);
+	}
+
+	void DaedalusVm::native_movi() {
+		auto [ref, idx, context] = unsafe_pop_reference();
+		auto value = pop_int();
+		this->unsafe_set_int(context, ref, idx, value);
+	}
+
+	void DaedalusVm::native_movf() {
+		auto [ref, idx, context] = unsafe_pop_reference();
+		auto value = pop_float();
+		this->unsafe_set_float(context, ref, idx, value);
+	}
+
+	void DaedalusVm::native_movs() {
+		auto [target, target_idx, context] = unsafe_pop_reference();
+		auto const& source = pop_string();
+		this->unsafe_set_string(context, target, target_idx, source);
+		release_statement_temporaries();
+	}
+
+	void DaedalusVm::native_movvi() {
+		auto [target, target_idx, _] = unsafe_pop_reference();
+		target->set_instance(pop_instance());
+	}
+
+	void DaedalusVm::native_addmovi() {
+		native_update_int(DaedalusOpcode::ADDMOVI);
+	}
+
+	void DaedalusVm::native_submovi() {
+		native_update_int(DaedalusOpcode::SUBMOVI);
+	}
+
+	void DaedalusVm::native_mulmovi() {
+		native_update_int(DaedalusOpcode::MULMOVI);
+	}
+
+	void DaedalusVm::native_divmovi() {
+		native_update_int(DaedalusOpcode::DIVMOVI);
+	}
+
+	void DaedalusVm::native_update_int(DaedalusOpcode op) {
+		auto [ref, idx, context] = unsafe_pop_reference();
+		auto value = pop_int();
+		unsafe_update_int(op, context, ref, idx, value);
+	}
+
+	void DaedalusVm::unsafe_update_int(DaedalusOpcode op,
+	                                   DaedalusInstance* context,
+	                                   DaedalusSymbol* ref,
+	                                   std::uint16_t idx,
+	                                   std::int32_t value) {
+		if (op == DaedalusOpcode::DIVMOVI && value == 0) {
+			throw DaedalusVmException {"vm: division by zero"};
+		}
+
+		if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
+			throw DaedalusIllegalConstAccess(ref);
+		}
+
+		if (ref->is_member() && context == nullptr && (_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
+			ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
+			return;
+		}
+
+		auto result = ref->get_int(idx, context);
+		switch (op) {
+		case DaedalusOpcode::ADDMOVI:
+			result += value;
+			break;
+		case DaedalusOpcode::SUBMOVI:
+			result -= value;
+			break;
+		case DaedalusOpcode::MULMOVI:
+			result *= value;
+			break;
+		default:
+			result /= value;
+			break;
+		}
+
+		ref->set_int(result, idx, context);
+	}
+
+	void DaedalusVm::native_gmovi(std::uint32_t symbol) {
+		auto* sym = find_symbol_by_index(symbol);
+		if (sym == nullptr) {
+			throw DaedalusVmException {"gmovi: no symbol found for index"};
+		}
+
+		pin_instance(std::move(_m_instance));
+		_m_instance = sym->get_instance();
+	}
+
+	void DaedalusVm::native_bl(std::uint32_t symbol) {
+		auto* sym = find_symbol_by_index(symbol);
+		if (sym == nullptr) {
+			throw DaedalusVmException {"bl: no symbol found for index " + std::to_string(symbol)};
+		}
+
+		if (!sym->has_override()) {
+			invoke_function(sym);
+			return;
+		}
+
+		// The function is overridden, call the resulting external.
+		StackGuard guard {this, sym->rtype()};
+		++_m_external_calls;
+		_m_callbacks[sym->_m_callback](*this);
+		guard.inhibit();
+	}
+
+	void DaedalusVm::native_be(std::uint32_t symbol) {
+		auto* sym = find_symbol_by_index(symbol);
+		if (sym == nullptr) {
+			throw DaedalusVmException {"be: no external found for index"};
+		}
+
+		invoke_external(sym);
+		release_statement_temporaries();
+	}
+
+	DaedalusVmExecutionResult DaedalusVm::start_call(DaedalusSymbol const* sym, DaedalusVmBudget const& budget) {
+		if (_m_suspended) {
+			throw DaedalusVmException {"Cannot call " + sym->name() + ": another call is suspended"};
+		}
+
+		if (_m_call_stack.empty()) {
+			release_temporaries();
+		}
+
+		push_call(sym);
+		jump(sym->address());
+
+		_m_suspended_base = _m_call_stack.size();
+		_m_suspended = true;
+		_m_suspend_requested = false;
+		return resume(budget);
+	}
+
+	DaedalusVmExecutionResult DaedalusVm::resume(DaedalusVmBudget const& budget) {
+		if (!_m_suspended) {
+			throw DaedalusVmException {"Cannot resume: no call is suspended"};
+		}
+
+		// If execution fails, the call is not resumable anymore.
+		_m_suspended = false;
+		{
+			// The arguments were already popped by the function itself.
+			CallGuard guard {this, _m_suspended_base - 1, _m_call_stack[_m_suspended_base - 1].stack_ptr};
+			if (!run(_m_suspended_base, &budget)) {
+				_m_suspended = true;
+				return DaedalusVmExecutionResult::SUSPENDED;
+			}
+		}
 
 		pop_call();
+
+		if (_m_call_stack.empty()) {
+			release_temporaries();
+		}
+
+		return DaedalusVmExecutionResult::FINISHED;
+	}
+
+	void DaedalusVm::request_suspend() noexcept {
+		_m_suspend_requested = true;
 	}
 
 	void DaedalusVm::unsafe_jump(uint32_t address) {
@@ -123,167 +884,451 @@ namespace zenkit {
 	}
 
 	void DaedalusVm::unsafe_set_gi(std::shared_ptr<DaedalusInstance> i) {
+		pin_instance(std::move(_m_instance));
 		_m_instance = std::move(i);
 	}
 
-	bool DaedalusVm::exec() {
-		auto instr = instruction_at(_m_pc);
+	void DaedalusVm::pin_instance(std::shared_ptr<DaedalusInstance> instance) {
+		if (instance == nullptr) return;
 
-		try {
-			std::int32_t a, b;
-			DaedalusSymbol* sym;
+		// Externals may push the same instances over and over again during a single call.
+		auto it = std::find(_m_pinned_instances.begin(), _m_pinned_instances.end(), instance);
+		if (it != _m_pinned_instances.end()) return;
 
-			switch (instr.op) {
-			case DaedalusOpcode::ADD:
-				push_int(pop_int() + pop_int());
-				break;
-			case DaedalusOpcode::SUB:
-				a = pop_int();
-				b = pop_int();
+		_m_pinned_instances.push_back(std::move(instance));
+	}
+
+	void DaedalusVm::release_temporaries() {
+		if (_m_stack_ptr == 0) {
+			// Nothing on the stack can reference a pinned instance anymore.
+			_m_pinned_instances.clear();
+		} else {
+			// Arguments and return values may still reference pinned instances.
+			auto stack = std::span {_m_stack.data(), _m_stack_ptr};
+			std::erase_if(_m_pinned_instances, [stack](auto const& instance) {
+				return std::none_of(stack.begin(), stack.end(), [&instance](auto const& slot) {
+					return slot.instance == instance.get();
+				});
+			});
+		}
+
+		// Arguments and return values may still be on the stack.
+		_m_temporary_strings_used = referenced_temporary_strings();
+		_m_temporary_strings_retired.clear();
+	}
+
+	void DaedalusVm::release_statement_temporaries() noexcept {
+		if (_m_call_stack.empty()) return;
+
+		// Everything left on the stack was pushed before the function was called, so the strings allocated since
+		// then are not referenced anymore. Callers may still use the ones allocated before.
+		auto const& frame = _m_call_stack.back();
+		if (_m_stack_ptr <= frame.stack_ptr && _m_temporary_strings_used > frame.temporary_strings) {
+			_m_temporary_strings_used = frame.temporary_strings;
+		}
+	}
+
+	std::uint32_t DaedalusVm::referenced_temporary_strings() const {
+		std::uint32_t count = 0;
+		for (auto i = 0u; i < _m_stack_ptr; ++i) {
+			auto const& slot = _m_stack[i];
+			if (slot.type == DaedalusStackSlot::Type::REFERENCE && slot.symbol == _m_temporary_strings->index()) {
+				count = std::max(count, slot.index + 1u);
+			}
+		}
+		return count;
+	}
+
+	std::uint16_t DaedalusVm::allocate_temporary_string() {
+		static constexpr std::uint32_t MAX_TEMPORARY_STRINGS = std::numeric_limits<std::uint16_t>::max() + 1;
+
+		auto count = _m_temporary_strings->count();
+		if (_m_temporary_strings_used < count) {
+			return static_cast<std::uint16_t>(_m_temporary_strings_used++);
+		}
+
+		if (count < MAX_TEMPORARY_STRINGS) {
+			// Strings are copied instead of moved and the old storage is kept until the temporaries are released,
+			// since references to the strings, like arguments of externals, may still be in use.
+			auto size = std::min(count * 2, MAX_TEMPORARY_STRINGS);
+			std::shared_ptr<std::string[]> storage {new std::string[size]};
+
+			auto& value = std::get<std::shared_ptr<std::string[]>>(_m_temporary_strings->_m_value);
+			std::copy_n(value.get(), count, storage.get());
+			_m_temporary_strings_retired.push_back(std::exchange(value, std::move(storage)));
+			_m_temporary_strings->_m_count = size;
+		} else {
+			// Reuse all strings above the topmost one which is still on the stack.
+			auto used = referenced_temporary_strings();
+			if (used == count) {
+				throw DaedalusVmException {"too many temporary strings on the stack"};
+			}
+
+			_m_temporary_strings_used = used;
+		}
+
+		return static_cast<std::uint16_t>(_m_temporary_strings_used++);
+	}
+
+	// The interpreter loop can be compiled in two flavours: a portable `switch`-based one and a direct-threaded one
+	// using the "labels as values" extension supported by GCC and Clang. Both share the opcode implementations below.
+	//
+	// Handlers which declare variables with non-trivial destructors must be wrapped in braces and have their
+	// ZK_VM_NEXT() placed after the closing brace, since an indirect goto may not leave such a scope.
+#if defined(_ZK_WITH_THREADED_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+#define ZK_VM_THREADED 1
+#define ZK_VM_CASE(op) op_##op:
+#define ZK_VM_DEFAULT op_UNKNOWN:
+#define ZK_VM_DISPATCH()                                                                                               \
+	{                                                                                                                  \
+		ZK_VM_FETCH();                                                                                                 \
+		goto* dispatch_table[dispatch_index[static_cast<std::uint8_t>(instr.op)]];                                     \
+	}
+#else
+#define ZK_VM_CASE(op) case DaedalusOpcode::op:
+#define ZK_VM_DEFAULT default:
+#define ZK_VM_DISPATCH() continue
+#endif
+
+#define ZK_VM_FETCH()                                                                                                  \
+	do {                                                                                                               \
+		if (countdown == 0 && should_suspend()) return false;                                                          \
+		--countdown;                                                                                                   \
+		pc = _m_pc;                                                                                                    \
+		auto const* cached = compact_instruction_at(pc);                                                               \
+		instr = cached != nullptr ? *cached : DaedalusCompactInstruction::from(instruction_at(pc));                    \
+		ZK_VM_PROFILE(instruction());                                                                                  \
+		if (_m_trace != nullptr) {                                                                                     \
+			auto function = _m_call_stack.empty() ? DaedalusTraceEntry::NO_FUNCTION                                    \
+			                                      : _m_call_stack.back().function->index();                            \
+			_m_trace->record(pc, instr.op, _m_stack_ptr, function);                                                    \
+		}                                                                                                              \
+	} while (false)
+
+// Integer operands of verified functions can be popped without checks.
+#define ZK_VM_POP_INT() (verified ? pop_int_verified() : pop_int())
+
+// Note: These must not be wrapped in `do { ... } while (false)` since ZK_VM_DISPATCH() is a `continue` statement
+// when using the `switch`-based loop.
+#define ZK_VM_NEXT()                                                                                                   \
+	{                                                                                                                  \
+		_m_pc += instr.size;                                                                                           \
+		ZK_VM_DISPATCH();                                                                                              \
+	}
+
+	namespace {
+		/// \brief Evaluates the comparison instruction \p op with `a` on top of the stack and `b` below it.
+		bool compare(DaedalusOpcode op, std::int32_t a, std::int32_t b) {
+			switch (op) {
+			case DaedalusOpcode::EQ:
+				return a == b;
+			case DaedalusOpcode::NEQ:
+				return a != b;
+			case DaedalusOpcode::LT:
+				return a < b;
+			case DaedalusOpcode::GT:
+				return a > b;
+			case DaedalusOpcode::LTE:
+				return a <= b;
+			case DaedalusOpcode::GTE:
+				return a >= b;
+			default:
+				return false;
+			}
+		}
+	} // namespace
+
+#ifdef ZK_VM_THREADED
+	namespace {
+		/// \brief The order in which opcode handlers appear in the dispatch table of DaedalusVm::run.
+		constexpr DaedalusOpcode DISPATCH_ORDER[] = {
+		    DaedalusOpcode::ADD,     DaedalusOpcode::SUB,     DaedalusOpcode::MUL,     DaedalusOpcode::DIV,
+		    DaedalusOpcode::MOD,     DaedalusOpcode::OR,      DaedalusOpcode::ANDB,    DaedalusOpcode::LT,
+		    DaedalusOpcode::GT,      DaedalusOpcode::MOVI,    DaedalusOpcode::ORR,     DaedalusOpcode::AND,
+		    DaedalusOpcode::LSL,     DaedalusOpcode::LSR,     DaedalusOpcode::LTE,     DaedalusOpcode::EQ,
+		    DaedalusOpcode::NEQ,     DaedalusOpcode::GTE,     DaedalusOpcode::ADDMOVI, DaedalusOpcode::SUBMOVI,
+		    DaedalusOpcode::MULMOVI, DaedalusOpcode::DIVMOVI, DaedalusOpcode::PLUS,    DaedalusOpcode::NEGATE,
+		    DaedalusOpcode::NOT,     DaedalusOpcode::CMPL,    DaedalusOpcode::NOP,     DaedalusOpcode::RSR,
+		    DaedalusOpcode::BL,      DaedalusOpcode::BE,      DaedalusOpcode::PUSHI,   DaedalusOpcode::PUSHV,
+		    DaedalusOpcode::PUSHVI,  DaedalusOpcode::MOVS,    DaedalusOpcode::MOVSS,   DaedalusOpcode::MOVVF,
+		    DaedalusOpcode::MOVF,    DaedalusOpcode::MOVVI,   DaedalusOpcode::B,       DaedalusOpcode::BZ,
+		    DaedalusOpcode::GMOVI,   DaedalusOpcode::PUSHVV,  DaedalusOpcode::MOVI_IMM, DaedalusOpcode::BZ_CMP_IMM,
+		    DaedalusOpcode::BE_IMM,
+		};
+
+		constexpr auto DISPATCH_UNKNOWN = static_cast<std::uint8_t>(std::size(DISPATCH_ORDER));
+
+		/// \brief Maps every possible opcode byte to its position in #DISPATCH_ORDER or #DISPATCH_UNKNOWN.
+		constexpr auto dispatch_index = [] {
+			std::array<std::uint8_t, 256> index {};
+			index.fill(DISPATCH_UNKNOWN);
+
+			for (std::uint8_t i = 0; i < std::size(DISPATCH_ORDER); ++i) {
+				index[static_cast<std::uint8_t>(DISPATCH_ORDER[i])] = i;
+			}
+
+			return index;
+		}();
+	} // namespace
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+	bool DaedalusVm::run(std::size_t base, DaedalusVmBudget const* budget) {
+		DaedalusCompactInstruction instr {};
+		std::uint32_t pc = _m_pc;
+
+		// Time-slicing state. The budget is only checked when `countdown` reaches zero, which happens at least every
+		// SLICE_CHECK_INTERVAL instructions. When running without a budget, it never does in practice.
+		constexpr std::uint64_t SLICE_CHECK_INTERVAL = 1024;
+		constexpr std::uint64_t UNLIMITED = std::numeric_limits<std::uint64_t>::max();
+
+		std::uint64_t remaining = budget != nullptr ? budget->instructions : UNLIMITED;
+		std::uint64_t armed = budget != nullptr ? std::min(remaining, SLICE_CHECK_INTERVAL) : UNLIMITED;
+		std::uint64_t countdown = armed;
+
+		auto deadline = std::chrono::steady_clock::time_point::max();
+		if (budget != nullptr && budget->time != std::chrono::microseconds::max()) {
+			deadline = std::chrono::steady_clock::now() + budget->time;
+		}
+
+		// Functions which passed verification run without most checks. See DaedalusVmExecutionFlag::UNCHECKED.
+		bool verified = false;
+		auto frame_is_verified = [this] {
+			return !_m_call_stack.empty() && !_m_call_stack.back().checked &&
+			    is_function_verified(_m_call_stack.back().function);
+		};
+
+		// Runs the rest of the current function with checks, since its stack does not match the verifier's proof.
+		auto check_frame = [&] {
+			if (!_m_call_stack.empty()) _m_call_stack.back().checked = true;
+			verified = false;
+		};
+
+		verified = frame_is_verified();
+
+		auto should_suspend = [&] {
+			if (budget == nullptr) {
+				armed = countdown = UNLIMITED;
+				return false;
+			}
+
+			remaining -= armed;
+			if (remaining == 0 || _m_suspend_requested || std::chrono::steady_clock::now() >= deadline) {
+				_m_suspend_requested = false;
+				return true;
+			}
+
+			armed = countdown = std::min(remaining, SLICE_CHECK_INTERVAL);
+			return false;
+		};
+
+#ifdef ZK_VM_THREADED
+		// Must match the order of DISPATCH_ORDER exactly.
+		static void* const dispatch_table[] = {
+		    &&op_ADD,     &&op_SUB,     &&op_MUL,     &&op_DIV,     &&op_MOD,     &&op_OR,    &&op_ANDB,   &&op_LT,
+		    &&op_GT,      &&op_MOVI,    &&op_ORR,     &&op_AND,     &&op_LSL,     &&op_LSR,   &&op_LTE,    &&op_EQ,
+		    &&op_NEQ,     &&op_GTE,     &&op_ADDMOVI, &&op_SUBMOVI, &&op_MULMOVI, &&op_DIVMOVI, &&op_PLUS, &&op_NEGATE,
+		    &&op_NOT,     &&op_CMPL,    &&op_NOP,     &&op_RSR,     &&op_BL,      &&op_BE,    &&op_PUSHI,  &&op_PUSHV,
+		    &&op_PUSHVI,  &&op_MOVS,    &&op_MOVSS,   &&op_MOVVF,   &&op_MOVF,    &&op_MOVVI, &&op_B,      &&op_BZ,
+		    &&op_GMOVI,   &&op_PUSHVV,  &&op_MOVI_IMM, &&op_BZ_CMP_IMM, &&op_BE_IMM, &&op_UNKNOWN,
+		};
+
+		static_assert(std::size(dispatch_table) == DISPATCH_UNKNOWN + 1);
+#endif
+
+		for (;;) {
+			try {
+				std::int32_t a, b;
+				DaedalusSymbol* sym;
+
+#ifdef ZK_VM_THREADED
+				ZK_VM_DISPATCH();
+#else
+				for (;;) {
+					ZK_VM_FETCH();
+
+					switch (instr.op) {
+#endif
+				ZK_VM_CASE(ADD)
+				push_int(ZK_VM_POP_INT() + ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(SUB)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 				push_int(a - b);
-				break;
-			case DaedalusOpcode::MUL:
-				push_int(pop_int() * pop_int());
-				break;
-			case DaedalusOpcode::DIV:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(MUL)
+				push_int(ZK_VM_POP_INT() * ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(DIV)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 
 				if (b == 0) throw DaedalusVmException {"vm: division by zero"};
 
 				push_int(a / b);
-				break;
-			case DaedalusOpcode::MOD:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(MOD)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 
 				if (b == 0) throw DaedalusVmException {"vm: division by zero"};
 
 				push_int(a % b);
-				break;
-			case DaedalusOpcode::OR:
-				push_int(pop_int() | pop_int());
-				break;
-			case DaedalusOpcode::ANDB:
-				push_int(pop_int() & pop_int());
-				break;
-			case DaedalusOpcode::LT:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(OR)
+				push_int(ZK_VM_POP_INT() | ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(ANDB)
+				push_int(ZK_VM_POP_INT() & ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(LT)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 				push_int(a < b);
-				break;
-			case DaedalusOpcode::GT:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(GT)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 				push_int(a > b);
-				break;
-			case DaedalusOpcode::LSL:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(LSL)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 				push_int(a << b);
-				break;
-			case DaedalusOpcode::LSR:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(LSR)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 				push_int(a >> b);
-				break;
-			case DaedalusOpcode::LTE:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(LTE)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 				push_int(a <= b);
-				break;
-			case DaedalusOpcode::EQ:
-				push_int(pop_int() == pop_int());
-				break;
-			case DaedalusOpcode::NEQ:
-				push_int(pop_int() != pop_int());
-				break;
-			case DaedalusOpcode::GTE:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(EQ)
+				push_int(ZK_VM_POP_INT() == ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(NEQ)
+				push_int(ZK_VM_POP_INT() != ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(GTE)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 				push_int(a >= b);
-				break;
-			case DaedalusOpcode::PLUS:
-				push_int(+pop_int());
-				break;
-			case DaedalusOpcode::NEGATE:
-				push_int(-pop_int());
-				break;
-			case DaedalusOpcode::NOT:
-				push_int(!pop_int());
-				break;
-			case DaedalusOpcode::CMPL:
-				push_int(~pop_int());
-				break;
-			case DaedalusOpcode::ORR:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(PLUS)
+				push_int(+ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(NEGATE)
+				push_int(-ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(NOT)
+				push_int(!ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(CMPL)
+				push_int(~ZK_VM_POP_INT());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(ORR)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 				push_int(a || b);
-				break;
-			case DaedalusOpcode::AND:
-				a = pop_int();
-				b = pop_int();
+				ZK_VM_NEXT();
+				ZK_VM_CASE(AND)
+				a = ZK_VM_POP_INT();
+				b = ZK_VM_POP_INT();
 				push_int(a && b);
-				break;
-			case DaedalusOpcode::NOP:
+				ZK_VM_NEXT();
+				ZK_VM_CASE(NOP)
+				ZK_VM_DEFAULT
 				// Do nothing
-				break;
-			case DaedalusOpcode::RSR:
-				return false;
-			case DaedalusOpcode::BL: {
-				// Check if the function is overridden and if it is, call the resulting external.
-				sym = find_symbol_by_address(instr.address);
-				if (auto cb = _m_function_overrides.find(instr.address); cb != _m_function_overrides.end()) {
+				ZK_VM_NEXT();
+				ZK_VM_CASE(RSR)
+				if (_m_call_stack.size() <= base) {
+					return true;
+				}
+
+				return_to_caller();
+				verified = frame_is_verified();
+				ZK_VM_DISPATCH();
+				ZK_VM_CASE(BL)
+				if (verified) {
+					sym = unchecked_symbol(instr.arg);
+				} else {
+					sym = instr.resolved ? find_symbol_by_index(instr.arg) : find_symbol_by_address(instr.arg);
+				}
+				if (sym == nullptr) {
+					throw DaedalusVmException {"bl: no symbol found for address " + std::to_string(instr.arg)};
+				}
+
+				// Script functions are run by this loop directly, so that the VM does not recurse on the native stack
+				// and execution can be suspended anywhere.
+				if (!sym->has_override()) {
+					if (auto native = native_function(sym); native != nullptr) {
+						invoke_native(sym, native);
+						ZK_VM_NEXT();
+					}
+
+					// Lowered code can not be suspended, so it is only used when running to completion.
+					if (auto const* fn = optimized_function(sym); fn != nullptr && budget == nullptr) {
+						invoke_optimized(sym, *fn);
+						ZK_VM_NEXT();
+					}
+
+					push_call(sym);
+					jump(sym->address());
+					verified = frame_is_verified();
+					ZK_VM_DISPATCH();
+				}
+
+				// The function is overridden, call the resulting external.
+				a = _m_stack_ptr;
+				{
 					// Guard against exceptions during external invocation.
 					StackGuard guard {this, sym->rtype()};
+					++_m_external_calls;
 					// Call maybe naked.
-					cb->second(*this);
+					_m_callbacks[sym->_m_callback](*this);
 					// The stack is left intact.
 					guard.inhibit();
-				} else {
-					if (sym == nullptr) {
-						throw DaedalusVmException {"bl: no symbol found for address " + std::to_string(instr.address)};
-					}
-
-					unsafe_call(sym);
 				}
 
-				break;
-			}
-			case DaedalusOpcode::BE: {
-				sym = find_symbol_by_index(instr.symbol);
+				if (verified && !honors_signature(sym, static_cast<std::uint32_t>(a))) {
+					check_frame();
+				}
+				ZK_VM_NEXT();
+				ZK_VM_CASE(BE)
+				call_external:
+				sym = verified ? unchecked_symbol(instr.arg) : find_symbol_by_index(instr.arg);
 				if (sym == nullptr) {
 					throw DaedalusVmException {"be: no external found for index"};
 				}
 
-				// Guard against exceptions during external invocation.
-				StackGuard guard {this, sym->rtype()};
-
-				auto cb = _m_externals.find(sym);
-				if (cb == _m_externals.end()) {
-					if (_m_default_external.has_value()) {
-						(*_m_default_external)(*this, *sym);
-						guard.inhibit();
-						break;
-					}
+				a = _m_stack_ptr;
+				invoke_external(sym);
 
-					throw DaedalusVmException {"be: no external registered for " + sym->name()};
+				// Externals registered with the wrong signature leave the wrong values on the stack.
+				if (verified && !honors_signature(sym, static_cast<std::uint32_t>(a))) {
+					check_frame();
 				}
 
-				push_call(sym);
-				cb->second(*this);
-				pop_call();
+				release_statement_temporaries();
 
-				// The stack is left intact.
-				guard.inhibit();
-				break;
-			}
-			case DaedalusOpcode::PUSHI:
-				push_int(instr.immediate);
-				break;
-			case DaedalusOpcode::PUSHVI:
-			case DaedalusOpcode::PUSHV:
-				sym = find_symbol_by_index(instr.symbol);
+				// Externals may ask for the current time slice to end.
+				if (_m_suspend_requested && budget != nullptr) {
+					remaining -= armed - countdown;
+					armed = countdown = 0;
+				}
+				ZK_VM_NEXT();
+				ZK_VM_CASE(PUSHI)
+				push_int(static_cast<std::int32_t>(instr.arg));
+				ZK_VM_NEXT();
+				ZK_VM_CASE(PUSHVI)
+				ZK_VM_CASE(PUSHV)
+				sym = verified ? unchecked_symbol(instr.arg) : find_symbol_by_index(instr.arg);
 				if (sym == nullptr) {
 					throw DaedalusVmException {"pushv: no symbol found for index"};
 				}
@@ -292,174 +1337,529 @@ namespace zenkit {
 				} else {
 					push_reference(sym, 0);
 				}
-				break;
-			case DaedalusOpcode::MOVI:
-			case DaedalusOpcode::MOVVF: {
-				auto [ref, idx, context] = pop_reference();
-				auto value = pop_int();
-
-				this->set_int(context, ref, idx, value);
-				break;
-			}
-			case DaedalusOpcode::MOVF: {
-				auto [ref, idx, context] = pop_reference();
-				auto value = pop_float();
-
-				this->set_float(context, ref, idx, value);
-				break;
-			}
-			case DaedalusOpcode::MOVS: {
-				auto [target, target_idx, context] = pop_reference();
-				auto source = pop_string();
-
-				this->set_string(context, target, target_idx, source);
-				break;
-			}
-			case DaedalusOpcode::MOVSS:
-				throw DaedalusVmException {"not implemented: movss"};
-			case DaedalusOpcode::ADDMOVI: {
-				auto [ref, idx, context] = pop_reference();
-				auto value = pop_int();
-
-				if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
-					throw DaedalusIllegalConstAccess(ref);
+				ZK_VM_NEXT();
+				ZK_VM_CASE(MOVI)
+				ZK_VM_CASE(MOVVF) {
+					auto [ref, idx, context] = verified ? pop_reference_verified() : unsafe_pop_reference();
+					auto value = ZK_VM_POP_INT();
+
+					if (verified && !ref->is_member() && !ref->is_const()) {
+						*ref->unchecked_value<std::int32_t>(idx) = value;
+					} else {
+						this->unsafe_set_int(context, ref, idx, value);
+					}
 				}
+				ZK_VM_NEXT();
+				ZK_VM_CASE(MOVF) {
+					auto [ref, idx, context] = verified ? pop_reference_verified() : unsafe_pop_reference();
+					auto value = verified ? pop_float_verified() : pop_float();
 
-				if (!ref->is_member() || context != nullptr ||
-				    !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
-					auto result = ref->get_int(idx, context.get()) + value;
-					ref->set_int(result, idx, context.get());
-				} else if (ref->is_member()) {
-					ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
+					if (verified && !ref->is_member() && !ref->is_const()) {
+						*ref->unchecked_value<float>(idx) = value;
+					} else {
+						this->unsafe_set_float(context, ref, idx, value);
+					}
 				}
+				ZK_VM_NEXT();
+				ZK_VM_CASE(MOVS) {
+					auto [target, target_idx, context] = unsafe_pop_reference();
+					auto const& source = pop_string();
 
-				break;
-			}
-			case DaedalusOpcode::SUBMOVI: {
-				auto [ref, idx, context] = pop_reference();
-				auto value = pop_int();
-
-				if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
-					throw DaedalusIllegalConstAccess(ref);
+					this->unsafe_set_string(context, target, target_idx, source);
+					release_statement_temporaries();
 				}
-
-				if (!ref->is_member() || context != nullptr ||
-				    !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
-					auto result = ref->get_int(idx, context.get()) - value;
-					ref->set_int(result, idx, context.get());
-				} else if (ref->is_member()) {
-					ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(MOVSS)
+				throw DaedalusVmException {"not implemented: movss"};
+				ZK_VM_CASE(ADDMOVI) {
+					auto [ref, idx, context] = verified ? pop_reference_verified() : unsafe_pop_reference();
+					auto value = ZK_VM_POP_INT();
+
+					if (verified && !ref->is_member() && !ref->is_const()) {
+						*ref->unchecked_value<std::int32_t>(idx) += value;
+					} else if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
+						throw DaedalusIllegalConstAccess(ref);
+					} else if (!ref->is_member() || context != nullptr ||
+					           !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
+						auto result = ref->get_int(idx, context) + value;
+						ref->set_int(result, idx, context);
+					} else if (ref->is_member()) {
+						ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
+					}
 				}
-				break;
-			}
-			case DaedalusOpcode::MULMOVI: {
-				auto [ref, idx, context] = pop_reference();
-				auto value = pop_int();
-
-				if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
-					throw DaedalusIllegalConstAccess(ref);
+				ZK_VM_NEXT();
+				ZK_VM_CASE(SUBMOVI) {
+					auto [ref, idx, context] = verified ? pop_reference_verified() : unsafe_pop_reference();
+					auto value = ZK_VM_POP_INT();
+
+					if (verified && !ref->is_member() && !ref->is_const()) {
+						*ref->unchecked_value<std::int32_t>(idx) -= value;
+					} else if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
+						throw DaedalusIllegalConstAccess(ref);
+					} else if (!ref->is_member() || context != nullptr ||
+					           !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
+						auto result = ref->get_int(idx, context) - value;
+						ref->set_int(result, idx, context);
+					} else if (ref->is_member()) {
+						ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
+					}
 				}
-
-				if (!ref->is_member() || context != nullptr ||
-				    !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
-					auto result = ref->get_int(idx, context.get()) * value;
-					ref->set_int(result, idx, context.get());
-				} else if (ref->is_member()) {
-					ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(MULMOVI) {
+					auto [ref, idx, context] = verified ? pop_reference_verified() : unsafe_pop_reference();
+					auto value = ZK_VM_POP_INT();
+
+					if (verified && !ref->is_member() && !ref->is_const()) {
+						*ref->unchecked_value<std::int32_t>(idx) *= value;
+					} else if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
+						throw DaedalusIllegalConstAccess(ref);
+					} else if (!ref->is_member() || context != nullptr ||
+					           !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
+						auto result = ref->get_int(idx, context) * value;
+						ref->set_int(result, idx, context);
+					} else if (ref->is_member()) {
+						ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
+					}
 				}
+				ZK_VM_NEXT();
+				ZK_VM_CASE(DIVMOVI) {
+					auto [ref, idx, context] = verified ? pop_reference_verified() : unsafe_pop_reference();
+					auto value = ZK_VM_POP_INT();
 
-				break;
-			}
-			case DaedalusOpcode::DIVMOVI: {
-				auto [ref, idx, context] = pop_reference();
-				auto value = pop_int();
+					if (value == 0) {
+						throw DaedalusVmException {"vm: division by zero"};
+					}
 
-				if (value == 0) {
-					throw DaedalusVmException {"vm: division by zero"};
+					if (verified && !ref->is_member() && !ref->is_const()) {
+						*ref->unchecked_value<std::int32_t>(idx) /= value;
+					} else if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
+						throw DaedalusIllegalConstAccess(ref);
+					} else if (!ref->is_member() || context != nullptr ||
+					           !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
+						auto result = ref->get_int(idx, context) / value;
+						ref->set_int(result, idx, context);
+					} else if (ref->is_member()) {
+						ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
+					}
 				}
-
-				if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
-					throw DaedalusIllegalConstAccess(ref);
+				ZK_VM_NEXT();
+				ZK_VM_CASE(MOVVI) {
+					auto [target, target_idx, _] = unsafe_pop_reference();
+					target->set_instance(pop_instance());
 				}
-
-				if (!ref->is_member() || context != nullptr ||
-				    !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
-					auto result = ref->get_int(idx, context.get()) / value;
-					ref->set_int(result, idx, context.get());
-				} else if (ref->is_member()) {
-					ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
+				ZK_VM_NEXT();
+				ZK_VM_CASE(B)
+				if (verified) {
+					_m_pc = instr.arg;
+				} else {
+					jump(instr.arg);
 				}
-
-				break;
-			}
-			case DaedalusOpcode::MOVVI: {
-				auto [target, target_idx, _] = pop_reference();
-				target->set_instance(pop_instance());
-				break;
-			}
-			case DaedalusOpcode::B:
-				jump(instr.address);
-				return true;
-			case DaedalusOpcode::BZ:
-				if (pop_int() == 0) {
-					jump(instr.address);
-					return true;
+				ZK_VM_DISPATCH();
+				ZK_VM_CASE(BZ)
+				if (ZK_VM_POP_INT() == 0) {
+					if (verified) {
+						_m_pc = instr.arg;
+					} else {
+						jump(instr.arg);
+					}
+					ZK_VM_DISPATCH();
 				}
-				break;
-			case DaedalusOpcode::GMOVI: {
-				sym = find_symbol_by_index(instr.symbol);
+				ZK_VM_NEXT();
+				ZK_VM_CASE(GMOVI)
+				sym = verified ? unchecked_symbol(instr.arg) : find_symbol_by_index(instr.arg);
 				if (sym == nullptr) {
 					throw DaedalusVmException {"gmovi: no symbol found for index"};
 				}
+				pin_instance(std::move(_m_instance));
 				_m_instance = sym->get_instance();
-				break;
-			}
-			case DaedalusOpcode::PUSHVV:
-				sym = find_symbol_by_index(instr.symbol);
+				ZK_VM_NEXT();
+				ZK_VM_CASE(PUSHVV)
+				sym = verified ? unchecked_symbol(instr.arg) : find_symbol_by_index(instr.arg);
 				if (sym == nullptr) {
 					throw DaedalusVmException {"pushvv: no symbol found for index"};
 				}
 
 				push_reference(sym, instr.index);
-				break;
-			}
+				ZK_VM_NEXT();
+				ZK_VM_CASE(MOVI_IMM) {
+					auto* push = compact_instruction_at(pc + instr.size);
+					auto* target = _m_flags & DaedalusVmExecutionFlag::DISABLE_SUPERINSTRUCTIONS
+					    ? nullptr
+					    : superinstruction_operand(*push, true);
+
+					if (target == nullptr) {
+						// Execute the `PUSHI` on its own and continue with the rest of the sequence.
+						push_int(static_cast<std::int32_t>(instr.arg));
+					} else {
+						*target = static_cast<std::int32_t>(instr.arg);
+						_m_pc += push->size + 1;
+					}
+				}
+				ZK_VM_NEXT();
+				ZK_VM_CASE(BZ_CMP_IMM) {
+					auto imm = static_cast<std::int32_t>(instr.arg);
+					auto* push = compact_instruction_at(pc + instr.size);
+					auto* cmp = compact_instruction_at(pc + instr.size + push->size);
+					auto* bz = compact_instruction_at(pc + instr.size + push->size + cmp->size);
+					auto* value = _m_flags & DaedalusVmExecutionFlag::DISABLE_SUPERINSTRUCTIONS
+					    ? nullptr
+					    : superinstruction_operand(*push, false);
+
+					if (value == nullptr || bz->arg >= size()) {
+						// Execute the `PUSHI` on its own and continue with the rest of the sequence.
+						push_int(imm);
+						_m_pc += instr.size;
+					} else if (compare(cmp->op, *value, imm)) {
+						_m_pc = pc + instr.size + push->size + cmp->size + bz->size;
+					} else {
+						_m_pc = bz->arg;
+					}
+				}
+				ZK_VM_DISPATCH();
+				ZK_VM_CASE(BE_IMM)
+				push_int(static_cast<std::int32_t>(instr.arg));
+				if (_m_flags & DaedalusVmExecutionFlag::DISABLE_SUPERINSTRUCTIONS) ZK_VM_NEXT();
+
+				// Continue with the `BE` directly, without going through the dispatcher.
+				_m_pc = pc += instr.size;
+				instr = *compact_instruction_at(pc);
+				goto call_external;
+#ifndef ZK_VM_THREADED
+					}
+				}
+#endif
+			} catch (DaedalusScriptError& err) {
+				uint32_t prev_pc = _m_pc;
+
+				if (_m_exception_handler) {
+					auto strategy = (*_m_exception_handler)(*this, err, instruction_at(pc));
+
+					if (strategy == DaedalusVmExceptionStrategy::FAIL) {
+						ZKLOGE("DaedalusVm", "+++ Error while executing script: %s +++", err.what());
+						print_stack_trace();
+						throw;
+					}
 
-			_m_pc += instr.size;
-		} catch (DaedalusScriptError& err) {
-			uint32_t prev_pc = _m_pc;
+					if (strategy == DaedalusVmExceptionStrategy::RETURN) {
+						if (_m_call_stack.size() <= base) {
+							return true;
+						}
 
-			if (_m_exception_handler) {
-				auto strategy = (*_m_exception_handler)(*this, err, instr);
+						return_to_caller();
+						verified = frame_is_verified();
+						continue;
+					}
 
-				if (strategy == DaedalusVmExceptionStrategy::FAIL) {
+					// The instruction may have failed after popping its operands.
+					check_frame();
+				} else {
 					ZKLOGE("DaedalusVm", "+++ Error while executing script: %s +++", err.what());
 					print_stack_trace();
 					throw;
 				}
 
-				if (strategy == DaedalusVmExceptionStrategy::RETURN) {
-					return false;
+				if (_m_pc == prev_pc) {
+					_m_pc += instr.size;
+				}
+			}
+		}
+	}
+
+#ifdef ZK_VM_THREADED
+#pragma GCC diagnostic pop
+#undef ZK_VM_THREADED
+#endif
+
+#undef ZK_VM_CASE
+#undef ZK_VM_DEFAULT
+#undef ZK_VM_DISPATCH
+#undef ZK_VM_FETCH
+#undef ZK_VM_NEXT
+#undef ZK_VM_POP_INT
+
+	bool DaedalusVm::run_optimized(DaedalusIrFunction const& fn) {
+		// Registers are always written before they are read, so they are left uninitialized.
+		std::int32_t inline_registers[32];
+		std::unique_ptr<std::int32_t[]> heap_registers;
+
+		auto* regs = inline_registers;
+		if (fn.registers > std::size(inline_registers)) {
+			heap_registers = std::make_unique_for_overwrite<std::int32_t[]>(fn.registers);
+			regs = heap_registers.get();
+		}
+
+		auto read = [&](DaedalusIrOperand const& operand) {
+			switch (operand.kind) {
+			case DaedalusIrOperandKind::CONSTANT:
+				return operand.value;
+			case DaedalusIrOperandKind::REGISTER:
+				return regs[operand.value];
+			case DaedalusIrOperandKind::VARIABLE:
+				return unsafe_get_int(_m_instance.get(), unchecked_symbol(operand.value), operand.index);
+			case DaedalusIrOperandKind::STACK:
+				break;
+			}
+
+			return pop_int();
+		};
+
+		// Pushes the values the interpreter would have on the stack onto it.
+		auto spill = [&](DaedalusIrInstruction const& ins, std::uint32_t count) {
+			for (auto i = 0u; i < count; ++i) {
+				auto const& operand = fn.live[ins.live_begin + i];
+				switch (operand.kind) {
+				case DaedalusIrOperandKind::CONSTANT:
+					push_int(operand.value);
+					break;
+				case DaedalusIrOperandKind::REGISTER:
+					push_int(regs[operand.value]);
+					break;
+				case DaedalusIrOperandKind::VARIABLE:
+					push_reference(unchecked_symbol(operand.value), operand.index);
+					break;
+				case DaedalusIrOperandKind::STACK:
+					break;
 				}
-			} else {
-				ZKLOGE("DaedalusVm", "+++ Error while executing script: %s +++", err.what());
-				print_stack_trace();
-				throw;
 			}
+		};
+
+		std::uint32_t ip = 0;
+		std::uint16_t stack_ptr = _m_stack_ptr;
+
+		for (;;) {
+			try {
+				for (;;) {
+					auto const& ins = fn.code[ip];
+					std::int32_t a, b;
+
+					stack_ptr = _m_stack_ptr;
+					if (ins.spill_count != 0) spill(ins, ins.spill_count);
+
+					switch (ins.op) {
+					case DaedalusIrOpcode::ADD:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a + b;
+						break;
+					case DaedalusIrOpcode::SUB:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a - b;
+						break;
+					case DaedalusIrOpcode::MUL:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a * b;
+						break;
+					case DaedalusIrOpcode::DIV:
+						a = read(ins.a);
+						b = read(ins.b);
+						if (b == 0) throw DaedalusVmException {"vm: division by zero"};
+						regs[ins.arg] = a / b;
+						break;
+					case DaedalusIrOpcode::MOD:
+						a = read(ins.a);
+						b = read(ins.b);
+						if (b == 0) throw DaedalusVmException {"vm: division by zero"};
+						regs[ins.arg] = a % b;
+						break;
+					case DaedalusIrOpcode::OR:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a | b;
+						break;
+					case DaedalusIrOpcode::ANDB:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a & b;
+						break;
+					case DaedalusIrOpcode::LT:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a < b;
+						break;
+					case DaedalusIrOpcode::GT:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a > b;
+						break;
+					case DaedalusIrOpcode::LSL:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a << b;
+						break;
+					case DaedalusIrOpcode::LSR:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a >> b;
+						break;
+					case DaedalusIrOpcode::LTE:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a <= b;
+						break;
+					case DaedalusIrOpcode::EQ:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a == b;
+						break;
+					case DaedalusIrOpcode::NEQ:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a != b;
+						break;
+					case DaedalusIrOpcode::GTE:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a >= b;
+						break;
+					case DaedalusIrOpcode::ORR:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a || b;
+						break;
+					case DaedalusIrOpcode::AND:
+						a = read(ins.a);
+						b = read(ins.b);
+						regs[ins.arg] = a && b;
+						break;
+					case DaedalusIrOpcode::PLUS:
+						regs[ins.arg] = +read(ins.a);
+						break;
+					case DaedalusIrOpcode::NEGATE:
+						regs[ins.arg] = -read(ins.a);
+						break;
+					case DaedalusIrOpcode::NOT:
+						regs[ins.arg] = !read(ins.a);
+						break;
+					case DaedalusIrOpcode::CMPL:
+						regs[ins.arg] = ~read(ins.a);
+						break;
+					case DaedalusIrOpcode::MOVI:
+						a = read(ins.a);
+						unsafe_set_int(_m_instance.get(), unchecked_symbol(ins.b.value), ins.b.index, a);
+						if (ins.arg != DaedalusIrInstruction::NO_REGISTER) regs[ins.arg] = a;
+						break;
+					case DaedalusIrOpcode::ADDMOVI:
+					case DaedalusIrOpcode::SUBMOVI:
+					case DaedalusIrOpcode::MULMOVI:
+					case DaedalusIrOpcode::DIVMOVI: {
+						constexpr DaedalusOpcode UPDATES[] = {
+						    DaedalusOpcode::ADDMOVI,
+						    DaedalusOpcode::SUBMOVI,
+						    DaedalusOpcode::MULMOVI,
+						    DaedalusOpcode::DIVMOVI,
+						};
+
+						auto op = UPDATES[static_cast<int>(ins.op) - static_cast<int>(DaedalusIrOpcode::ADDMOVI)];
+						a = read(ins.a);
+						unsafe_update_int(op, _m_instance.get(), unchecked_symbol(ins.b.value), ins.b.index, a);
+						break;
+					}
+					case DaedalusIrOpcode::JUMP:
+						ip = ins.arg;
+						continue;
+					case DaedalusIrOpcode::JUMP_ZERO:
+						if (read(ins.a) == 0) {
+							ip = ins.arg;
+							continue;
+						}
+						break;
+					case DaedalusIrOpcode::CALL:
+						_m_pc = ins.pc;
+						native_bl(ins.arg);
+						break;
+					case DaedalusIrOpcode::CALL_EXTERNAL:
+						_m_pc = ins.pc;
+						native_be(ins.arg);
+						break;
+					case DaedalusIrOpcode::STACK:
+						_m_pc = ins.pc;
+						switch (ins.code) {
+						case DaedalusOpcode::MOVF:
+							native_movf();
+							break;
+						case DaedalusOpcode::MOVS:
+							native_movs();
+							break;
+						case DaedalusOpcode::MOVVI:
+							native_movvi();
+							break;
+						case DaedalusOpcode::GMOVI:
+							native_gmovi(ins.arg);
+							break;
+						case DaedalusOpcode::MOVI:
+						case DaedalusOpcode::MOVVF:
+							native_movi();
+							break;
+						default:
+							native_update_int(ins.code);
+							break;
+						}
+						break;
+					case DaedalusIrOpcode::RETURN:
+						return true;
+					case DaedalusIrOpcode::EXIT:
+						_m_pc = ins.pc;
+						return false;
+					}
+
+					++ip;
+				}
+			} catch (DaedalusScriptError const& err) {
+				auto const& ins = fn.code[ip];
+
+				// Calls and instructions executed on the stack behave exactly like in the interpreter, so their
+				// errors are handled the same way.
+				if (ins.op == DaedalusIrOpcode::CALL || ins.op == DaedalusIrOpcode::CALL_EXTERNAL ||
+				    ins.op == DaedalusIrOpcode::STACK) {
+					auto pc = ins.pc;
+					if (!native_handle_error(err, pc)) return true;
+
+					++ip;
+					continue;
+				}
 
-			if (_m_pc == prev_pc) {
-				_m_pc += instr.size;
+				// Anything else has not changed any state yet, so restore the stack the interpreter would have and
+				// let it execute the failing instruction again. It fails the same way and handles the error.
+				_m_stack_ptr = stack_ptr;
+				spill(ins, ins.live_count);
+				_m_pc = ins.pc;
+				return false;
 			}
 		}
+	}
 
-		return true;
+	void DaedalusVm::return_to_caller() {
+		pop_call();
+
+		// The program counter now points to the instruction which made the call, so skip it.
+		auto const* call = compact_instruction_at(_m_pc);
+		_m_pc += call != nullptr ? call->size : instruction_at(_m_pc).size;
 	}
 
 	void DaedalusVm::push_call(DaedalusSymbol const* sym) {
+		ZK_VM_PROFILE(enter(*sym));
+
+		auto* fn = find_function_info(sym);
+		if (fn == nullptr) {
+			auto var_count = this->find_parameters_for_function(sym).size();
+			_m_call_stack.push_back({sym,
+			                         _m_pc,
+			                         _m_stack_ptr - static_cast<uint32_t>(var_count),
+			                         _m_instance,
+			                         false,
+			                         _m_temporary_strings_used});
+			return;
+		}
+
 		if (sym->has_local_variables_enabled()) {
 			push_local_variables(sym);
 		}
-		auto var_count = this->find_parameters_for_function(sym).size();
-		_m_call_stack.push_back({sym, _m_pc, _m_stack_ptr - static_cast<uint32_t>(var_count), _m_instance});
+
+		_m_function_depth[sym->function_index()] += 1;
+		_m_call_stack.push_back(
+		    {sym, _m_pc, _m_stack_ptr - fn->params_count, _m_instance, false, _m_temporary_strings_used});
 	}
 
 	void DaedalusVm::pop_call() {
@@ -479,9 +1879,9 @@ namespace zenkit {
 			} else if (remaining_locals > 1) {
 				// Now we have too many items left on the stack. Remove all of them, except the topmost one,
 				// since that one is supposed to be the return value of the function.
-				DaedalusStackFrame frame = _m_stack[--_m_stack_ptr];
+				auto slot = _m_stack[--_m_stack_ptr];
 				_m_stack_ptr = call.stack_ptr;
-				_m_stack[_m_stack_ptr++] = std::move(frame);
+				_m_stack[_m_stack_ptr++] = slot;
 			}
 			// else {
 			//     We have exactly one value to be returned (as indicated by the symbol's return type).
@@ -490,52 +1890,63 @@ namespace zenkit {
 			// }
 		}
 
-		if (call.function->has_local_variables_enabled()) {
+		if (call.function->function_index() < _m_function_depth.size() &&
+		    call.function->has_local_variables_enabled()) {
 			pop_local_variables(call.function);
 		}
 
-		// Second, reset PC and context, then remove the call stack frame
+		discard_call();
+	}
+
+	void DaedalusVm::discard_call() {
+		auto const& call = _m_call_stack.back();
+
+		if (auto index = call.function->function_index(); index < _m_function_depth.size()) {
+			_m_function_depth[index] -= 1;
+		}
+
+		ZK_VM_PROFILE(leave());
+
+		// Reset PC and context, then remove the call stack frame
 		_m_pc = call.program_counter;
-		_m_instance = call.context;
+		if (_m_instance != call.context) {
+			// The function changed the instance and a reference to it might be its return value.
+			pin_instance(std::move(_m_instance));
+			_m_instance = call.context;
+		}
 		_m_call_stack.pop_back();
 	}
 
-	void DaedalusVm::push_local_variables(DaedalusSymbol const* sym) {
-		bool has_recursion = false;
-		for (auto& i : _m_call_stack) {
-			if (i.function == sym) {
-				has_recursion = true;
-				break;
+	void DaedalusVm::unwind_call_stack(std::size_t call_stack_size, std::uint32_t stack_ptr) noexcept {
+		while (_m_call_stack.size() > call_stack_size) {
+			// Return from the function as if it had run to completion, which also restores the local variables of
+			// recursive calls. They are below the frame's stack pointer, so they were not touched by the function.
+			_m_stack_ptr = static_cast<std::uint16_t>(_m_call_stack.back().stack_ptr);
+
+			try {
+				pop_call();
+			} catch (...) {
+				discard_call();
 			}
 		}
 
-		if (!has_recursion) {
+		_m_stack_ptr = static_cast<std::uint16_t>(std::min<std::uint32_t>(stack_ptr, _m_stack_ptr));
+
+		if (_m_call_stack.empty()) {
+			release_temporaries();
+		}
+	}
+
+	void DaedalusVm::push_local_variables(DaedalusSymbol const* sym) {
+		// Only save the locals if the function is already running, i.e. this call is recursive.
+		auto* fn = find_function_info(sym);
+		if (fn == nullptr || _m_function_depth[sym->function_index()] == 0) {
 			return;
 		}
 
 		auto params = this->find_parameters_for_function(sym);
 		auto locals = this->find_locals_for_function(sym);
-
-		// estimate stack storage for local copy of variables
-		std::uint32_t locals_size = 0;
-		for (auto& l : locals) {
-			switch (l.type()) {
-			case DaedalusDataType::VOID:
-				break;
-			case DaedalusDataType::FLOAT:
-			case DaedalusDataType::FUNCTION:
-			case DaedalusDataType::INT:
-			case DaedalusDataType::STRING:
-				locals_size += l.count();
-				break;
-			case DaedalusDataType::INSTANCE:
-				locals_size += 1;
-				break;
-			case DaedalusDataType::CLASS:
-			case DaedalusDataType::PROTOTYPE:
-				break;
-			}
-		}
+		auto locals_size = fn->locals_footprint;
 
 		if (_m_stack_ptr + locals_size > stack_size) {
 			throw DaedalusVmException {"stack overflow"};
@@ -549,7 +1960,7 @@ namespace zenkit {
 		// arguments for the next call have already been pushed.
 		_m_stack_ptr -= params.size();
 		for (size_t i = 0; i < params.size(); ++i) {
-			_m_stack[_m_stack_ptr + locals_size + i] = std::move(_m_stack[_m_stack_ptr + i]);
+			_m_stack[_m_stack_ptr + locals_size + i] = _m_stack[_m_stack_ptr + i];
 		}
 
 		for (auto& l : locals) {
@@ -586,20 +1997,14 @@ namespace zenkit {
 	}
 
 	void DaedalusVm::pop_local_variables(DaedalusSymbol const* sym) {
-		int has_recursion = 0;
-		for (auto& i : _m_call_stack) {
-			if (i.function == sym) {
-				++has_recursion;
-			}
-		}
-
-		if (has_recursion <= 1) {
+		// The locals were only saved if an outer call of the function is still running.
+		if (sym->function_index() >= _m_function_depth.size() || _m_function_depth[sym->function_index()] <= 1) {
 			return;
 		}
 
-		DaedalusStackFrame ret;
+		DaedalusStackSlot ret {};
 		if (sym->has_return()) {
-			ret = std::move(_m_stack[--_m_stack_ptr]);
+			ret = _m_stack[--_m_stack_ptr];
 		}
 
 		auto locals = this->find_locals_for_function(sym);
@@ -639,32 +2044,82 @@ namespace zenkit {
 		}
 
 		if (sym->has_return()) {
-			_m_stack[_m_stack_ptr++] = std::move(ret);
+			_m_stack[_m_stack_ptr++] = ret;
 		}
 	}
 
+	std::shared_ptr<DaedalusInstance> DaedalusVm::share_instance(DaedalusInstance* instance) const {
+		if (instance == nullptr) return nullptr;
+
+		if (auto owned = instance->weak_from_this().lock(); owned != nullptr) {
+			return owned;
+		}
+
+		// The instance does not know its owner, for example because its type derives from
+		// std::enable_shared_from_this a second time. Find the owner which keeps it alive instead.
+		for (auto const& pinned : _m_pinned_instances) {
+			if (pinned.get() == instance) return pinned;
+		}
+
+		if (_m_instance.get() == instance) return _m_instance;
+
+		for (auto const& frame : _m_call_stack) {
+			if (frame.context.get() == instance) return frame.context;
+		}
+
+		for (auto const& sym : symbols()) {
+			auto const* value = std::get_if<std::shared_ptr<DaedalusInstance>>(&sym._m_value);
+			if (value != nullptr && value->get() == instance) return *value;
+		}
+
+		throw DaedalusVmException {"instance on the stack is not owned by a std::shared_ptr"};
+	}
+
+	void DaedalusVm::unpin_instance(DaedalusInstance* instance) {
+		auto it = std::find_if(_m_pinned_instances.begin(), _m_pinned_instances.end(), [instance](auto const& pinned) {
+			return pinned.get() == instance;
+		});
+		if (it == _m_pinned_instances.end()) return;
+
+		auto stack = std::span {_m_stack.data(), _m_stack_ptr};
+		auto referenced = std::any_of(stack.begin(), stack.end(), [instance](auto const& slot) {
+			return slot.instance == instance;
+		});
+		if (referenced) return;
+
+		*it = std::move(_m_pinned_instances.back());
+		_m_pinned_instances.pop_back();
+	}
+
 	void DaedalusVm::push_int(std::int32_t value) {
 		if (_m_stack_ptr == stack_size) {
 			throw DaedalusVmException {"stack overflow"};
 		}
 
-		_m_stack[_m_stack_ptr++] = {nullptr, false, value};
+		auto& slot = _m_stack[_m_stack_ptr++];
+		slot.i = value;
+		slot.type = DaedalusStackSlot::Type::INT;
+		slot.instance = nullptr;
 	}
 
-	void DaedalusVm::push_reference(DaedalusSymbol* value, std::uint8_t index) {
+	void DaedalusVm::push_reference(DaedalusSymbol* value, std::uint16_t index) {
 		if (_m_stack_ptr == stack_size) {
 			throw DaedalusVmException {"stack overflow"};
 		}
 
-		_m_stack[_m_stack_ptr++] = {_m_instance, true, value, index};
+		auto& slot = _m_stack[_m_stack_ptr++];
+		slot.symbol = value->index();
+		slot.type = DaedalusStackSlot::Type::REFERENCE;
+		slot.index = index;
+		slot.instance = _m_instance.get();
 	}
 
 	void DaedalusVm::push_string(std::string_view value) {
 		// We need to push strings without an explicitly attached variable to a
 		// virtual string container variable.
-		auto index = this->get_free_string();
+		auto index = allocate_temporary_string();
 
-		_m_temporary_strings->set_string(value, index);
+		_m_temporary_strings->unchecked_value<std::string>(index)->assign(value);
 		push_reference(_m_temporary_strings, index);
 	}
 
@@ -673,7 +2128,10 @@ namespace zenkit {
 			throw DaedalusVmException {"stack overflow"};
 		}
 
-		_m_stack[_m_stack_ptr++] = {nullptr, false, value};
+		auto& slot = _m_stack[_m_stack_ptr++];
+		slot.f = value;
+		slot.type = DaedalusStackSlot::Type::FLOAT;
+		slot.instance = nullptr;
 	}
 
 	void DaedalusVm::push_instance(std::shared_ptr<DaedalusInstance> value) {
@@ -681,7 +2139,13 @@ namespace zenkit {
 			throw DaedalusVmException {"stack overflow"};
 		}
 
-		_m_stack[_m_stack_ptr++] = {nullptr, false, value};
+		auto& slot = _m_stack[_m_stack_ptr++];
+		slot.i = 0;
+		slot.type = DaedalusStackSlot::Type::INSTANCE;
+		slot.instance = value.get();
+
+		// The instance comes from C++ code, so we can't know whether anything else keeps it alive.
+		pin_instance(std::move(value));
 	}
 
 	std::int32_t DaedalusVm::pop_int() {
@@ -689,14 +2153,14 @@ namespace zenkit {
 			return 0;
 		}
 
-		DaedalusStackFrame v = std::move(_m_stack[--_m_stack_ptr]);
+		auto const& v = _m_stack[--_m_stack_ptr];
 
-		if (v.reference) {
-			return this->get_int(v.context, v.value, v.index);
+		if (v.type == DaedalusStackSlot::Type::REFERENCE) {
+			return this->unsafe_get_int(v.instance, find_symbol_by_index(v.symbol), v.index);
 		}
 
-		if (std::holds_alternative<int32_t>(v.value)) {
-			return std::get<int32_t>(v.value);
+		if (v.type == DaedalusStackSlot::Type::INT) {
+			return v.i;
 		}
 
 		throw DaedalusVmException {"tried to pop_int but frame does not contain a int."};
@@ -707,47 +2171,129 @@ namespace zenkit {
 			return 0.0f;
 		}
 
-		DaedalusStackFrame v = std::move(_m_stack[--_m_stack_ptr]);
+		auto const& v = _m_stack[--_m_stack_ptr];
 
-		if (v.reference) {
-			return this->get_float(v.context, v.value, v.index);
+		if (v.type == DaedalusStackSlot::Type::REFERENCE) {
+			return this->unsafe_get_float(v.instance, find_symbol_by_index(v.symbol), v.index);
 		}
 
-		if (std::holds_alternative<float>(v.value)) {
-			return std::get<float>(v.value);
+		if (v.type == DaedalusStackSlot::Type::FLOAT) {
+			return v.f;
 		}
 
-		if (std::holds_alternative<std::int32_t>(v.value)) {
-			auto k = std::get<std::int32_t>(v.value);
-
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wstrict-aliasing"
-			return *reinterpret_cast<float*>(&k);
-#pragma GCC diagnostic pop
+		if (v.type == DaedalusStackSlot::Type::INT) {
+			return std::bit_cast<float>(v.i);
 		}
 
 		throw DaedalusVmException {"tried to pop_float but frame does not contain a float."};
 	}
 
-	std::tuple<DaedalusSymbol*, std::uint8_t, std::shared_ptr<DaedalusInstance>> DaedalusVm::pop_reference() {
+	std::int32_t DaedalusVm::pop_int_verified() {
+		auto const& v = _m_stack[--_m_stack_ptr];
+
+		if (v.type != DaedalusStackSlot::Type::REFERENCE) {
+			return v.i;
+		}
+
+		auto* sym = unchecked_symbol(v.symbol);
+		if (sym->is_member()) {
+			return this->unsafe_get_int(v.instance, sym, v.index);
+		}
+
+		return *sym->unchecked_value<std::int32_t>(v.index);
+	}
+
+	float DaedalusVm::pop_float_verified() {
+		auto const& v = _m_stack[--_m_stack_ptr];
+
+		if (v.type == DaedalusStackSlot::Type::FLOAT) {
+			return v.f;
+		}
+
+		if (v.type == DaedalusStackSlot::Type::INT) {
+			return std::bit_cast<float>(v.i);
+		}
+
+		auto* sym = unchecked_symbol(v.symbol);
+		if (sym->is_member()) {
+			return this->unsafe_get_float(v.instance, sym, v.index);
+		}
+
+		return *sym->unchecked_value<float>(v.index);
+	}
+
+	bool DaedalusVm::honors_signature(DaedalusSymbol const* sym, std::uint32_t stack_ptr) const noexcept {
+		if (_m_stack_ptr != stack_ptr - sym->count() + sym->has_return()) return false;
+		if (!sym->has_return()) return true;
+
+		// The return value has to be of the kind the verifier assumed, since verified code pops it without checks.
+		auto const& v = _m_stack[_m_stack_ptr - 1];
+		auto const* ref = v.type == DaedalusStackSlot::Type::REFERENCE ? find_symbol_by_index(v.symbol) : nullptr;
+
+		switch (sym->rtype()) {
+		case DaedalusDataType::INT:
+		case DaedalusDataType::FUNCTION:
+			return v.type == DaedalusStackSlot::Type::INT;
+		case DaedalusDataType::FLOAT:
+			return v.type == DaedalusStackSlot::Type::FLOAT;
+		case DaedalusDataType::INSTANCE:
+			return v.type == DaedalusStackSlot::Type::INSTANCE;
+		case DaedalusDataType::STRING:
+			return ref != nullptr && ref->type() == DaedalusDataType::STRING && v.index < ref->count();
+		default:
+			return false;
+		}
+	}
+
+	std::tuple<DaedalusSymbol*, std::uint16_t, DaedalusInstance*> DaedalusVm::pop_reference_verified() {
+		auto const& v = _m_stack[--_m_stack_ptr];
+		return {unchecked_symbol(v.symbol), v.index, v.instance};
+	}
+
+	std::tuple<DaedalusSymbol*, std::uint16_t, DaedalusInstance*> DaedalusVm::unsafe_pop_reference() {
 		if (_m_stack_ptr == 0) {
 			throw DaedalusVmException {"popping reference from empty stack"};
 		}
 
-		DaedalusStackFrame v = std::move(_m_stack[--_m_stack_ptr]);
+		auto const& v = _m_stack[--_m_stack_ptr];
 
-		if (!v.reference) {
+		if (v.type != DaedalusStackSlot::Type::REFERENCE) {
 			throw DaedalusVmException {"tried to pop_reference but frame does not contain a reference."};
 		}
 
-		auto sym = std::get<DaedalusSymbol*>(v.value);
-		if (sym->index() == _m_temporary_strings->index()) {
-			// For virtual strings, we'll mark this string as free when it's popped.
-			// This is likely unreliable but until it causes issues, it'll stay as-is.
-			this->mark_free_string(v.index);
+		return {find_symbol_by_index(v.symbol), v.index, v.instance};
+	}
+
+	std::int32_t* DaedalusVm::superinstruction_operand(DaedalusCompactInstruction const& push, bool assign) {
+		auto* sym = find_symbol_by_index(push.arg);
+		if (sym == nullptr || (sym->has_access_trap() && _m_access_trap) || push.index >= sym->count()) {
+			return nullptr;
+		}
+
+		if (sym->type() != DaedalusDataType::INT && sym->type() != DaedalusDataType::FUNCTION) {
+			return nullptr;
+		}
+
+		if (assign && sym->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
+			return nullptr;
+		}
+
+		if (!sym->is_member()) {
+			return sym->unchecked_value<std::int32_t>(push.index);
+		}
+
+		// Transient instances and instances of unexpected types are handled by the regular instructions.
+		auto* context = _m_instance.get();
+		if (context == nullptr || sym->_m_registered_to != context->_m_type) {
+			return nullptr;
 		}
 
-		return {std::get<DaedalusSymbol*>(v.value), v.index, v.context};
+		return sym->get_member_ptr<std::int32_t>(push.index, context);
+	}
+
+	std::tuple<DaedalusSymbol*, std::uint16_t, std::shared_ptr<DaedalusInstance>> DaedalusVm::pop_reference() {
+		auto [sym, index, context] = unsafe_pop_reference();
+		return {sym, index, share_instance(context)};
 	}
 
 	bool DaedalusVm::top_is_reference() const {
@@ -755,7 +2301,7 @@ namespace zenkit {
 			throw DaedalusVmException {"popping from empty stack"};
 		}
 
-		return _m_stack[_m_stack_ptr - 1].reference;
+		return _m_stack[_m_stack_ptr - 1].type == DaedalusStackSlot::Type::REFERENCE;
 	}
 
 	std::shared_ptr<DaedalusInstance> DaedalusVm::pop_instance() {
@@ -763,14 +2309,17 @@ namespace zenkit {
 			throw DaedalusVmException {"popping instance from empty stack"};
 		}
 
-		DaedalusStackFrame v = std::move(_m_stack[--_m_stack_ptr]);
+		auto const& v = _m_stack[--_m_stack_ptr];
 
-		if (v.reference) {
-			return std::get<DaedalusSymbol*>(v.value)->get_instance();
+		if (v.type == DaedalusStackSlot::Type::REFERENCE) {
+			return find_symbol_by_index(v.symbol)->get_instance();
 		}
 
-		if (std::holds_alternative<std::shared_ptr<DaedalusInstance>>(v.value)) {
-			return std::get<std::shared_ptr<DaedalusInstance>>(v.value);
+		if (v.type == DaedalusStackSlot::Type::INSTANCE) {
+			// Instances pushed from C++ are pinned until they are popped again.
+			auto instance = share_instance(v.instance);
+			unpin_instance(v.instance);
+			return instance;
 		}
 
 		throw DaedalusVmException {"tried to pop_instance but frame does not contain am instance."};
@@ -778,7 +2327,7 @@ namespace zenkit {
 
 	std::string const& DaedalusVm::pop_string() {
 		static std::string empty {};
-		auto [s, i, context] = pop_reference();
+		auto [s, i, context] = unsafe_pop_reference();
 
 		// compatibility: sometimes the context might be zero, but we can't fail so when
 		//                the compatibility flag is set, we just return 0
@@ -791,7 +2340,19 @@ namespace zenkit {
 			return empty;
 		}
 
-		return s->get_string(i, context.get());
+		return s->get_string(i, context);
+	}
+
+	void DaedalusVm::bind_callback(DaedalusSymbol* sym, std::function<void(DaedalusVm&)> callback) {
+		if (sym->_m_callback >= _m_callbacks.size()) {
+			sym->_m_callback = static_cast<std::uint32_t>(_m_callbacks.size());
+			_m_callbacks.emplace_back();
+		}
+
+		_m_callbacks[sym->_m_callback] = std::move(callback);
+
+		// Cached instances may have been initialized by calling the function which is now overridden.
+		clear_instance_cache();
 	}
 
 	void DaedalusVm::jump(std::uint32_t address) {
@@ -817,7 +2378,7 @@ namespace zenkit {
 				else if (par.type() == DaedalusDataType::FLOAT)
 					(void) v.pop_float();
 				else if (par.type() == DaedalusDataType::INSTANCE || par.type() == DaedalusDataType::STRING)
-					(void) v.pop_reference();
+					(void) v.unsafe_pop_reference();
 			}
 
 			if (sym.has_return()) {
@@ -851,6 +2412,27 @@ namespace zenkit {
 		_m_exception_handler = callback;
 	}
 
+	void DaedalusVm::enable_profiler(bool enable) {
+		if (!enable) {
+			_m_profiler.reset();
+			return;
+		}
+
+#ifndef _ZK_WITH_VM_PROFILER
+		ZKLOGW("DaedalusVm", "Profiling is not supported by this build of ZenKit (see ZK_ENABLE_VM_PROFILER)");
+#endif
+		_m_profiler = std::make_unique<DaedalusProfiler>();
+	}
+
+	void DaedalusVm::enable_trace(std::uint32_t capacity) {
+		if (capacity == 0) {
+			_m_trace.reset();
+			return;
+		}
+
+		_m_trace = std::make_unique<DaedalusTrace>(capacity);
+	}
+
 	void DaedalusVm::print_stack_trace() const {
 		auto last_pc = _m_pc;
 		auto tmp_stack_ptr = _m_stack_ptr;
@@ -872,8 +2454,9 @@ namespace zenkit {
 		while (tmp_stack_ptr > 0) {
 			auto& v = _m_stack[--tmp_stack_ptr];
 
-			if (v.reference) {
-				auto ref = std::get<DaedalusSymbol*>(v.value);
+			if (v.type == DaedalusStackSlot::Type::REFERENCE) {
+				// DaedalusSymbol::get_instance is not const, even though it does not modify the symbol.
+				auto ref = const_cast<DaedalusSymbol*>(find_symbol_by_index(v.symbol));
 				std::string value;
 
 				switch (ref->type()) {
@@ -911,12 +2494,12 @@ namespace zenkit {
 				       v.index,
 				       value.c_str());
 			} else {
-				if (std::holds_alternative<float>(v.value)) {
-					ZKLOGE("DaedalusVm", "%d: [IMMEDIATE FLOAT] = %f", tmp_stack_ptr, std::get<float>(v.value));
-				} else if (std::holds_alternative<int32_t>(v.value)) {
-					ZKLOGE("DaedalusVm", "%d: [IMMEDIATE INT] = %d", tmp_stack_ptr, std::get<int32_t>(v.value));
-				} else if (std::holds_alternative<std::shared_ptr<DaedalusInstance>>(v.value)) {
-					if (auto& inst = std::get<std::shared_ptr<DaedalusInstance>>(v.value); inst == nullptr) {
+				if (v.type == DaedalusStackSlot::Type::FLOAT) {
+					ZKLOGE("DaedalusVm", "%d: [IMMEDIATE FLOAT] = %f", tmp_stack_ptr, v.f);
+				} else if (v.type == DaedalusStackSlot::Type::INT) {
+					ZKLOGE("DaedalusVm", "%d: [IMMEDIATE INT] = %d", tmp_stack_ptr, v.i);
+				} else if (v.type == DaedalusStackSlot::Type::INSTANCE) {
+					if (auto* inst = v.instance; inst == nullptr) {
 						ZKLOGE("DaedalusVm", "%d: [IMMEDIATE INSTANCE] = NULL", tmp_stack_ptr);
 					} else {
 						ZKLOGE("DaedalusVm",
@@ -928,6 +2511,27 @@ namespace zenkit {
 			}
 		}
 
+		if (_m_trace != nullptr) {
+			ZKLOGE("DaedalusVm", "------- TRACE (MOST RECENT INSTRUCTION FIRST) -------");
+
+			// Only the most recent instructions are of interest here. See DaedalusTrace::write for the full trace.
+			static constexpr std::size_t TRACE_PRINT_LIMIT = 32;
+
+			auto entries = _m_trace->entries();
+			auto end = entries.size() > TRACE_PRINT_LIMIT ? entries.size() - TRACE_PRINT_LIMIT : 0;
+
+			for (auto i = entries.size(); i > end; --i) {
+				auto const& entry = entries[i - 1];
+				auto const* fn = find_symbol_by_index(entry.function);
+				ZKLOGE("DaedalusVm",
+				       "in %s at %x: op %u, stack depth %u",
+				       fn == nullptr ? "<unknown>" : fn->name().c_str(),
+				       entry.pc,
+				       static_cast<unsigned>(entry.op),
+				       static_cast<unsigned>(entry.stack_depth));
+			}
+		}
+
 		ZKLOGE("DaedalusVm", "------- GLOBAL VARIABLES -------");
 
 		DaedalusSymbol* symbols[] = {
@@ -1052,6 +2656,12 @@ namespace zenkit {
 		case DaedalusOpcode::GMOVI:
 			// do nothing for now but ideally, this would set the `null` instance
 			break;
+
+		case DaedalusOpcode::MOVI_IMM:
+		case DaedalusOpcode::BZ_CMP_IMM:
+		case DaedalusOpcode::BE_IMM:
+			// superinstructions are reported as the instructions they replace, so these never occur here.
+			break;
 		}
 
 		return DaedalusVmExceptionStrategy::CONTINUE;
@@ -1061,8 +2671,38 @@ namespace zenkit {
 	DaedalusVm::get_int(std::shared_ptr<DaedalusInstance> const& context,
 	                    std::variant<int32_t, float, DaedalusSymbol*, std::shared_ptr<DaedalusInstance>> const& value,
 	                    uint16_t index) const {
-		auto* sym = std::get<DaedalusSymbol*>(value);
+		return this->unsafe_get_int(context.get(), std::get<DaedalusSymbol*>(value), index);
+	}
+
+	float
+	DaedalusVm::get_float(std::shared_ptr<DaedalusInstance> const& context,
+	                      std::variant<int32_t, float, DaedalusSymbol*, std::shared_ptr<DaedalusInstance>> const& value,
+	                      uint16_t index) const {
+		return this->unsafe_get_float(context.get(), std::get<DaedalusSymbol*>(value), index);
+	}
+
+	void DaedalusVm::set_int(std::shared_ptr<DaedalusInstance> const& context,
+	                         DaedalusSymbol* ref,
+	                         uint16_t index,
+	                         std::int32_t value) {
+		this->unsafe_set_int(context.get(), ref, index, value);
+	}
+
+	void DaedalusVm::set_float(std::shared_ptr<DaedalusInstance> const& context,
+	                           DaedalusSymbol* ref,
+	                           uint16_t index,
+	                           float value) {
+		this->unsafe_set_float(context.get(), ref, index, value);
+	}
 
+	void DaedalusVm::set_string(std::shared_ptr<DaedalusInstance> const& context,
+	                            DaedalusSymbol* ref,
+	                            uint16_t index,
+	                            std::string_view value) {
+		this->unsafe_set_string(context.get(), ref, index, value);
+	}
+
+	std::int32_t DaedalusVm::unsafe_get_int(DaedalusInstance* context, DaedalusSymbol* sym, std::uint16_t index) const {
 		// compatibility: sometimes the context might be zero, but we can't fail so when
 		//                the compatibility flag is set, we just return 0
 		if (sym->is_member() && context == nullptr) {
@@ -1074,15 +2714,10 @@ namespace zenkit {
 			return 0;
 		}
 
-		return sym->get_int(index, context.get());
+		return sym->get_int(index, context);
 	}
 
-	float
-	DaedalusVm::get_float(std::shared_ptr<DaedalusInstance> const& context,
-	                      std::variant<int32_t, float, DaedalusSymbol*, std::shared_ptr<DaedalusInstance>> const& value,
-	                      uint16_t index) const {
-		auto* sym = std::get<DaedalusSymbol*>(value);
-
+	float DaedalusVm::unsafe_get_float(DaedalusInstance* context, DaedalusSymbol* sym, std::uint16_t index) const {
 		// compatibility: sometimes the context might be zero, but we can't fail so when
 		//                the compatibility flag is set, we just return 0
 		if (sym->is_member() && context == nullptr) {
@@ -1094,75 +2729,52 @@ namespace zenkit {
 			return 0;
 		}
 
-		return sym->get_float(index, context.get());
+		return sym->get_float(index, context);
 	}
 
-	void DaedalusVm::set_int(std::shared_ptr<DaedalusInstance> const& context,
-	                         DaedalusSymbol* ref,
-	                         uint16_t index,
-	                         std::int32_t value) {
+	void DaedalusVm::unsafe_set_int(DaedalusInstance* context,
+	                                DaedalusSymbol* ref,
+	                                std::uint16_t index,
+	                                std::int32_t value) {
 		if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
 			throw DaedalusIllegalConstAccess {ref};
 		}
 
 		if (!ref->is_member() || context != nullptr ||
 		    !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
-			ref->set_int(value, index, context.get());
+			ref->set_int(value, index, context);
 		} else if (ref->is_member()) {
 			ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
 		}
 	}
 
-	void DaedalusVm::set_float(std::shared_ptr<DaedalusInstance> const& context,
-	                           DaedalusSymbol* ref,
-	                           uint16_t index,
-	                           float value) {
+	void
+	DaedalusVm::unsafe_set_float(DaedalusInstance* context, DaedalusSymbol* ref, std::uint16_t index, float value) {
 		if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
 			throw DaedalusIllegalConstAccess {ref};
 		}
 
 		if (!ref->is_member() || context != nullptr ||
 		    !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
-			ref->set_float(value, index, context.get());
+			ref->set_float(value, index, context);
 		} else if (ref->is_member()) {
 			ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
 		}
 	}
 
-	void DaedalusVm::set_string(std::shared_ptr<DaedalusInstance> const& context,
-	                            DaedalusSymbol* ref,
-	                            uint16_t index,
-	                            std::string_view value) {
+	void DaedalusVm::unsafe_set_string(DaedalusInstance* context,
+	                                   DaedalusSymbol* ref,
+	                                   std::uint16_t index,
+	                                   std::string_view value) {
 		if (ref->is_const() && !(_m_flags & DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER)) {
 			throw DaedalusIllegalConstAccess {ref};
 		}
 
 		if (!ref->is_member() || context != nullptr ||
 		    !(_m_flags & DaedalusVmExecutionFlag::ALLOW_NULL_INSTANCE_ACCESS)) {
-			ref->set_string(value, index, context.get());
+			ref->set_string(value, index, context);
 		} else if (ref->is_member()) {
 			ZKLOGE("DaedalusVm", "Accessing member \"%s\" without an instance set", ref->name().c_str());
 		}
 	}
-
-	void DaedalusVm::mark_free_string(uint32_t index) {
-		this->_m_temporary_strings_free.push(index);
-	}
-
-	uint32_t DaedalusVm::get_free_string() {
-		if (_m_temporary_strings_free.size() == 0) {
-			// Like a normal array, we'll grow exponentially.
-			auto prev_size = _m_temporary_strings->count();
-			_m_temporary_strings->grow(prev_size * 2);
-
-			// Mark new strings as unused.
-			for (uint32_t i = prev_size; i < _m_temporary_strings->count(); ++i) {
-				_m_temporary_strings_free.push(i);
-			}
-		}
-
-		auto index = this->_m_temporary_strings_free.top();
-		this->_m_temporary_strings_free.pop();
-		return index;
-	}
 } // namespace zenkit
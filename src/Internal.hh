@@ -3,6 +3,9 @@
 #pragma once
 #include "zenkit/Logger.hh"
 #include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
 
 #ifndef _MSC_VER
 	#define ZKLOGT(...) zenkit::Logger::log(zenkit::LogLevel::TRACE, __VA_ARGS__)
@@ -17,3 +20,28 @@
 	#define ZKLOGW(...) zenkit::Logger::log(zenkit::LogLevel::WARNING, ##__VA_ARGS__)
 	#define ZKLOGE(...) zenkit::Logger::log(zenkit::LogLevel::ERROR, ##__VA_ARGS__)
 #endif
+
+namespace zenkit {
+	/// \brief Escapes the given string for use in a JSON string literal.
+	inline std::string escape_json(std::string_view s) {
+		std::string out;
+		out.reserve(s.size());
+
+		for (auto c : s) {
+			auto u = static_cast<unsigned char>(c);
+			if (c == '"' || c == '\\') {
+				out.push_back('\\');
+				out.push_back(c);
+			} else if (u < 0x20 || u >= 0x80) {
+				// Symbol names are not UTF-8, so treat them as Latin-1.
+				char buf[8];
+				std::snprintf(buf, sizeof buf, "\\u%04x", u);
+				out.append(buf);
+			} else {
+				out.push_back(c);
+			}
+		}
+
+		return out;
+	}
+} // namespace zenkit
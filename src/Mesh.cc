@@ -5,12 +5,16 @@
 #include "zenkit/Stream.hh"
 
 #include <algorithm>
+#include <cstddef>
 #include <unordered_set>
 
 namespace zenkit {
 	[[maybe_unused]] static constexpr auto MESH_VERSION_G1 = 9;
 	static constexpr auto MESH_VERSION_G2 = 265;
 
+	// Vertex features are read directly from their serialized form.
+	static_assert(sizeof(VertexFeature) == 24 && offsetof(VertexFeature, normal) == 12);
+
 	enum class MeshChunkType : std::uint16_t {
 		MARKER = 0xB000,
 		BBOX = 0xB010,
@@ -30,6 +34,63 @@ namespace zenkit {
 		    sector_index == b.sector_index && is_lod == b.is_lod && normal_axis == b.normal_axis;
 	}
 
+	/// \brief Reads the polygons of \p mesh. Instantiated for Read and ReadSpan.
+	template <typename R>
+	static void read_polygons(R* c, Mesh& mesh, std::uint16_t version, bool force_wide_indices) {
+		auto poly_count = c->read_uint();
+		mesh.geometry.resize(poly_count);
+
+		// At least 3 indices per polygon (triangulated).
+		mesh.polygon_vertex_indices.reserve(poly_count * 3);
+		mesh.polygon_feature_indices.reserve(poly_count * 3);
+		uint32_t index_offset = 0;
+
+		for (std::uint32_t i = 0; i < poly_count; ++i) {
+			mesh.geometry[i].material = c->read_ushort();
+			mesh.geometry[i].lightmap = c->read_short();
+
+			mesh.geometry[i].plane_distance = c->read_float();
+			mesh.geometry[i].plane_normal = c->read_vec3();
+
+			PolygonFlagSet& pflags = mesh.geometry[i].flags;
+			if (version == MESH_VERSION_G2) {
+				std::uint8_t flags = c->read_ubyte();
+				pflags.is_portal = (flags & 0b00000011) >> 0;
+				pflags.is_occluder = (flags & 0b00000100) >> 2;
+				pflags.is_sector = (flags & 0b00001000) >> 3;
+				pflags.should_relight = (flags & 0b00010000) >> 4;
+				pflags.is_outdoor = (flags & 0b00100000) >> 5;
+				pflags.is_ghost_occluder = (flags & 0b01000000) >> 6;
+				pflags.is_dynamically_lit = (flags & 0b10000000) >> 7;
+				pflags.sector_index = c->read_short();
+			} else {
+				std::uint8_t flags1 = c->read_ubyte();
+				std::uint8_t flags2 = c->read_ubyte();
+
+				pflags.is_portal = (flags1 & 0b00000011) >> 0;
+				pflags.is_occluder = (flags1 & 0b00000100) >> 2;
+				pflags.is_sector = (flags1 & 0b00001000) >> 3;
+				pflags.is_lod = (flags1 & 0b00010000) >> 4;
+				pflags.is_outdoor = (flags1 & 0b00100000) >> 5;
+				pflags.is_ghost_occluder = (flags1 & 0b01000000) >> 6;
+				pflags.normal_axis = ((flags1 & 0b10000000) >> 7) | (flags2 & 0b00000001);
+				pflags.sector_index = c->read_short();
+			}
+
+			auto vertex_count = c->read_ubyte();
+			auto has_wide_indices = (version == MESH_VERSION_G2) || force_wide_indices;
+
+			for (int32_t j = 0; j < vertex_count; ++j) {
+				mesh.polygon_vertex_indices.push_back(has_wide_indices ? c->read_uint() : c->read_ushort());
+				mesh.polygon_feature_indices.push_back(c->read_uint());
+			}
+
+			mesh.geometry[i].index_count = vertex_count;
+			mesh.geometry[i].index_offset = index_offset;
+			index_offset += vertex_count;
+		}
+	}
+
 	void Mesh::load(Read* r, std::vector<std::uint32_t> const& leaf_polygons, bool force_wide_indices) {
 		this->load(r, force_wide_indices);
 		this->triangulate(leaf_polygons);
@@ -64,79 +125,17 @@ namespace zenkit {
 			    }
 			    case MeshChunkType::VERTICES:
 				    this->vertices.resize(c->read_uint());
-
-				    for (auto& vertex : this->vertices) {
-					    vertex = c->read_vec3();
-				    }
-
+				    c->read_array(std::span {this->vertices});
 				    break;
 			    case MeshChunkType::FEATURES:
 				    this->features.resize(c->read_uint());
-
-				    for (auto& feature : this->features) {
-					    feature.texture = c->read_vec2();
-					    feature.light = c->read_uint();
-					    feature.normal = c->read_vec3();
-				    }
-
+				    c->read_array(std::span {this->features});
 				    break;
-			    case MeshChunkType::POLYGONS: {
-				    auto poly_count = c->read_uint();
-				    this->geometry.resize(poly_count);
-
-				    // At least 3 indices per polygon (triangulated).
-				    this->polygon_vertex_indices.reserve(poly_count * 3);
-				    this->polygon_feature_indices.reserve(poly_count * 3);
-				    uint32_t index_offset = 0;
-
-				    for (std::uint32_t i = 0; i < poly_count; ++i) {
-					    this->geometry[i].material = c->read_ushort();
-					    this->geometry[i].lightmap = c->read_short();
-
-					    this->geometry[i].plane_distance = c->read_float();
-					    this->geometry[i].plane_normal = c->read_vec3();
-
-					    PolygonFlagSet& pflags = this->geometry[i].flags;
-					    if (version == MESH_VERSION_G2) {
-						    std::uint8_t flags = c->read_ubyte();
-						    pflags.is_portal = (flags & 0b00000011) >> 0;
-						    pflags.is_occluder = (flags & 0b00000100) >> 2;
-						    pflags.is_sector = (flags & 0b00001000) >> 3;
-						    pflags.should_relight = (flags & 0b00010000) >> 4;
-						    pflags.is_outdoor = (flags & 0b00100000) >> 5;
-						    pflags.is_ghost_occluder = (flags & 0b01000000) >> 6;
-						    pflags.is_dynamically_lit = (flags & 0b10000000) >> 7;
-						    pflags.sector_index = c->read_short();
-					    } else {
-						    std::uint8_t flags1 = c->read_ubyte();
-						    std::uint8_t flags2 = c->read_ubyte();
-
-						    pflags.is_portal = (flags1 & 0b00000011) >> 0;
-						    pflags.is_occluder = (flags1 & 0b00000100) >> 2;
-						    pflags.is_sector = (flags1 & 0b00001000) >> 3;
-						    pflags.is_lod = (flags1 & 0b00010000) >> 4;
-						    pflags.is_outdoor = (flags1 & 0b00100000) >> 5;
-						    pflags.is_ghost_occluder = (flags1 & 0b01000000) >> 6;
-						    pflags.normal_axis = ((flags1 & 0b10000000) >> 7) | (flags2 & 0b00000001);
-						    pflags.sector_index = c->read_short();
-					    }
-
-					    auto vertex_count = c->read_ubyte();
-					    auto has_wide_indices = (version == MESH_VERSION_G2) || force_wide_indices;
-
-					    for (int32_t j = 0; j < vertex_count; ++j) {
-						    this->polygon_vertex_indices.push_back(has_wide_indices ? c->read_uint()
-						                                                            : c->read_ushort());
-						    this->polygon_feature_indices.push_back(c->read_uint());
-					    }
-
-					    this->geometry[i].index_count = vertex_count;
-					    this->geometry[i].index_offset = index_offset;
-					    index_offset += vertex_count;
-				    }
-
+			    case MeshChunkType::POLYGONS:
+				    proto::read_contiguous(c, [this, version, force_wide_indices](auto* p) {
+					    read_polygons(p, *this, version, force_wide_indices);
+				    });
 				    break;
-			    }
 			    case MeshChunkType::LIGHTMAPS_SHARED: {
 				    auto texture_count = c->read_uint();
 
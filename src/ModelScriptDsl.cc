@@ -7,6 +7,8 @@
 #include "zenkit/Misc.hh"
 #include "zenkit/Stream.hh"
 
+#include <cstring>
+
 #define WARN_SYNTAX(msg) ZKLOGW("ModelScript", "Syntax error (line %d, column %d): %s", _m_line, _m_column, msg)
 
 namespace zenkit {
@@ -23,6 +25,19 @@ namespace zenkit {
 	ScriptSyntaxError::ScriptSyntaxError(std::string&& location, std::string&& msg)
 	    : ParserError("ModelScript (source)", "MDS syntax error at " + location + ": " + msg) {}
 
+	/// \brief Skips everything up to and including the next `\n`.
+	static void skip_line(Read* r) {
+		if (auto data = r->view(); !data.empty()) {
+			auto pos = r->tell();
+			auto const* nl = static_cast<std::byte const*>(std::memchr(data.data() + pos, '\n', data.size() - pos));
+			auto end = nl == nullptr ? data.size() : static_cast<std::size_t>(nl - data.data()) + 1;
+			r->seek(static_cast<ssize_t>(end), Whence::BEG);
+			return;
+		}
+
+		while (!r->eof() && r->read_char() != '\n') {}
+	}
+
 	constexpr std::string_view token_names[] =
 	    {"KEYWORD", "integer", "float", "string", "rparen", "lparen", "rbrace", "lbrace", "colon", "eof", "null"};
 
@@ -54,8 +69,7 @@ namespace zenkit {
 				}
 
 				// skip everything until the end of the line
-				while (_m_buffer->read_char() != '\n')
-					_m_column += 1;
+				skip_line(_m_buffer);
 
 				_m_line += 1;
 				_m_column = 1;
@@ -156,7 +170,7 @@ namespace zenkit {
 	}
 
 	void MdsTokenizer::next_line() {
-		while (_m_buffer->read_char() != '\n') {}
+		skip_line(_m_buffer);
 	}
 
 	void MdsTokenizer::backtrack() {
@@ -4,6 +4,8 @@
 #include "zenkit/Archive.hh"
 #include "zenkit/Stream.hh"
 
+#include <cstddef>
+
 namespace zenkit {
 	[[maybe_unused]] static constexpr auto VERSION_G1 = 0x305;
 	static constexpr auto VERSION_G2 = 0x905;
@@ -11,6 +13,11 @@ namespace zenkit {
 
 	enum class MrmChunkType : std::uint16_t { MESH = 0xB100, END = 0xB1FF };
 
+	// Sub-mesh data is read directly from its serialized form.
+	static_assert(sizeof(MeshTriangle) == 6 && sizeof(MeshTriangleEdge) == 6 && sizeof(MeshEdge) == 4);
+	static_assert(sizeof(MeshWedge) == 24 && offsetof(MeshWedge, index) == 20);
+	static_assert(sizeof(MeshPlane) == 16 && offsetof(MeshPlane, normal) == 4);
+
 	void MultiResolutionMesh::load(Read* r) {
 		proto::read_chunked<MrmChunkType>(r, "MultiResolutionMesh", [this](Read* c, MrmChunkType type) {
 			switch (type) {
@@ -79,16 +86,12 @@ namespace zenkit {
 		// read positions
 		this->positions.resize(vertices_size);
 		r->seek(static_cast<ssize_t>(vertices_offset), Whence::BEG);
-		for (auto& pos : this->positions) {
-			pos = r->read_vec3();
-		}
+		r->read_array(std::span {this->positions});
 
 		// read normals
 		this->normals.resize(normals_size);
 		r->seek(static_cast<ssize_t>(normals_offset), Whence::BEG);
-		for (auto& normal : this->normals) {
-			normal = r->read_vec3();
-		}
+		r->read_array(std::span {this->normals});
 
 		// read submeshes
 		this->sub_meshes.resize(submesh_count);
@@ -108,7 +111,7 @@ namespace zenkit {
 	void MultiResolutionMesh::save_to_section(Write* w, GameVersion version) const {
 		w->write_ushort(version == GameVersion::GOTHIC_1 ? VERSION_G1 : VERSION_G2);
 
-		auto off_size = static_cast<ssize_t>(w->tell());
+		auto off_size = w->tell();
 		w->write_uint(0);
 
 		auto off_content = w->tell();
@@ -127,10 +130,8 @@ namespace zenkit {
 			sections.push_back(mesh.save(w));
 		}
 
-		auto off_end = static_cast<ssize_t>(w->tell());
-		w->seek(off_size, Whence::BEG);
-		w->write_uint(off_end - off_size);
-		w->seek(off_end, Whence::BEG);
+		auto size = static_cast<uint32_t>(w->tell() - off_size);
+		w->patch(off_size, &size, sizeof size);
 
 		w->write_ubyte(this->sub_meshes.size());    // submeshCount
 		w->write_uint(off_positions - off_content); // positionOffset
@@ -192,76 +193,49 @@ namespace zenkit {
 		// triangles
 		r->seek(static_cast<ssize_t>(map.triangles.offset), Whence::BEG);
 		this->triangles.resize(map.triangles.size);
-		for (auto i = 0u; i < map.triangles.size; ++i) {
-			this->triangles[i] = {{r->read_ushort(), r->read_ushort(), r->read_ushort()}};
-		}
+		r->read_array(std::span {this->triangles});
 
 		// wedges
 		r->seek(static_cast<ssize_t>(map.wedges.offset), Whence::BEG);
 		this->wedges.resize(map.wedges.size);
 
-		for (auto i = 0u; i < map.wedges.size; ++i) {
-			this->wedges[i] = {r->read_vec3(), r->read_vec2(), r->read_ushort()};
-
-			// and this is why you don't just dump raw binary data
-			(void) r->read_ushort();
-		}
+		// The two bytes of padding at the end of each wedge are read as well.
+		r->read_array(std::span {this->wedges});
 
 		// colors
 		r->seek(static_cast<ssize_t>(map.colors.offset), Whence::BEG);
 		this->colors.resize(map.colors.size);
-
-		for (auto i = 0u; i < map.colors.size; ++i) {
-			this->colors[i] = r->read_float();
-		}
+		r->read_array(std::span {this->colors});
 
 		// triangle_plane_indices
 		r->seek(static_cast<ssize_t>(map.triangle_plane_indices.offset), Whence::BEG);
 		this->triangle_plane_indices.resize(map.triangle_plane_indices.size);
-
-		for (auto i = 0u; i < map.triangle_plane_indices.size; ++i) {
-			this->triangle_plane_indices[i] = r->read_ushort();
-		}
+		r->read_array(std::span {this->triangle_plane_indices});
 
 		// triangle_planes
 		r->seek(static_cast<ssize_t>(map.triangle_planes.offset), Whence::BEG);
 		this->triangle_planes.resize(map.triangle_planes.size);
-
-		for (auto i = 0u; i < map.triangle_planes.size; ++i) {
-			this->triangle_planes[i] = {r->read_float(), r->read_vec3()};
-		}
+		r->read_array(std::span {this->triangle_planes});
 
 		// triangle_edges
 		r->seek(static_cast<ssize_t>(map.triangle_edges.offset), Whence::BEG);
 		this->triangle_edges.resize(map.triangle_edges.size);
-
-		for (auto i = 0u; i < map.triangle_edges.size; ++i) {
-			this->triangle_edges[i] = {{r->read_ushort(), r->read_ushort(), r->read_ushort()}};
-		}
+		r->read_array(std::span {this->triangle_edges});
 
 		// edges
 		r->seek(static_cast<ssize_t>(map.edges.offset), Whence::BEG);
 		this->edges.resize(map.edges.size);
-
-		for (auto i = 0u; i < map.edges.size; ++i) {
-			this->edges[i] = {{r->read_ushort(), r->read_ushort()}};
-		}
+		r->read_array(std::span {this->edges});
 
 		// edge_scores
 		r->seek(static_cast<ssize_t>(map.edge_scores.offset), Whence::BEG);
 		this->edge_scores.resize(map.edge_scores.size);
-
-		for (auto i = 0u; i < map.edge_scores.size; ++i) {
-			this->edge_scores[i] = r->read_float();
-		}
+		r->read_array(std::span {this->edge_scores});
 
 		// wedge_map
 		r->seek(static_cast<ssize_t>(map.wedge_map.offset), Whence::BEG);
 		this->wedge_map.resize(map.wedge_map.size);
-
-		for (auto i = 0u; i < map.wedge_map.size; ++i) {
-			this->wedge_map[i] = r->read_ushort();
-		}
+		r->read_array(std::span {this->wedge_map});
 	}
 
 	SubMeshSection SubMesh::save(Write* w) const {
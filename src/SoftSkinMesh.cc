@@ -5,10 +5,19 @@
 
 #include "Internal.hh"
 
+#include <algorithm>
+#include <cstddef>
+
 namespace zenkit {
 	constexpr uint32_t VERSION_G1 = 0x00000004;
 	constexpr uint32_t VERSION_G2 = 0x00000004;
 
+	/// \brief The serialized size of a SoftSkinWeightEntry.
+	static constexpr std::size_t WEIGHT_ENTRY_SIZE = sizeof(float) + sizeof(Vec3) + sizeof(std::uint8_t);
+
+	// Wedge normals are read directly from their serialized form.
+	static_assert(sizeof(SoftSkinWedgeNormal) == 16 && offsetof(SoftSkinWedgeNormal, index) == 12);
+
 	enum class SoftSkinMeshChunkType : std::uint16_t {
 		HEADER = 0xE100,
 		END = 0xE110,
@@ -17,66 +26,72 @@ namespace zenkit {
 	};
 
 	void SoftSkinMesh::load(Read* r) {
-		proto::read_chunked<SoftSkinMeshChunkType>(r, "SoftSkinMesh", [this](Read* c, SoftSkinMeshChunkType type) {
-			switch (type) {
-			case SoftSkinMeshChunkType::HEADER:
-				(void) /* version = */ c->read_uint();
-				break;
-			case SoftSkinMeshChunkType::PROTO:
-				mesh.load_from_section(c);
-				break;
-			case SoftSkinMeshChunkType::NODES: {
-				// weights
-				auto weight_buffer_size = c->read_uint();
-				auto weight_buffer_end = c->tell() + weight_buffer_size;
-
-				this->weights.resize(this->mesh.positions.size());
-				for (uint32_t i = 0; i < this->mesh.positions.size(); ++i) {
-					auto count = c->read_uint();
-					this->weights[i].resize(count);
-
-					for (std::uint32_t j = 0; j < count; ++j) {
-						auto& weight = this->weights[i][j];
-						weight.weight = c->read_float();
-						weight.position = c->read_vec3();
-						weight.node_index = c->read_ubyte();
-					}
-				}
-
-				if (c->tell() != weight_buffer_end) {
-					ZKLOGW("SoftSkinMesh", "%zu bytes remaining in weight section", weight_buffer_end - c->tell());
-					c->seek(static_cast<ssize_t>(weight_buffer_end), Whence::BEG);
-				}
-
-				// wedge normals
-				this->wedge_normals.resize(c->read_uint());
-				for (auto& normal : this->wedge_normals) {
-					normal.normal = c->read_vec3();
-					normal.index = c->read_uint();
-				}
-
-				// nodes
-				this->nodes.resize(c->read_ushort());
-				for (auto& node : this->nodes) {
-					node = c->read_int();
-				}
-
-				// bounding boxes
-				this->bboxes.resize(this->nodes.size());
-				for (auto& bbox : this->bboxes) {
-					bbox.load(c);
-				}
-
-				break;
-			}
-			case SoftSkinMeshChunkType::END:
-				return true;
-			default:
-				break;
-			}
-
-			return false;
-		});
+		proto::read_chunked<SoftSkinMeshChunkType>(
+		    r,
+		    "SoftSkinMesh",
+		    [this](Read* c, SoftSkinMeshChunkType type, std::size_t& end) {
+			    switch (type) {
+			    case SoftSkinMeshChunkType::HEADER:
+				    (void) /* version = */ c->read_uint();
+				    break;
+			    case SoftSkinMeshChunkType::PROTO:
+				    mesh.load_from_section(c);
+				    break;
+			    case SoftSkinMeshChunkType::NODES: {
+				    // weights
+				    // The weights are packed without padding, so they are read at once and decoded from memory.
+				    // The size is limited to the rest of the chunk, so that corrupt files can not request huge buffers.
+				    auto size = std::min<std::size_t>(c->read_uint(), end - std::min(end, c->tell()));
+				    std::vector<std::byte> weight_buffer(size);
+				    weight_buffer.resize(c->read(weight_buffer.data(), weight_buffer.size()));
+
+				    ReadSpan wr {weight_buffer};
+
+				    this->weights.resize(this->mesh.positions.size());
+				    for (uint32_t i = 0; i < this->mesh.positions.size(); ++i) {
+					    auto count = wr.read_uint();
+					    auto remaining = (weight_buffer.size() - wr.tell()) / WEIGHT_ENTRY_SIZE;
+					    this->weights[i].resize(std::min(static_cast<std::size_t>(count), remaining));
+
+					    for (auto& weight : this->weights[i]) {
+						    weight.weight = wr.read_float();
+						    weight.position = wr.read_vec3();
+						    weight.node_index = wr.read_ubyte();
+					    }
+				    }
+
+				    if (!wr.eof()) {
+					    ZKLOGW("SoftSkinMesh",
+					           "%zu bytes remaining in weight section",
+					           weight_buffer.size() - wr.tell());
+				    }
+
+				    // wedge normals
+				    this->wedge_normals.resize(c->read_uint());
+				    c->read_array(std::span {this->wedge_normals});
+
+				    // nodes
+				    this->nodes.resize(c->read_ushort());
+				    for (auto& node : this->nodes) {
+					    node = c->read_int();
+				    }
+
+				    // bounding boxes
+				    this->bboxes.resize(this->nodes.size());
+				    for (auto& bbox : this->bboxes) {
+					    bbox.load(c);
+				    }
+
+				    break;
+			    }
+			    case SoftSkinMeshChunkType::END:
+				    return true;
+			    default:
+				    break;
+			    }
+
+			    return false;
+		    });
 	}
 
 	void SoftSkinMesh::save(Write* w, GameVersion version) const {
@@ -82,6 +82,10 @@ namespace zenkit {
 		return v.transpose();
 	}
 
+	std::span<std::byte const> Read::view() const noexcept {
+		return {};
+	}
+
 	std::string Read::read_string(size_t len) noexcept {
 		std::string str(len, '\0');
 		this->read(str.data(), len);
@@ -92,7 +96,31 @@ namespace zenkit {
 		return read_line_then_ignore(skipws ? " \t\r\n\v\f" : "");
 	}
 
+	std::string_view Read::read_line_view(bool skipws, std::string& buffer) noexcept {
+		auto data = this->view();
+		if (data.empty()) {
+			buffer = this->read_line(skipws);
+			return buffer;
+		}
+
+		ReadSpan span {data};
+		span.seek(static_cast<ssize_t>(this->tell()), Whence::BEG);
+
+		auto line = span.read_line_view(skipws);
+		this->seek(static_cast<ssize_t>(span.tell()), Whence::BEG);
+		return line;
+	}
+
 	std::string Read::read_line_then_ignore(std::string_view chars) noexcept {
+		if (auto data = this->view(); !data.empty()) {
+			ReadSpan span {data};
+			span.seek(static_cast<ssize_t>(this->tell()), Whence::BEG);
+
+			auto line = span.read_line_then_ignore(chars);
+			this->seek(static_cast<ssize_t>(span.tell()), Whence::BEG);
+			return line;
+		}
+
 		std::string str {};
 
 		char c;
@@ -179,6 +207,15 @@ namespace zenkit {
 		this->write(vT.pointer(), 16 * sizeof(float));
 	}
 
+	void Write::patch(size_t offset, void const* buf, size_t len) noexcept {
+		auto cur = this->tell();
+		this->seek(static_cast<ssize_t>(offset), Whence::BEG);
+		this->write(buf, len);
+		this->seek(static_cast<ssize_t>(cur), Whence::BEG);
+	}
+
+	void Write::flush() noexcept {}
+
 	namespace detail {
 		constexpr int INTO_C_WHENCE[] = {
 		    SEEK_SET,
@@ -244,6 +281,8 @@ namespace zenkit {
 			}
 
 			void seek(ssize_t off, Whence whence) noexcept override {
+				// Like fseek, seeking clears the end-of-file state.
+				_m_stream->clear(_m_stream->rdstate() & ~(std::ios::eofbit | std::ios::failbit));
 				_m_stream->seekg(off, INTO_CXX_WHENCE[static_cast<int>(whence)]);
 			}
 
@@ -259,6 +298,97 @@ namespace zenkit {
 			std::istream* _m_stream;
 		};
 
+		class ReadBuffered final ZKINT : public Read {
+		public:
+			ReadBuffered(std::unique_ptr<Read> stream, size_t size)
+			    : _m_stream(std::move(stream)), _m_buffer(size), _m_begin(_m_stream->tell()) {}
+
+			~ReadBuffered() noexcept override {
+				// Leave the underlying stream where the user of this stream expects it.
+				if (_m_position != _m_length) {
+					_m_stream->seek(static_cast<ssize_t>(this->tell()), Whence::BEG);
+				}
+			}
+
+			size_t read(void* buf, size_t len) noexcept override {
+				// Fast path: the data is already buffered.
+				if (len <= _m_length - _m_position) {
+					memcpy(buf, _m_buffer.data() + _m_position, len);
+					_m_position += len;
+					return len;
+				}
+
+				auto* out = static_cast<std::byte*>(buf);
+				auto available = _m_length - _m_position;
+				memcpy(out, _m_buffer.data() + _m_position, available);
+				_m_position += available;
+
+				auto count = available;
+				auto remaining = len - available;
+
+				// Large reads bypass the buffer.
+				if (remaining >= _m_buffer.size()) {
+					auto direct = _m_stream->read(out + count, remaining);
+					_m_begin += _m_length + direct;
+					_m_position = _m_length = 0;
+					return count + direct;
+				}
+
+				this->fill();
+
+				auto buffered = std::min(remaining, _m_length);
+				memcpy(out + count, _m_buffer.data(), buffered);
+				_m_position = buffered;
+				return count + buffered;
+			}
+
+			void seek(ssize_t off, Whence whence) noexcept override {
+				if (whence == Whence::END) {
+					_m_stream->seek(off, whence);
+					this->reset(_m_stream->tell());
+					return;
+				}
+
+				auto target = whence == Whence::BEG ? static_cast<size_t>(off) : this->tell() + off;
+
+				// Seeks within the current block only move the cursor.
+				if (target >= _m_begin && target <= _m_begin + _m_length) {
+					_m_position = target - _m_begin;
+					return;
+				}
+
+				_m_stream->seek(static_cast<ssize_t>(target), Whence::BEG);
+				this->reset(_m_stream->tell());
+			}
+
+			[[nodiscard]] size_t tell() const noexcept override {
+				return _m_begin + _m_position;
+			}
+
+			[[nodiscard]] bool eof() const noexcept override {
+				return _m_position == _m_length && _m_stream->eof();
+			}
+
+		private:
+			/// \brief Replaces the buffer with the next block of the underlying stream.
+			void fill() noexcept {
+				_m_begin += _m_length;
+				_m_length = _m_stream->read(_m_buffer.data(), _m_buffer.size());
+				_m_position = 0;
+			}
+
+			/// \brief Discards the buffer after the underlying stream was moved to \p position.
+			void reset(size_t position) noexcept {
+				_m_begin = position;
+				_m_position = _m_length = 0;
+			}
+
+			std::unique_ptr<Read> _m_stream;
+			std::vector<std::byte> _m_buffer;
+			size_t _m_begin;
+			size_t _m_length {0}, _m_position {0};
+		};
+
 		class ReadMemory ZKINT : public Read {
 		public:
 			ReadMemory(std::byte const* byte, size_t len) : _m_bytes(byte), _m_length(len) {}
@@ -286,6 +416,10 @@ namespace zenkit {
 				return _m_position >= _m_length;
 			}
 
+			[[nodiscard]] std::span<std::byte const> view() const noexcept override {
+				return {_m_bytes, _m_length};
+			}
+
 		private:
 			std::byte const* _m_bytes;
 			size_t _m_length, _m_position {0};
@@ -328,6 +462,10 @@ namespace zenkit {
 				return static_cast<size_t>(ftell(_m_stream));
 			}
 
+			void flush() noexcept override {
+				fflush(_m_stream);
+			}
+
 		private:
 			FILE* _m_stream;
 		};
@@ -361,11 +499,141 @@ namespace zenkit {
 				return _m_stream->tellp();
 			}
 
+			void flush() noexcept override {
+				_m_stream->flush();
+			}
+
 		private:
 			std::ostream* _m_stream;
 			bool _m_own;
 		};
 
+		class WriteBuffered final ZKINT : public Write {
+		public:
+			WriteBuffered(std::unique_ptr<Write> stream, size_t size)
+			    : _m_stream(std::move(stream)), _m_buffer(size), _m_begin(_m_stream->tell()) {}
+
+			~WriteBuffered() noexcept override {
+				this->flush();
+			}
+
+			size_t write(void const* buf, size_t len) noexcept override {
+				// Fast path: the data fits into the buffer.
+				if (len <= _m_buffer.size() - _m_position) {
+					memcpy(_m_buffer.data() + _m_position, buf, len);
+					_m_position += len;
+					_m_length = std::max(_m_length, _m_position);
+					return len;
+				}
+
+				this->drain();
+
+				// Large writes bypass the buffer.
+				if (len >= _m_buffer.size()) {
+					auto written = _m_stream->write(buf, len);
+					_m_begin += written;
+					return written;
+				}
+
+				memcpy(_m_buffer.data(), buf, len);
+				_m_position = _m_length = len;
+				return len;
+			}
+
+			void seek(ssize_t off, Whence whence) noexcept override {
+				if (whence == Whence::END) {
+					this->drain();
+					this->apply_patches();
+					_m_stream->seek(off, whence);
+					_m_begin = _m_stream->tell();
+					return;
+				}
+
+				auto target = whence == Whence::BEG ? static_cast<size_t>(off) : this->tell() + off;
+
+				// Seeks within the current block only move the cursor.
+				if (target >= _m_begin && target <= _m_begin + _m_length) {
+					_m_position = target - _m_begin;
+					return;
+				}
+
+				this->drain();
+
+				// Deferred patches must be applied before data written earlier is overwritten.
+				if (target < _m_begin) this->apply_patches();
+
+				_m_stream->seek(static_cast<ssize_t>(target), Whence::BEG);
+				_m_begin = _m_stream->tell();
+			}
+
+			[[nodiscard]] size_t tell() const noexcept override {
+				return _m_begin + _m_position;
+			}
+
+			void patch(size_t offset, void const* buf, size_t len) noexcept override {
+				if (offset >= _m_begin && offset + len <= _m_begin + _m_length) {
+					memcpy(_m_buffer.data() + (offset - _m_begin), buf, len);
+				} else if (offset + len <= _m_begin) {
+					auto const* bytes = static_cast<std::byte const*>(buf);
+					_m_patches.push_back({offset, _m_patch_data.size(), len});
+					_m_patch_data.insert(_m_patch_data.end(), bytes, bytes + len);
+				} else {
+					this->drain();
+					this->apply_patches();
+					_m_stream->patch(offset, buf, len);
+				}
+			}
+
+			void flush() noexcept override {
+				this->drain();
+				this->apply_patches();
+				_m_stream->flush();
+			}
+
+		private:
+			/// \brief Writes the buffer to the underlying stream and moves it to the current position.
+			void drain() noexcept {
+				if (_m_length != 0) {
+					_m_stream->write(_m_buffer.data(), _m_length);
+
+					if (_m_position != _m_length) {
+						_m_stream->seek(static_cast<ssize_t>(_m_begin + _m_position), Whence::BEG);
+					}
+				}
+
+				_m_begin += _m_position;
+				_m_position = _m_length = 0;
+			}
+
+			/// \brief Writes all deferred patches. The buffer must be empty.
+			void apply_patches() noexcept {
+				if (_m_patches.empty()) return;
+
+				for (auto& patch : _m_patches) {
+					_m_stream->seek(static_cast<ssize_t>(patch.offset), Whence::BEG);
+					_m_stream->write(_m_patch_data.data() + patch.data, patch.length);
+				}
+
+				_m_stream->seek(static_cast<ssize_t>(_m_begin), Whence::BEG);
+				_m_patches.clear();
+				_m_patch_data.clear();
+			}
+
+			struct Patch {
+				size_t offset;
+				size_t data;
+				size_t length;
+			};
+
+			std::unique_ptr<Write> _m_stream;
+			std::vector<std::byte> _m_buffer;
+			size_t _m_begin;
+			size_t _m_length {0}, _m_position {0};
+
+			std::vector<Patch> _m_patches;
+			std::vector<std::byte> _m_patch_data;
+		};
+
 		class WriteStatic final ZKINT : public Write {
 		public:
 			explicit WriteStatic(std::byte* buf, size_t len) : _m_bytes(buf), _m_length(len) {}
@@ -428,12 +696,20 @@ namespace zenkit {
 		};
 	} // namespace detail
 
-	std::unique_ptr<Read> Read::from(FILE* stream) {
-		return std::make_unique<detail::ReadFile>(stream);
+	std::unique_ptr<Read> Read::from(FILE* stream, size_t buffer_size) {
+		std::unique_ptr<Read> r = std::make_unique<detail::ReadFile>(stream);
+		if (buffer_size == 0) return r;
+		return Read::buffered(std::move(r), buffer_size);
+	}
+
+	std::unique_ptr<Read> Read::from(std::istream* stream, size_t buffer_size) {
+		std::unique_ptr<Read> r = std::make_unique<detail::ReadStream>(stream);
+		if (buffer_size == 0) return r;
+		return Read::buffered(std::move(r), buffer_size);
 	}
 
-	std::unique_ptr<Read> Read::from(std::istream* stream) {
-		return std::make_unique<detail::ReadStream>(stream);
+	std::unique_ptr<Read> Read::buffered(std::unique_ptr<Read> stream, size_t buffer_size) {
+		return std::make_unique<detail::ReadBuffered>(std::move(stream), std::max(buffer_size, size_t {1}));
 	}
 
 	std::unique_ptr<Read> Read::from(std::byte const* bytes, size_t len) {
@@ -462,16 +738,22 @@ namespace zenkit {
 #endif
 	}
 
-	std::unique_ptr<Write> Write::to(std::filesystem::path const& path) {
-		return std::make_unique<detail::WriteStream>(path);
+	std::unique_ptr<Write> Write::to(std::filesystem::path const& path, size_t buffer_size) {
+		std::unique_ptr<Write> w = std::make_unique<detail::WriteStream>(path);
+		if (buffer_size == 0) return w;
+		return Write::buffered(std::move(w), buffer_size);
 	}
 
-	std::unique_ptr<Write> Write::to(FILE* stream) {
-		return std::make_unique<detail::WriteFile>(stream);
+	std::unique_ptr<Write> Write::to(FILE* stream, size_t buffer_size) {
+		std::unique_ptr<Write> w = std::make_unique<detail::WriteFile>(stream);
+		if (buffer_size == 0) return w;
+		return Write::buffered(std::move(w), buffer_size);
 	}
 
-	std::unique_ptr<Write> Write::to(std::ostream* stream) {
-		return std::make_unique<detail::WriteStream>(stream);
+	std::unique_ptr<Write> Write::to(std::ostream* stream, size_t buffer_size) {
+		std::unique_ptr<Write> w = std::make_unique<detail::WriteStream>(stream);
+		if (buffer_size == 0) return w;
+		return Write::buffered(std::move(w), buffer_size);
 	}
 
 	std::unique_ptr<Write> Write::to(std::byte* bytes, size_t len) {
@@ -481,6 +763,10 @@ namespace zenkit {
 	std::unique_ptr<Write> Write::to(std::vector<std::byte>* vector) {
 		return std::make_unique<detail::WriteDynamic>(vector);
 	}
+
+	std::unique_ptr<Write> Write::buffered(std::unique_ptr<Write> stream, size_t buffer_size) {
+		return std::make_unique<detail::WriteBuffered>(std::move(stream), std::max(buffer_size, size_t {1}));
+	}
 	// -----------------------------------------------------------------------------------------------------------------
 
 #ifdef _ZK_WITH_ZIPPED_VDF
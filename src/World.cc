@@ -187,9 +187,7 @@ namespace zenkit {
 			this->world_bsp_tree.save(raw, version);
 
 			auto size = static_cast<uint32_t>(raw->tell() - size_off - sizeof(uint32_t));
-			raw->seek(size_off, Whence::BEG);
-			raw->write_uint(size);
-			raw->seek(size, Whence::CUR);
+			raw->patch(size_off, &size, sizeof size);
 
 			w.write_object_end();
 		}
@@ -28,7 +28,7 @@ namespace zenkit {
 			}
 		}
 
-		if (read->read_line(true) != "END") {
+		if (read->read_line_view(true, _m_line) != "END") {
 			throw ParserError {"ReadArchive.Ascii", "second END missing"};
 		}
 	}
@@ -37,10 +37,10 @@ namespace zenkit {
 		if (read->eof()) return false;
 
 		auto mark = read->tell();
-		auto line = read->read_line(true);
+		auto view = read->read_line_view(true, _m_line);
 
 		// Fail quickly if we know this can't be an object begin
-		if (line.length() <= 2) {
+		if (view.length() <= 2 || view.front() != '[') {
 			read->seek(static_cast<ssize_t>(mark), Whence::BEG);
 			return false;
 		}
@@ -48,6 +48,7 @@ namespace zenkit {
 		char class_name[128];
 		char object_name[128];
 
+		std::string line {view};
 		auto parsed_elements =
 		    std::sscanf(line.c_str(), "[%127s %127s %hu %u]", object_name, class_name, &obj.version, &obj.index);
 
@@ -66,10 +67,9 @@ namespace zenkit {
 		if (read->eof()) return false;
 
 		auto mark = read->tell();
-		auto line = read->read_line(true);
 
 		// Compatibility fix for binary data in ASCII archives.
-		std::string_view view = line;
+		auto view = read->read_line_view(true, _m_line);
 		size_t spaces_count = 0;
 		for (; spaces_count < view.size() && std::isspace(static_cast<unsigned char>(view[spaces_count]));
 		     ++spaces_count)
@@ -88,16 +88,17 @@ namespace zenkit {
 	}
 
 	std::string ReadArchiveAscii::read_entry(std::string_view type) {
-		auto line = read->read_line(true);
+		auto line = read->read_line_view(true, _m_line);
 		line = line.substr(line.find('=') + 1);
 		auto colon = line.find(':');
 
 		if (line.substr(0, colon) != type) {
 			throw ParserError {"ReadArchive.Ascii",
-			                   "type mismatch: expected " + std::string {type} + ", got: " + line.substr(0, colon)};
+			                   "type mismatch: expected " + std::string {type} +
+			                       ", got: " + std::string {line.substr(0, colon)}};
 		}
 
-		return line.substr(colon + 1);
+		return std::string {line.substr(colon + 1)};
 	}
 
 	std::string ReadArchiveAscii::read_string() {
@@ -180,7 +181,7 @@ namespace zenkit {
 	}
 
 	void ReadArchiveAscii::skip_entry() {
-		(void) read->read_line(true);
+		(void) read->read_line_view(true, _m_line);
 	}
 
 	AxisAlignedBoundingBox ReadArchiveAscii::read_bbox() {
@@ -37,6 +37,9 @@ namespace zenkit {
 
 	private:
 		int32_t _m_objects {0};
+
+		/// \brief Storage for lines read from streams which are not contiguous. See Read::read_line_view.
+		std::string _m_line;
 	};
 
 	class WriteArchiveAscii final : public WriteArchive {
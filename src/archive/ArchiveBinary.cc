@@ -149,9 +149,8 @@ namespace zenkit {
 		auto prev = this->_m_objects.top();
 		this->_m_objects.pop();
 
-		this->_m_write->seek(static_cast<ssize_t>(prev), Whence::BEG);
-		this->_m_write->write_uint(static_cast<uint32_t>(cur - prev));
-		this->_m_write->seek(static_cast<ssize_t>(cur), Whence::BEG);
+		auto size = static_cast<uint32_t>(cur - prev);
+		this->_m_write->patch(prev, &size, sizeof size);
 	}
 
 	void WriteArchiveBinary::write_ref(std::string_view object_name, uint32_t index) {
@@ -163,10 +162,8 @@ namespace zenkit {
 		this->_m_write->write_string0(object_name);
 		this->_m_write->write_string0("\xA7");
 
-		auto cur = this->_m_write->tell();
-		this->_m_write->seek(static_cast<ssize_t>(start), Whence::BEG);
-		this->_m_write->write_uint(static_cast<uint32_t>(cur - start));
-		this->_m_write->seek(static_cast<ssize_t>(cur), Whence::BEG);
+		auto size = static_cast<uint32_t>(this->_m_write->tell() - start);
+		this->_m_write->patch(start, &size, sizeof size);
 	}
 
 	void WriteArchiveBinary::write_string(std::string_view, std::string_view v) {
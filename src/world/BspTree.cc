@@ -20,7 +20,8 @@ namespace zenkit {
 		END = 0xC0FF
 	};
 
-	static void _parse_bsp_nodes(Read* in,
+	template <typename R>
+	static void _parse_bsp_nodes(R* in,
 	                             std::vector<BspNode>& nodes,
 	                             std::vector<std::uint64_t>& indices,
 	                             std::uint32_t version,
@@ -30,7 +31,8 @@ namespace zenkit {
 
 		auto& node = nodes.emplace_back();
 		node.parent_index = parent_index;
-		node.bbox.load(in);
+		node.bbox.min = in->read_vec3();
+		node.bbox.max = in->read_vec3();
 		node.polygon_index = in->read_uint();
 		node.polygon_count = in->read_uint();
 
@@ -83,10 +85,7 @@ namespace zenkit {
 				break;
 			case BspChunkType::POLYGONS:
 				this->polygon_indices.resize(c->read_uint());
-
-				for (uint32_t& index : this->polygon_indices) {
-					index = c->read_uint();
-				}
+				c->read_array(std::span {this->polygon_indices});
 				break;
 			case BspChunkType::TREE: {
 				uint32_t node_count = c->read_uint();
@@ -95,7 +94,9 @@ namespace zenkit {
 				this->nodes.reserve(node_count);
 				this->leaf_node_indices.reserve(leaf_count);
 
-				_parse_bsp_nodes(c, this->nodes, this->leaf_node_indices, version, -1, node_count == 1);
+				proto::read_contiguous(c, [this, version, node_count](auto* p) {
+					_parse_bsp_nodes(p, this->nodes, this->leaf_node_indices, version, -1, node_count == 1);
+				});
 
 				for (auto idx : this->leaf_node_indices) {
 					auto& node = this->nodes[idx];
@@ -109,9 +110,7 @@ namespace zenkit {
 			}
 			case BspChunkType::LIGHT: {
 				this->light_points.resize(this->leaf_node_indices.size());
-				for (auto& light_point : this->light_points) {
-					light_point = c->read_vec3();
-				}
+				c->read_array(std::span {this->light_points});
 				break;
 			}
 			case BspChunkType::OUTDOORS: {
@@ -129,21 +128,13 @@ namespace zenkit {
 					sector.node_indices.resize(node_count);
 					sector.portal_polygon_indices.resize(polygon_count);
 
-					for (std::uint32_t j = 0; j < node_count; ++j) {
-						sector.node_indices[j] = c->read_uint();
-					}
-
-					for (std::uint32_t j = 0; j < polygon_count; ++j) {
-						sector.portal_polygon_indices[j] = c->read_uint();
-					}
+					c->read_array(std::span {sector.node_indices});
+					c->read_array(std::span {sector.portal_polygon_indices});
 				}
 
 				auto portal_count = c->read_uint();
 				this->portal_polygon_indices.resize(portal_count);
-
-				for (std::uint32_t i = 0; i < portal_count; ++i) {
-					this->portal_polygon_indices[i] = c->read_uint();
-				}
+				c->read_array(std::span {this->portal_polygon_indices});
 				break;
 			}
 			case BspChunkType::END:
@@ -0,0 +1,262 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <zenkit/DaedalusScript.hh>
+#include <zenkit/Stream.hh>
+
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace zenkit::test {
+	/// \brief A tiny assembler for building compiled Daedalus scripts in memory.
+	class ScriptBuilder {
+	public:
+		struct Symbol {
+			std::string name;
+			DaedalusDataType type;
+			std::uint32_t flags;
+			std::uint32_t count;
+			std::uint32_t vary;
+			std::int32_t address;
+			std::vector<std::int32_t> values;
+			std::int32_t parent;
+			std::string string {};
+		};
+
+		std::uint32_t variable(std::string name, std::int32_t value = 0, std::uint32_t flags = 0) {
+			symbols.push_back(Symbol {std::move(name), DaedalusDataType::INT, flags, 1, 0, 0, {value}, -1});
+			return static_cast<std::uint32_t>(symbols.size() - 1);
+		}
+
+		std::uint32_t function(std::string name, std::uint32_t params, bool returns_int = false) {
+			auto flags = DaedalusSymbolFlag::CONST | (returns_int ? DaedalusSymbolFlag::RETURN : 0);
+			auto rtype = returns_int ? DaedalusDataType::INT : DaedalusDataType::VOID;
+			symbols.push_back(Symbol {std::move(name),
+			                          DaedalusDataType::FUNCTION,
+			                          flags,
+			                          params,
+			                          static_cast<std::uint32_t>(rtype),
+			                          static_cast<std::int32_t>(here()),
+			                          {},
+			                          -1});
+			return static_cast<std::uint32_t>(symbols.size() - 1);
+		}
+
+		std::uint32_t external(std::string name, std::uint32_t params, bool returns_int = false) {
+			auto index = function(std::move(name), params, returns_int);
+			symbols[index].flags |= DaedalusSymbolFlag::EXTERNAL;
+			symbols[index].address = 0;
+			return index;
+		}
+
+		/// \brief Changes the return type of the function or external \p index.
+		void returns(std::uint32_t index, DaedalusDataType type) {
+			symbols[index].flags |= DaedalusSymbolFlag::RETURN;
+			symbols[index].vary = static_cast<std::uint32_t>(type);
+		}
+
+		std::uint32_t string(std::string name, std::string value = {}) {
+			auto index = variable(std::move(name));
+			symbols[index].type = DaedalusDataType::STRING;
+			symbols[index].string = std::move(value);
+			return index;
+		}
+
+		std::uint32_t real(std::string name, float value = 0) {
+			auto index = variable(std::move(name), std::bit_cast<std::int32_t>(value));
+			symbols[index].type = DaedalusDataType::FLOAT;
+			return index;
+		}
+
+		std::uint32_t cls(std::string name, std::uint32_t members) {
+			symbols.push_back(Symbol {std::move(name), DaedalusDataType::CLASS, 0, members, 0, 0, {}, -1});
+			return static_cast<std::uint32_t>(symbols.size() - 1);
+		}
+
+		std::uint32_t member(std::string name, std::uint32_t cls) {
+			auto flags = DaedalusSymbolFlag::MEMBER;
+			symbols.push_back(
+			    Symbol {std::move(name), DaedalusDataType::INT, flags, 1, 0, 0, {}, static_cast<std::int32_t>(cls)});
+			return static_cast<std::uint32_t>(symbols.size() - 1);
+		}
+
+		std::uint32_t instance(std::string name, std::uint32_t parent, bool prototype = false) {
+			auto type = prototype ? DaedalusDataType::PROTOTYPE : DaedalusDataType::INSTANCE;
+			symbols.push_back(Symbol {std::move(name),
+			                          type,
+			                          DaedalusSymbolFlag::CONST,
+			                          0,
+			                          0,
+			                          static_cast<std::int32_t>(here()),
+			                          {},
+			                          static_cast<std::int32_t>(parent)});
+			return static_cast<std::uint32_t>(symbols.size() - 1);
+		}
+
+		[[nodiscard]] std::uint32_t here() const {
+			return static_cast<std::uint32_t>(code.size());
+		}
+
+		ScriptBuilder& op(DaedalusOpcode op) {
+			code.push_back(static_cast<std::byte>(op));
+			return *this;
+		}
+
+		ScriptBuilder& op(DaedalusOpcode op, std::uint32_t arg) {
+			this->op(op);
+			for (auto i = 0u; i < 4; ++i) {
+				code.push_back(static_cast<std::byte>((arg >> (i * 8)) & 0xFF));
+			}
+			return *this;
+		}
+
+		ScriptBuilder& pushvv(std::uint32_t symbol, std::uint8_t index) {
+			this->op(DaedalusOpcode::PUSHVV, symbol);
+			code.push_back(static_cast<std::byte>(index));
+			return *this;
+		}
+
+		/// \brief Overwrites the 4-byte operand of the instruction at \p at.
+		void patch(std::uint32_t at, std::uint32_t arg) {
+			for (auto i = 0u; i < 4; ++i) {
+				code[at + 1 + i] = static_cast<std::byte>((arg >> (i * 8)) & 0xFF);
+			}
+		}
+
+		[[nodiscard]] DaedalusScript build() const {
+			auto data = encode();
+			auto r = Read::from(&data);
+			DaedalusScript script {};
+			script.load(r.get());
+			return script;
+		}
+
+		[[nodiscard]] std::vector<std::byte> encode() const {
+			std::vector<std::byte> data;
+			auto w = Write::to(&data);
+
+			w->write_ubyte(50);
+			w->write_uint(static_cast<std::uint32_t>(symbols.size()));
+			for (auto i = 0u; i < symbols.size(); ++i) {
+				w->write_uint(i);
+			}
+
+			for (auto& sym : symbols) {
+				w->write_uint(1);
+				w->write_line(sym.name);
+				w->write_uint(sym.vary);
+				w->write_uint(sym.count | (static_cast<std::uint32_t>(sym.type) << 12) | (sym.flags << 16));
+
+				for (auto i = 0; i < 5; ++i) {
+					w->write_uint(0);
+				}
+
+				if (sym.flags & DaedalusSymbolFlag::MEMBER) {
+					// Members have no value.
+				} else if (sym.type == DaedalusDataType::INT || sym.type == DaedalusDataType::FLOAT) {
+					for (auto v : sym.values) {
+						w->write_int(v);
+					}
+				} else if (sym.type == DaedalusDataType::STRING) {
+					w->write_line(sym.string);
+				} else if (sym.type == DaedalusDataType::FUNCTION || sym.type == DaedalusDataType::INSTANCE ||
+				           sym.type == DaedalusDataType::PROTOTYPE) {
+					w->write_int(sym.address);
+				} else if (sym.type == DaedalusDataType::CLASS) {
+					w->write_int(0);
+				}
+
+				w->write_int(sym.parent);
+			}
+
+			w->write_uint(static_cast<std::uint32_t>(code.size()));
+			w->write(code.data(), code.size());
+			return data;
+		}
+
+		std::vector<Symbol> symbols;
+		std::vector<std::byte> code;
+	};
+
+	/// \brief Builds the script translated by `test-zenkit-translate` for the DaedalusTranslator tests.
+	///
+	/// It contains `COLLATZ(N)`, which counts the steps of the Collatz sequence starting at `N`, `MIX(A, B)`, which
+	/// combines `A`, `B`, `EXT_DOUBLE(5)` and `COLLATZ(6)` using arithmetic, bitwise and comparison operators,
+	/// `GREET(NAME)`, which sets the global `GREETING` to `EXT_CONCAT(PREFIX, NAME)` and returns it, and `SCALE(F)`,
+	/// which sets the global `LAST` to `F` and `FACTOR` to 1.5 and returns `LAST`.
+	inline DaedalusScript make_translator_script() {
+		ScriptBuilder b;
+		using Op = DaedalusOpcode;
+
+		auto ext_double = b.external("EXT_DOUBLE", 1, true);
+		b.variable("EXT_DOUBLE.PAR0");
+
+		auto ext_concat = b.external("EXT_CONCAT", 2);
+		b.returns(ext_concat, DaedalusDataType::STRING);
+		b.string("EXT_CONCAT.PAR0");
+		b.string("EXT_CONCAT.PAR1");
+
+		auto prefix = b.string("PREFIX", "Hello, ");
+		auto greeting = b.string("GREETING");
+		auto last = b.real("LAST");
+		auto factor = b.real("FACTOR");
+
+		// Superinstructions: MOVI_IMM for `S = 0` and BZ_CMP_IMM for `N > 1`.
+		auto collatz = b.function("COLLATZ", 1, true);
+		auto n = b.variable("COLLATZ.N");
+		auto s = b.variable("COLLATZ.S");
+		b.op(Op::PUSHV, n).op(Op::MOVI);
+		b.op(Op::PUSHI, 0).op(Op::PUSHV, s).op(Op::MOVI);
+		auto loop = b.here();
+		b.op(Op::PUSHI, 1).op(Op::PUSHV, n).op(Op::GT);
+		auto exit = b.here();
+		b.op(Op::BZ, 0);
+		b.op(Op::PUSHI, 2).op(Op::PUSHV, n).op(Op::MOD);
+		auto even = b.here();
+		b.op(Op::BZ, 0);
+		b.op(Op::PUSHI, 3).op(Op::PUSHV, n).op(Op::MULMOVI);
+		b.op(Op::PUSHI, 1).op(Op::PUSHV, n).op(Op::ADDMOVI);
+		auto next = b.here();
+		b.op(Op::B, 0);
+		b.patch(even, b.here());
+		b.op(Op::PUSHI, 2).op(Op::PUSHV, n).op(Op::DIVMOVI);
+		b.patch(next, b.here());
+		b.op(Op::PUSHI, 1).op(Op::PUSHV, s).op(Op::ADDMOVI);
+		b.op(Op::B, loop);
+		b.patch(exit, b.here());
+		b.op(Op::PUSHV, s).op(Op::RSR);
+
+		// Superinstruction: BE_IMM for `EXT_DOUBLE(5)`.
+		b.function("MIX", 2, true);
+		auto a = b.variable("MIX.A");
+		auto c = b.variable("MIX.B");
+		b.op(Op::PUSHV, c).op(Op::MOVI).op(Op::PUSHV, a).op(Op::MOVI);
+		b.op(Op::PUSHI, 5).op(Op::BE, ext_double).op(Op::PUSHV, a).op(Op::ADDMOVI);
+		b.op(Op::PUSHV, c).op(Op::PUSHV, a).op(Op::SUBMOVI);
+		b.op(Op::PUSHV, c).op(Op::PUSHV, a).op(Op::LTE);
+		b.op(Op::PUSHV, a).op(Op::NEGATE).op(Op::PUSHV, c).op(Op::CMPL).op(Op::ANDB).op(Op::ADD);
+		b.op(Op::PUSHV, c).op(Op::PUSHV, a).op(Op::EQ).op(Op::NOT).op(Op::OR);
+		b.op(Op::PUSHI, 6).op(Op::BL, static_cast<std::uint32_t>(b.symbols[collatz].address)).op(Op::ADD);
+		b.op(Op::RSR);
+
+		auto greet = b.function("GREET", 1);
+		b.returns(greet, DaedalusDataType::STRING);
+		auto name = b.string("GREET.NAME");
+		b.op(Op::PUSHV, name).op(Op::MOVS);
+		b.op(Op::PUSHV, prefix).op(Op::PUSHV, name).op(Op::BE, ext_concat);
+		b.op(Op::PUSHV, greeting).op(Op::MOVS);
+		b.op(Op::PUSHV, greeting).op(Op::RSR);
+
+		auto scale = b.function("SCALE", 1);
+		b.returns(scale, DaedalusDataType::FLOAT);
+		auto f = b.real("SCALE.F");
+		b.op(Op::PUSHV, f).op(Op::MOVF);
+		b.op(Op::PUSHV, f).op(Op::PUSHV, last).op(Op::MOVF);
+		b.op(Op::PUSHI, std::bit_cast<std::uint32_t>(1.5f)).op(Op::PUSHV, factor).op(Op::MOVF);
+		b.op(Op::PUSHV, last).op(Op::RSR);
+
+		return b.build();
+	}
+} // namespace zenkit::test
@@ -0,0 +1,1382 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include "DaedalusScriptBuilder.hh"
+
+#include <doctest/doctest.h>
+#include <zenkit/DaedalusCallGraph.hh>
+#include <zenkit/DaedalusTranslator.hh>
+#include <zenkit/DaedalusVm.hh>
+#include <zenkit/Stream.hh>
+
+#include <algorithm>
+#include <array>
+#include <set>
+#include <utility>
+#include <thread>
+
+using namespace zenkit;
+using zenkit::test::ScriptBuilder;
+
+/// \brief The translation of zenkit::test::make_translator_script(), generated by `test-zenkit-translate`.
+extern DaedalusNativeModule const TRANSLATOR_TEST_MODULE;
+
+namespace {
+	struct TestInstance : DaedalusInstance {};
+
+	/// \brief An instance which derives from std::enable_shared_from_this a second time, so that
+	///        DaedalusInstance::weak_from_this does not know its owner.
+	struct TestSharedInstance : DaedalusInstance, std::enable_shared_from_this<TestSharedInstance> {};
+
+	struct TestItem : DaedalusInstance {
+		std::int32_t value;
+		std::int32_t flags;
+	};
+
+	/// \brief Builds a script containing `SUM(N)`, which adds up all integers in `[0, N)` using a loop,
+	///        `SUB(A, B)`, `TWICE_MINUS_ONE(A)` which calls the external `EXT_DOUBLE(A)` and `SUB` as well
+	///        as `DIV_PLUS_ONE(A, B)` and `REC(N)`, which recurses down to zero and returns the value of its
+	///        local variable `L`, which is set to `N` before the recursive call. `DOUBLE_SEVEN()` returns
+	///        `EXT_DOUBLE(7)`.
+	DaedalusScript make_test_script() {
+		ScriptBuilder b;
+		using Op = DaedalusOpcode;
+
+		auto ext_double = b.external("EXT_DOUBLE", 1, true);
+		b.variable("EXT_DOUBLE.PAR0");
+
+		b.function("SUM", 1, true);
+		auto n = b.variable("SUM.N");
+		auto s = b.variable("SUM.S");
+		auto i = b.variable("SUM.I");
+		b.op(Op::PUSHV, n).op(Op::MOVI);
+		b.op(Op::PUSHI, 0).op(Op::PUSHV, s).op(Op::MOVI);
+		b.op(Op::PUSHI, 0).op(Op::PUSHV, i).op(Op::MOVI);
+		auto loop = b.here();
+		b.op(Op::PUSHV, n).op(Op::PUSHV, i).op(Op::LT);
+		auto exit = b.here();
+		b.op(Op::BZ, 0);
+		b.op(Op::PUSHV, i).op(Op::PUSHV, s).op(Op::ADDMOVI);
+		b.op(Op::PUSHI, 1).op(Op::PUSHV, i).op(Op::ADDMOVI);
+		b.op(Op::B, loop);
+		b.patch(exit, b.here());
+		b.op(Op::PUSHV, s).op(Op::RSR);
+
+		b.function("SUB", 2, true);
+		auto sa = b.variable("SUB.A");
+		auto sb = b.variable("SUB.B");
+		b.op(Op::PUSHV, sb).op(Op::MOVI).op(Op::PUSHV, sa).op(Op::MOVI);
+		b.op(Op::PUSHV, sb).op(Op::PUSHV, sa).op(Op::SUB).op(Op::RSR);
+
+		auto sub_address = b.symbols[b.symbols.size() - 3].address;
+
+		b.function("TWICE_MINUS_ONE", 1, true);
+		auto ta = b.variable("TWICE_MINUS_ONE.A");
+		b.op(Op::PUSHV, ta).op(Op::MOVI);
+		b.op(Op::PUSHV, ta).op(Op::BE, ext_double).op(Op::PUSHI, 1);
+		b.op(Op::BL, static_cast<std::uint32_t>(sub_address)).op(Op::RSR);
+
+		b.function("DIV_PLUS_ONE", 2, true);
+		auto da = b.variable("DIV_PLUS_ONE.A");
+		auto db = b.variable("DIV_PLUS_ONE.B");
+		b.op(Op::PUSHV, db).op(Op::MOVI).op(Op::PUSHV, da).op(Op::MOVI);
+		b.op(Op::PUSHV, db).op(Op::PUSHV, da).op(Op::DIV).op(Op::PUSHI, 1).op(Op::ADD).op(Op::RSR);
+
+		auto rec = b.function("REC", 1, true);
+		auto rn = b.variable("REC.N");
+		auto rl = b.variable("REC.L");
+		b.op(Op::PUSHV, rn).op(Op::MOVI);
+		b.op(Op::PUSHV, rn).op(Op::PUSHV, rl).op(Op::MOVI);
+		b.op(Op::PUSHI, 0).op(Op::PUSHV, rn).op(Op::GT);
+		auto done = b.here();
+		b.op(Op::BZ, 0);
+		b.op(Op::PUSHI, 1).op(Op::PUSHV, rn).op(Op::SUB);
+		b.op(Op::BL, static_cast<std::uint32_t>(b.symbols[rec].address));
+		b.patch(done, b.here());
+		b.op(Op::PUSHV, rl).op(Op::RSR);
+
+		b.function("DOUBLE_SEVEN", 0, true);
+		b.op(Op::PUSHI, 7).op(Op::BE, ext_double).op(Op::RSR);
+
+		return b.build();
+	}
+
+	/// \brief Builds a script containing only `ANSWER()`, which returns 1.
+	DaedalusScript make_answer_script() {
+		ScriptBuilder b;
+		b.function("ANSWER", 0, true);
+		b.op(DaedalusOpcode::PUSHI, 1).op(DaedalusOpcode::RSR);
+		return b.build();
+	}
+
+	/// \brief Builds a script with the functions `COND()`, which returns `2 * 3 + ON` unless the constant `OFF` is
+	///        set, and `LOCALS(X)`, which returns `2 * X - 10` if that is positive and `2 * X` otherwise.
+	DaedalusScript make_constant_script() {
+		ScriptBuilder b;
+		using Op = DaedalusOpcode;
+
+		auto on = b.variable("ON", 1, DaedalusSymbolFlag::CONST);
+		auto off = b.variable("OFF", 0, DaedalusSymbolFlag::CONST);
+		auto side_effect = b.external("SIDE_EFFECT", 0, true);
+
+		b.function("COND", 0, true);
+		b.op(Op::PUSHV, off);
+		auto skip = b.here();
+		b.op(Op::BZ, 0);
+		b.op(Op::BE, side_effect).op(Op::RSR);
+		b.patch(skip, b.here());
+		b.op(Op::PUSHI, 2).op(Op::PUSHI, 3).op(Op::MUL).op(Op::PUSHV, on).op(Op::ADD).op(Op::RSR);
+
+		b.function("LOCALS", 1, true);
+		auto x = b.variable("LOCALS.X");
+		auto y = b.variable("LOCALS.Y");
+		b.op(Op::PUSHV, x).op(Op::MOVI);
+		b.op(Op::PUSHI, 2).op(Op::PUSHV, x).op(Op::MUL).op(Op::PUSHV, y).op(Op::MOVI);
+		b.op(Op::PUSHI, 10).op(Op::PUSHV, y).op(Op::GT);
+		auto small = b.here();
+		b.op(Op::BZ, 0);
+		b.op(Op::PUSHI, 10).op(Op::PUSHV, y).op(Op::SUB).op(Op::RSR);
+		b.patch(small, b.here());
+		b.op(Op::PUSHV, y).op(Op::RSR);
+
+		return b.build();
+	}
+
+	/// \brief Builds a script with the class `C_ITEM`, the prototype `ITEMPR`, which sets `VALUE` to the global
+	///        `BASE_VALUE`, and the instances `ITSWORD`, which sets `FLAGS` to 5, and `ITPOTION`, which sets `FLAGS`
+	///        to the result of the external `RANDOM()`. `ITSHIELD` does not use the prototype and sets `VALUE` to the
+	///        result of `SHIELD_VALUE()`, which returns 7 using a local variable, and `FLAGS` to 3. The globals `NAME`
+	///        and `CURRENT` are not used by the code.
+	DaedalusScript make_instance_script() {
+		ScriptBuilder b;
+		using Op = DaedalusOpcode;
+
+		auto base_value = b.variable("BASE_VALUE", 10);
+		auto random = b.external("RANDOM", 0, true);
+		b.string("NAME", "Sword");
+
+		auto item = b.cls("C_ITEM", 2);
+		auto value = b.member("C_ITEM.VALUE", item);
+		auto flags = b.member("C_ITEM.FLAGS", item);
+
+		auto current = b.instance("CURRENT", item);
+		b.symbols[current].flags = 0;
+
+		auto prototype = b.instance("ITEMPR", item, true);
+		b.op(Op::PUSHV, base_value).op(Op::PUSHV, value).op(Op::MOVI).op(Op::RSR);
+
+		auto prototype_address = static_cast<std::uint32_t>(b.symbols[prototype].address);
+		b.instance("ITSWORD", prototype);
+		b.op(Op::BL, prototype_address);
+		b.op(Op::PUSHI, 5).op(Op::PUSHV, flags).op(Op::MOVI).op(Op::RSR);
+
+		b.instance("ITPOTION", prototype);
+		b.op(Op::BL, prototype_address);
+		b.op(Op::BE, random).op(Op::PUSHV, flags).op(Op::MOVI).op(Op::RSR);
+
+		auto shield_value = b.function("SHIELD_VALUE", 0, true);
+		auto local = b.variable("SHIELD_VALUE.L");
+		b.op(Op::PUSHI, 7).op(Op::PUSHV, local).op(Op::MOVI).op(Op::PUSHV, local).op(Op::RSR);
+
+		auto shield_value_address = static_cast<std::uint32_t>(b.symbols[shield_value].address);
+		b.instance("ITSHIELD", item);
+		b.op(Op::BL, shield_value_address).op(Op::PUSHV, value).op(Op::MOVI);
+		b.op(Op::PUSHI, 3).op(Op::PUSHV, flags).op(Op::MOVI).op(Op::RSR);
+
+		return b.build();
+	}
+
+	/// \brief A hand-written stand-in for the translation of `SUB(A, B)`, which returns `A - B + 1000` instead.
+	void native_sub(DaedalusVm& vm) {
+		auto b = vm.pop_int();
+		auto a = vm.pop_int();
+		vm.push_int(a - b + 1000);
+	}
+
+	void native_sub_failing(DaedalusVm& vm) {
+		vm.push_int(vm.pop_int() + vm.pop_int());
+		throw DaedalusVmException {"failed"};
+	}
+
+	void native_answer(DaedalusVm& vm) {
+		vm.push_int(42);
+	}
+} // namespace
+
+TEST_SUITE("DaedalusVm") {
+	TEST_CASE("DaedalusScript.instruction_at") {
+		auto script = make_test_script();
+		auto* sum = script.find_symbol_by_name("SUM");
+		REQUIRE_NE(sum, nullptr);
+
+		auto instr = script.instruction_at(sum->address());
+		CHECK_EQ(instr.op, DaedalusOpcode::PUSHV);
+		CHECK_EQ(instr.size, 5);
+		CHECK_EQ(instr.symbol, script.find_symbol_by_name("SUM.N")->index());
+
+		instr = script.instruction_at(sum->address() + 5);
+		CHECK_EQ(instr.op, DaedalusOpcode::MOVI);
+		CHECK_EQ(instr.size, 1);
+
+		instr = script.instruction_at(sum->address() + 6);
+		CHECK_EQ(instr.op, DaedalusOpcode::PUSHI);
+		CHECK_EQ(instr.immediate, 0);
+
+		// Superinstructions replace the opcode of the first instruction of a sequence in the pre-decoded code only.
+		auto* fused = script.compact_instruction_at(sum->address() + 6);
+		REQUIRE_NE(fused, nullptr);
+		CHECK_EQ(fused->op, DaedalusOpcode::MOVI_IMM);
+		CHECK_EQ(fused->original_op(), DaedalusOpcode::PUSHI);
+		CHECK_EQ(fused->size, 5);
+		CHECK_EQ(script.compact_instruction_at(script.find_symbol_by_name("REC")->address() + 17)->op,
+		         DaedalusOpcode::BZ_CMP_IMM);
+		CHECK_EQ(script.compact_instruction_at(script.find_symbol_by_name("DOUBLE_SEVEN")->address())->op,
+		         DaedalusOpcode::BE_IMM);
+
+		CHECK_NE(script.compact_instruction_at(sum->address()), nullptr);
+		CHECK_EQ(script.compact_instruction_at(sum->address() + 1), nullptr);
+		CHECK_EQ(script.compact_instruction_at(script.size()), nullptr);
+
+		// Call targets are resolved to their symbol while loading but still reported as addresses.
+		auto* twice = script.find_symbol_by_name("TWICE_MINUS_ONE");
+		REQUIRE_NE(twice, nullptr);
+
+		auto* call = script.compact_instruction_at(twice->address() + 21);
+		REQUIRE_NE(call, nullptr);
+		CHECK_EQ(call->op, DaedalusOpcode::BL);
+		CHECK(call->resolved);
+		CHECK_EQ(call->arg, script.find_symbol_by_name("SUB")->index());
+		CHECK_EQ(script.instruction_at(twice->address() + 21).address, script.find_symbol_by_name("SUB")->address());
+	}
+
+	TEST_CASE("DaedalusScript.load_all") {
+		ScriptBuilder b;
+		b.variable("VALUE", 42);
+		b.string("NAME", "Sword");
+		b.op(DaedalusOpcode::RSR);
+
+		auto data = b.encode();
+
+		DaedalusScript script;
+		script.load(data);
+		REQUIRE_NE(script.find_symbol_by_name("VALUE"), nullptr);
+		CHECK_EQ(script.find_symbol_by_name("VALUE")->get_int(), 42);
+		CHECK_EQ(script.find_symbol_by_name("NAME")->get_string(), "Sword");
+		CHECK_EQ(script.size(), 1);
+
+		// Streams are left positioned right after the script.
+		auto padded = data;
+		padded.push_back(std::byte {0xAB});
+
+		auto r0 = Read::from(&data);
+		auto r1 = Read::from(&padded);
+		Read* readers[] = {r0.get(), r1.get()};
+
+		auto scripts = DaedalusScript::load_all(readers);
+		REQUIRE_EQ(scripts.size(), 2);
+		CHECK_EQ(r1->tell(), data.size());
+		CHECK_EQ(r1->read_ubyte(), 0xAB);
+
+		for (auto& s : scripts) {
+			CHECK_EQ(s.checksum(), script.checksum());
+			CHECK_EQ(s.find_symbol_by_name("NAME")->get_string(), "Sword");
+		}
+	}
+
+	TEST_CASE("DaedalusScript.find_symbol_by_name") {
+		auto script = make_test_script();
+		auto* sum = script.find_symbol_by_name("SUM.N");
+		REQUIRE_NE(sum, nullptr);
+
+		CHECK_EQ(script.find_symbol_by_name("sum.n"), sum);
+		CHECK_EQ(script.find_symbol_by_name("Sum.N"), sum);
+		CHECK_EQ(script.find_symbol_by_name(std::string_view {"SUM.NX"}.substr(0, 5)), sum);
+		CHECK_EQ(script.find_symbol_by_name("SUM.M"), nullptr);
+		CHECK_EQ(script.find_symbol_by_name("SUM.N."), nullptr);
+		CHECK_EQ(script.find_symbol_by_name(""), nullptr);
+	}
+
+	TEST_CASE("DaedalusScript.fork") {
+		auto script = make_test_script();
+		script.find_symbol_by_name("SUM.N")->set_int(5);
+
+		std::array<DaedalusSymbol const*, 1> shared {script.find_symbol_by_name("SUB.A")};
+		auto fork = script.fork(shared);
+
+		// The bytecode is shared between both scripts.
+		CHECK_EQ(fork.size(), script.size());
+		CHECK_EQ(fork.compact_instruction_at(0), script.compact_instruction_at(0));
+		CHECK_EQ(fork.symbols().size(), script.symbols().size());
+
+		// Globals are copied, unless they are explicitly shared.
+		CHECK_EQ(fork.find_symbol_by_name("SUM.N")->get_int(), 5);
+		fork.find_symbol_by_name("SUM.N")->set_int(7);
+		CHECK_EQ(script.find_symbol_by_name("SUM.N")->get_int(), 5);
+
+		fork.find_symbol_by_name("SUB.A")->set_int(9);
+		CHECK_EQ(script.find_symbol_by_name("SUB.A")->get_int(), 9);
+
+		// Symbols added after loading are copied, too.
+		DaedalusVm vm {make_test_script()};
+		auto vm_fork = vm.fork();
+		REQUIRE_EQ(vm_fork.symbols().size(), vm.symbols().size());
+		CHECK_EQ(vm_fork.symbols().back().name(), vm.symbols().back().name());
+	}
+
+	TEST_CASE("DaedalusVm.fork") {
+		auto script = make_test_script();
+
+		std::vector<DaedalusScript> forks;
+		for (auto i = 0; i < 4; ++i) {
+			forks.push_back(script.fork());
+		}
+
+		std::array<int, 4> results {};
+		std::vector<std::thread> threads;
+		for (auto i = 0; i < 4; ++i) {
+			threads.emplace_back([&forks, &results, i] {
+				DaedalusVm vm {std::move(forks[i])};
+				for (auto j = 0; j < 100; ++j) {
+					results[i] = vm.call_function<int>("SUM", 1000 + i);
+				}
+			});
+		}
+
+		for (auto& t : threads) {
+			t.join();
+		}
+
+		for (auto i = 0; i < 4; ++i) {
+			CHECK_EQ(results[i], (1000 + i) * (999 + i) / 2);
+		}
+	}
+
+	TEST_CASE("DaedalusVm.call_function") {
+		DaedalusVm vm {make_test_script()};
+		vm.register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+
+		CHECK_EQ(vm.call_function<int>("SUM", 0), 0);
+		CHECK_EQ(vm.call_function<int>("SUM", 10), 45);
+		CHECK_EQ(vm.call_function<int>("SUB", 10, 3), 7);
+		CHECK_EQ(vm.call_function<int>("TWICE_MINUS_ONE", 21), 41);
+	}
+
+	TEST_CASE("DaedalusVm.recursion") {
+		DaedalusVm vm {make_test_script()};
+		auto* rec = vm.find_symbol_by_name("REC");
+		REQUIRE_NE(rec, nullptr);
+
+		auto* info = vm.find_function_info(rec);
+		REQUIRE_NE(info, nullptr);
+		CHECK_EQ(info->symbol, rec->index());
+		CHECK_EQ(info->params_count, 1);
+		CHECK_EQ(info->locals_count, 1);
+		CHECK_EQ(info->locals_footprint, 1);
+		CHECK_EQ(vm.find_locals_for_function(rec)[0].name(), "REC.L");
+		CHECK_EQ(vm.find_function_info(vm.find_symbol_by_name("REC.L")), nullptr);
+
+		// Without saving locals, the innermost call overwrites `L` for all callers.
+		CHECK_EQ(vm.call_function<int>("REC", 3), 0);
+
+		rec->set_local_variables_enable(true);
+		CHECK_EQ(vm.call_function<int>("REC", 3), 3);
+		CHECK_EQ(vm.call_function<int>("REC", 3), 3);
+	}
+
+	TEST_CASE("DaedalusVm.override_function") {
+		DaedalusVm vm {make_test_script()};
+		vm.register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+		CHECK_FALSE(vm.find_symbol_by_name("SUB")->has_override());
+
+		vm.override_function("SUB", [](int a, int b) { return a + b; });
+		CHECK(vm.find_symbol_by_name("SUB")->has_override());
+		CHECK_EQ(vm.call_function<int>("TWICE_MINUS_ONE", 21), 43);
+
+		// Re-binding replaces the previous override.
+		vm.override_function("SUB", [](int a, int b) { return a * b; });
+		CHECK_EQ(vm.call_function<int>("TWICE_MINUS_ONE", 21), 42);
+	}
+
+	TEST_CASE("DaedalusVm.exception_handler") {
+		DaedalusVm vm {make_test_script()};
+		CHECK_EQ(vm.call_function<int>("DIV_PLUS_ONE", 9, 3), 4);
+		CHECK_THROWS_AS((void) vm.call_function<int>("DIV_PLUS_ONE", 9, 0), DaedalusVmException);
+
+		DaedalusVm lenient {make_test_script()};
+		lenient.register_exception_handler(lenient_vm_exception_handler);
+		CHECK_EQ(lenient.call_function<int>("DIV_PLUS_ONE", 9, 0), 1);
+	}
+
+	TEST_CASE("DaedalusVm.exception_unwind") {
+		DaedalusVm vm {make_test_script()};
+		vm.register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+
+		auto instance = std::make_shared<TestInstance>();
+		std::weak_ptr<TestInstance> weak = instance;
+		vm.unsafe_set_gi(instance);
+		instance.reset();
+
+		vm.push_string("temporary");
+		(void) vm.pop_string();
+
+		CHECK_THROWS_AS((void) vm.call_function<int>("DIV_PLUS_ONE", 1, 0), DaedalusVmException);
+
+		// The failed call does not leave anything on the stack.
+		CHECK_THROWS_AS((void) vm.top_is_reference(), DaedalusVmException);
+
+		// Once the next call returns, nothing stays pinned and all temporary strings are reused.
+		vm.unsafe_set_gi(nullptr);
+		CHECK_EQ(vm.call_function<int>("SUM", 3), 3);
+		CHECK(weak.expired());
+
+		vm.push_string("reused");
+		CHECK_EQ(std::get<1>(vm.pop_reference()), 0);
+
+		// Errors raised by externals unwind the calling functions as well.
+		vm.register_external("EXT_DOUBLE", [](int) -> int { throw DaedalusVmException {"failed"}; });
+		CHECK_THROWS_AS((void) vm.call_function<int>("TWICE_MINUS_ONE", 21), DaedalusVmException);
+		CHECK_THROWS_AS((void) vm.top_is_reference(), DaedalusVmException);
+		CHECK_EQ(vm.call_function<int>("SUB", 10, 3), 7);
+	}
+
+	TEST_CASE("DaedalusScript.verify_function") {
+		auto script = make_test_script();
+
+		for (auto name : {"SUM", "SUB", "TWICE_MINUS_ONE", "DIV_PLUS_ONE"}) {
+			auto result = script.verify_function(script.find_symbol_by_name(name));
+			CHECK(result.verified);
+			CHECK_EQ(result.error, "");
+		}
+
+		auto sum = script.verify_function(script.find_symbol_by_name("SUM"));
+		CHECK_EQ(sum.max_stack_depth, 2);
+
+		// The result of the recursive call is left on the stack, so the stack differs after the `if`.
+		auto* rec = script.find_symbol_by_name("REC");
+		auto result = script.verify_function(rec);
+		CHECK_FALSE(result.verified);
+		CHECK_FALSE(result.error.empty());
+		CHECK_EQ(result.error_address, rec->address() + 49);
+
+		CHECK_FALSE(script.verify_function(script.find_symbol_by_name("EXT_DOUBLE")).verified);
+		CHECK_FALSE(script.verify_function(script.find_symbol_by_name("SUM.N")).verified);
+	}
+
+	TEST_CASE("DaedalusVm.unchecked") {
+		DaedalusVm vm {make_test_script(), DaedalusVmExecutionFlag::UNCHECKED};
+		vm.register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+
+		CHECK(vm.is_function_verified(vm.find_symbol_by_name("SUM")));
+		CHECK_FALSE(vm.is_function_verified(vm.find_symbol_by_name("REC")));
+
+		CHECK_EQ(vm.call_function<int>("SUM", 10), 45);
+		CHECK_EQ(vm.call_function<int>("TWICE_MINUS_ONE", 21), 41);
+		CHECK_THROWS_AS((void) vm.call_function<int>("DIV_PLUS_ONE", 9, 0), DaedalusVmException);
+
+		// Functions which failed verification still run with checks.
+		vm.find_symbol_by_name("REC")->set_local_variables_enable(true);
+		CHECK_EQ(vm.call_function<int>("REC", 3), 3);
+
+		// Without the flag, nothing is verified.
+		DaedalusVm checked {make_test_script()};
+		CHECK_FALSE(checked.is_function_verified(checked.find_symbol_by_name("SUM")));
+	}
+
+	TEST_CASE("DaedalusVm.unchecked(continue)") {
+		ScriptBuilder b;
+		using Op = DaedalusOpcode;
+
+		auto ext = b.external("EXT", 1, true);
+		b.variable("EXT.PAR0");
+
+		b.function("FAIL_THEN_ADD", 0, true);
+		b.op(Op::PUSHI, 0).op(Op::PUSHI, 1).op(Op::DIV).op(Op::PUSHI, 5).op(Op::ADD).op(Op::RSR);
+
+		b.function("CALL_EXT", 0, true);
+		b.op(Op::PUSHI, 1).op(Op::PUSHI, 2).op(Op::BE, ext).op(Op::ADD).op(Op::RSR);
+
+		DaedalusVm vm {b.build(), DaedalusVmExecutionFlag::UNCHECKED};
+		vm.register_exception_handler([](DaedalusVm&, DaedalusScriptError const&, DaedalusInstruction const&) {
+			return DaedalusVmExceptionStrategy::CONTINUE;
+		});
+
+		// `DIV` pops both operands before failing, so `ADD` finds only one operand on the stack.
+		REQUIRE(vm.is_function_verified(vm.find_symbol_by_name("FAIL_THEN_ADD")));
+		CHECK_EQ(vm.call_function<int>("FAIL_THEN_ADD"), 5);
+		CHECK_EQ(vm.call_function<int>("FAIL_THEN_ADD"), 5);
+
+		// The external pops its argument but does not push its declared return value.
+		REQUIRE(vm.is_function_verified(vm.find_symbol_by_name("CALL_EXT")));
+		vm.register_default_external_custom([](DaedalusVm& v, DaedalusSymbol&) { (void) v.pop_int(); });
+		CHECK_EQ(vm.call_function<int>("CALL_EXT"), 1);
+	}
+
+	TEST_CASE("DaedalusVm.unchecked(types)") {
+		ScriptBuilder b;
+		using Op = DaedalusOpcode;
+
+		auto ext = b.external("EXT", 0, true);
+		auto get = b.function("GET", 0, true);
+		b.op(Op::PUSHI, 1).op(Op::RSR);
+
+		b.function("CALL_GET", 0, true);
+		b.op(Op::BL, static_cast<std::uint32_t>(b.symbols[get].address)).op(Op::PUSHI, 1).op(Op::ADD).op(Op::RSR);
+
+		b.function("CALL_EXT", 0, true);
+		b.op(Op::BE, ext).op(Op::PUSHI, 1).op(Op::ADD).op(Op::RSR);
+
+		DaedalusVm vm {b.build(), DaedalusVmExecutionFlag::UNCHECKED};
+		REQUIRE(vm.is_function_verified(vm.find_symbol_by_name("CALL_GET")));
+		REQUIRE(vm.is_function_verified(vm.find_symbol_by_name("CALL_EXT")));
+
+		CHECK_EQ(vm.call_function<int>("CALL_GET"), 2);
+
+		// The stack depth is right, but the return values have the wrong type. The checks catch that.
+		vm.override_function("GET", [](DaedalusVm& v) {
+			v.push_string("one");
+			return DaedalusNakedCall {};
+		});
+		vm.register_default_external_custom([](DaedalusVm& v, DaedalusSymbol&) { v.push_float(2.0f); });
+		CHECK_THROWS_AS((void) vm.call_function<int>("CALL_GET"), DaedalusIllegalTypeAccess);
+		CHECK_THROWS_AS((void) vm.call_function<int>("CALL_EXT"), DaedalusVmException);
+	}
+
+	TEST_CASE("DaedalusVm.superinstructions") {
+		for (auto flags : {DaedalusVmExecutionFlag::NONE, DaedalusVmExecutionFlag::DISABLE_SUPERINSTRUCTIONS}) {
+			DaedalusVm vm {make_test_script(), flags};
+			vm.register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+
+			CHECK_EQ(vm.call_function<int>("SUM", 10), 45);
+			CHECK_EQ(vm.call_function<int>("DOUBLE_SEVEN"), 14);
+
+			vm.find_symbol_by_name("REC")->set_local_variables_enable(true);
+			CHECK_EQ(vm.call_function<int>("REC", 3), 3);
+			CHECK_EQ(vm.call_function<int>("REC", 0), 0);
+
+			// Access traps still fire for variables used by superinstructions.
+			auto traps = 0;
+			vm.register_access_trap([&](DaedalusSymbol& sym) {
+				++traps;
+				vm.push_reference(&sym);
+			});
+
+			vm.find_symbol_by_name("SUM.S")->set_access_trap_enable(true);
+			CHECK_EQ(vm.call_function<int>("SUM", 10), 45);
+			CHECK_EQ(traps, 12);
+		}
+	}
+
+	TEST_CASE("DaedalusVm.start_call") {
+		DaedalusVm vm {make_test_script()};
+		auto* sum = vm.find_symbol_by_name("SUM");
+
+		DaedalusVmBudget budget;
+		budget.instructions = 100;
+
+		vm.push_int(1000);
+		auto slices = 1;
+		auto result = vm.start_call(sum, budget);
+		while (result == DaedalusVmExecutionResult::SUSPENDED) {
+			CHECK(vm.is_suspended());
+			CHECK_THROWS_AS(vm.start_call(sum, budget), DaedalusVmException);
+
+			// Other functions may be called while suspended.
+			CHECK_EQ(vm.call_function<int>("SUB", 10, 3), 7);
+
+			result = vm.resume(budget);
+			++slices;
+		}
+
+		CHECK_FALSE(vm.is_suspended());
+		CHECK_EQ(vm.pop_int(), 499500);
+		CHECK_GT(slices, 100);
+		CHECK_THROWS_AS(vm.resume(budget), DaedalusVmException);
+
+		// Without limits, the call finishes in a single slice, even if it recurses.
+		vm.find_symbol_by_name("REC")->set_local_variables_enable(true);
+		vm.push_int(5);
+		CHECK_EQ(vm.start_call(vm.find_symbol_by_name("REC"), {}), DaedalusVmExecutionResult::FINISHED);
+		CHECK_EQ(vm.pop_int(), 5);
+	}
+
+	TEST_CASE("DaedalusVm.request_suspend") {
+		DaedalusVm vm {make_test_script()};
+		vm.register_external("EXT_DOUBLE", [&vm](int a) {
+			vm.request_suspend();
+			return a * 2;
+		});
+
+		vm.push_int(21);
+		REQUIRE_EQ(vm.start_call(vm.find_symbol_by_name("TWICE_MINUS_ONE"), {}), DaedalusVmExecutionResult::SUSPENDED);
+		REQUIRE_EQ(vm.resume({}), DaedalusVmExecutionResult::FINISHED);
+		CHECK_EQ(vm.pop_int(), 41);
+	}
+
+	TEST_CASE("DaedalusScript.checksum") {
+		auto script = make_test_script();
+		CHECK_NE(script.checksum(), 0);
+		CHECK_EQ(make_test_script().checksum(), script.checksum());
+		CHECK_EQ(script.fork().checksum(), script.checksum());
+		CHECK_NE(make_answer_script().checksum(), script.checksum());
+	}
+
+	TEST_CASE("DaedalusTranslator") {
+		auto script = make_test_script();
+		DaedalusTranslator translator {script};
+		CHECK(translator.can_translate(*script.find_symbol_by_name("SUM")));
+		CHECK(translator.can_translate(*script.find_symbol_by_name("REC")));
+		CHECK_FALSE(translator.can_translate(*script.find_symbol_by_name("EXT_DOUBLE")));
+		CHECK_FALSE(translator.can_translate(*script.find_symbol_by_name("SUM.N")));
+
+		std::vector<std::byte> data;
+		auto w = Write::to(&data);
+		CHECK_EQ(translator.write_source(w.get(), "TEST_MODULE"), 6);
+
+		std::string source {reinterpret_cast<char const*>(data.data()), data.size()};
+		auto ext_double = std::to_string(script.find_symbol_by_name("EXT_DOUBLE")->index());
+		auto sub = std::to_string(script.find_symbol_by_name("SUB")->index());
+
+		CHECK_NE(source.find("\t// TWICE_MINUS_ONE\n"), std::string::npos);
+		CHECK_NE(source.find("vm.native_be(" + ext_double + ");"), std::string::npos);
+		CHECK_NE(source.find("vm.native_bl(" + sub + ");"), std::string::npos);
+		CHECK_NE(source.find("zenkit::DaedalusNativeModule const TEST_MODULE"), std::string::npos);
+		CHECK_NE(source.find("zenkit::register_native_module(TEST_MODULE)"), std::string::npos);
+	}
+
+	TEST_CASE("DaedalusTranslator(compiled)") {
+		DaedalusVm interpreted {test::make_translator_script(), DaedalusVmExecutionFlag::DISABLE_NATIVE};
+		DaedalusVm translated {test::make_translator_script()};
+		REQUIRE_EQ(TRANSLATOR_TEST_MODULE.checksum, translated.checksum());
+
+		// The interpreter executes superinstructions for parts of the script.
+		std::set<DaedalusOpcode> ops;
+		for (auto address = 0u; address < interpreted.size(); ++address) {
+			if (auto const* instr = interpreted.compact_instruction_at(address)) ops.insert(instr->op);
+		}
+		CHECK(ops.contains(DaedalusOpcode::MOVI_IMM));
+		CHECK(ops.contains(DaedalusOpcode::BZ_CMP_IMM));
+		CHECK(ops.contains(DaedalusOpcode::BE_IMM));
+
+		for (auto* vm : {&interpreted, &translated}) {
+			vm->register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+			vm->register_external("EXT_CONCAT", [](std::string_view a, std::string_view b) {
+				return std::string {a} + std::string {b};
+			});
+		}
+
+		for (auto name : {"COLLATZ", "MIX", "GREET", "SCALE"}) {
+			CHECK_FALSE(interpreted.has_native_function(interpreted.find_symbol_by_name(name)));
+			CHECK(translated.has_native_function(translated.find_symbol_by_name(name)));
+		}
+
+		for (auto n : {-4, 0, 1, 2, 6, 7, 27, 97}) {
+			CHECK_EQ(translated.call_function<int>("COLLATZ", n), interpreted.call_function<int>("COLLATZ", n));
+		}
+		CHECK_EQ(translated.call_function<int>("COLLATZ", 27), 111);
+
+		for (auto [a, b] : std::array<std::pair<int, int>, 5> {{{0, 0}, {3, 8}, {8, 3}, {-7, 2}, {100, -100}}}) {
+			CHECK_EQ(translated.call_function<int>("MIX", a, b), interpreted.call_function<int>("MIX", a, b));
+		}
+
+		for (std::string_view name : {"", "World"}) {
+			CHECK_EQ(translated.call_function<std::string>("GREET", name),
+			         interpreted.call_function<std::string>("GREET", name));
+			CHECK_EQ(translated.find_symbol_by_name("GREETING")->get_string(),
+			         interpreted.find_symbol_by_name("GREETING")->get_string());
+		}
+		CHECK_EQ(translated.call_function<std::string>("GREET", std::string_view {"World"}), "Hello, World");
+
+		for (auto f : {0.0f, -2.25f, 1e10f}) {
+			CHECK_EQ(translated.call_function<float>("SCALE", f), interpreted.call_function<float>("SCALE", f));
+			CHECK_EQ(translated.find_symbol_by_name("LAST")->get_float(),
+			         interpreted.find_symbol_by_name("LAST")->get_float());
+			CHECK_EQ(translated.find_symbol_by_name("FACTOR")->get_float(),
+			         interpreted.find_symbol_by_name("FACTOR")->get_float());
+		}
+		CHECK_EQ(translated.find_symbol_by_name("FACTOR")->get_float(), 1.5f);
+	}
+
+	TEST_CASE("DaedalusVm.load_native_module") {
+		DaedalusVm vm {make_test_script()};
+		vm.register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+
+		auto* sub = vm.find_symbol_by_name("SUB");
+		DaedalusNativeFunctionEntry const functions[] = {{sub->index(), native_sub}};
+
+		CHECK_FALSE(vm.load_native_module({vm.checksum() + 1, functions}));
+		CHECK_FALSE(vm.has_native_function(sub));
+		REQUIRE(vm.load_native_module({vm.checksum(), functions}));
+		CHECK(vm.has_native_function(sub));
+
+		// Calls from C++ as well as from script code execute the translated function.
+		CHECK_EQ(vm.call_function<int>("SUB", 10, 3), 1007);
+		CHECK_EQ(vm.call_function<int>("TWICE_MINUS_ONE", 21), 1041);
+
+		// Overrides still take precedence.
+		vm.override_function("SUB", [](int a, int b) { return a + b; });
+		CHECK_EQ(vm.call_function<int>("TWICE_MINUS_ONE", 21), 43);
+
+		// Errors abort the translated function and are handled at the call.
+		DaedalusNativeFunctionEntry const failing[] = {{sub->index(), native_sub_failing}};
+		DaedalusVm lenient {make_test_script()};
+		lenient.register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+		REQUIRE(lenient.load_native_module({lenient.checksum(), failing}));
+		CHECK_THROWS_AS((void) lenient.call_function<int>("TWICE_MINUS_ONE", 21), DaedalusVmException);
+
+		lenient.register_exception_handler(
+		    [](DaedalusVm&, DaedalusScriptError const&, DaedalusInstruction const& instr) {
+			    CHECK_EQ(instr.op, DaedalusOpcode::BL);
+			    return DaedalusVmExceptionStrategy::CONTINUE;
+		    });
+		CHECK_EQ(lenient.call_function<int>("TWICE_MINUS_ONE", 21), 0);
+	}
+
+	TEST_CASE("DaedalusVm.register_native_module") {
+		static DaedalusNativeFunctionEntry const functions[] = {{0, native_answer}};
+		static DaedalusNativeModule const module {make_answer_script().checksum(), functions};
+		register_native_module(module);
+
+		DaedalusVm vm {make_answer_script()};
+		CHECK(vm.has_native_function(vm.find_symbol_by_name("ANSWER")));
+		CHECK_EQ(vm.call_function<int>("ANSWER"), 42);
+
+		DaedalusVm interpreted {make_answer_script(), DaedalusVmExecutionFlag::DISABLE_NATIVE};
+		CHECK_EQ(interpreted.call_function<int>("ANSWER"), 1);
+	}
+
+	TEST_CASE("DaedalusVm.optimize") {
+		DaedalusVm vm {make_test_script(), DaedalusVmExecutionFlag::OPTIMIZE};
+		vm.register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+
+		CHECK(vm.is_function_optimized(vm.find_symbol_by_name("SUM")));
+		CHECK(vm.is_function_optimized(vm.find_symbol_by_name("REC")));
+		CHECK_FALSE(vm.is_function_optimized(vm.find_symbol_by_name("EXT_DOUBLE")));
+		CHECK_FALSE(vm.is_function_optimized(vm.find_symbol_by_name("SUM.N")));
+
+		CHECK_EQ(vm.call_function<int>("SUM", 0), 0);
+		CHECK_EQ(vm.call_function<int>("SUM", 10), 45);
+		CHECK_EQ(vm.call_function<int>("SUB", 10, 3), 7);
+		CHECK_EQ(vm.call_function<int>("TWICE_MINUS_ONE", 21), 41);
+		CHECK_EQ(vm.call_function<int>("DOUBLE_SEVEN"), 14);
+
+		CHECK_EQ(vm.call_function<int>("REC", 3), 0);
+		vm.find_symbol_by_name("REC")->set_local_variables_enable(true);
+		CHECK_EQ(vm.call_function<int>("REC", 3), 3);
+
+		vm.override_function("SUB", [](int a, int b) { return a + b; });
+		CHECK_EQ(vm.call_function<int>("TWICE_MINUS_ONE", 21), 43);
+
+		// Failing instructions are executed again by the bytecode interpreter, which handles the error.
+		CHECK_EQ(vm.call_function<int>("DIV_PLUS_ONE", 9, 3), 4);
+		CHECK_THROWS_AS((void) vm.call_function<int>("DIV_PLUS_ONE", 9, 0), DaedalusVmException);
+		vm.register_exception_handler(lenient_vm_exception_handler);
+		CHECK_EQ(vm.call_function<int>("DIV_PLUS_ONE", 9, 0), 1);
+
+		// Time-sliced calls are interpreted.
+		DaedalusVmBudget budget;
+		budget.instructions = 10;
+		vm.push_int(10);
+		auto result = vm.start_call(vm.find_symbol_by_name("SUM"), budget);
+		CHECK_EQ(result, DaedalusVmExecutionResult::SUSPENDED);
+		while (result == DaedalusVmExecutionResult::SUSPENDED) result = vm.resume(budget);
+		CHECK_EQ(vm.pop_int(), 45);
+
+		DaedalusVm interpreted {make_test_script()};
+		CHECK_FALSE(interpreted.is_function_optimized(interpreted.find_symbol_by_name("SUM")));
+	}
+
+	TEST_CASE("DaedalusVm.optimize(constants)") {
+		auto calls = 0;
+		auto run = [&calls](std::uint8_t flags) {
+			DaedalusVm vm {make_constant_script(), flags};
+			vm.register_external("SIDE_EFFECT", [&calls]() {
+				++calls;
+				return -1;
+			});
+
+			CHECK_EQ(vm.call_function<int>("LOCALS", 3), 6);
+			CHECK_EQ(vm.call_function<int>("LOCALS", 8), 6);
+			CHECK_EQ(vm.call_function<int>("COND"), 7);
+
+			vm.find_symbol_by_name("ON")->set_int(100);
+			auto on = vm.call_function<int>("COND");
+
+			vm.find_symbol_by_name("OFF")->set_int(1);
+			auto off = vm.call_function<int>("COND");
+			return std::pair {on, off};
+		};
+
+		// Values of constants are folded into the code when the VM is created.
+		CHECK_EQ(run(DaedalusVmExecutionFlag::OPTIMIZE), std::pair {7, 7});
+		CHECK_EQ(calls, 0);
+
+		CHECK_EQ(run(DaedalusVmExecutionFlag::NONE), std::pair {106, -1});
+		CHECK_EQ(calls, 1);
+
+		CHECK_EQ(run(DaedalusVmExecutionFlag::OPTIMIZE | DaedalusVmExecutionFlag::IGNORE_CONST_SPECIFIER),
+		         std::pair {106, -1});
+		CHECK_EQ(calls, 2);
+	}
+
+	TEST_CASE("DaedalusVm.instance_cache") {
+		auto make_vm = [] {
+			auto vm = std::make_unique<DaedalusVm>(make_instance_script());
+			vm->register_member("C_ITEM.VALUE", &TestItem::value);
+			vm->register_member("C_ITEM.FLAGS", &TestItem::flags);
+			return vm;
+		};
+
+		auto vm = make_vm();
+		auto calls = 0;
+		vm->register_external("RANDOM", [&calls]() { return ++calls; });
+
+		auto* sword = vm->find_symbol_by_name("ITSWORD");
+		auto* potion = vm->find_symbol_by_name("ITPOTION");
+		auto* shield = vm->find_symbol_by_name("ITSHIELD");
+		auto* base_value = vm->find_symbol_by_name("BASE_VALUE");
+
+		(void) vm->init_instance<TestItem>(shield);
+		CHECK_FALSE(vm->is_instance_cached(shield));
+
+		vm->set_instance_cache_enable(true);
+		auto first = vm->init_instance<TestItem>(shield);
+		CHECK_EQ(first->value, 7);
+		CHECK_EQ(first->flags, 3);
+		CHECK(vm->is_instance_cached(shield));
+
+		// A cache hit overwrites all members, but keeps the user pointer.
+		auto second = std::make_shared<TestItem>();
+		second->value = 1;
+		second->user_ptr = &calls;
+		vm->init_instance(second, shield);
+		CHECK_EQ(second->value, 7);
+		CHECK_EQ(second->flags, 3);
+		CHECK_EQ(second->symbol_index(), shield->index());
+		CHECK_EQ(second->user_ptr, &calls);
+		CHECK_EQ(shield->get_instance(), second);
+
+		vm->clear_instance_cache();
+		CHECK_FALSE(vm->is_instance_cached(shield));
+		CHECK_EQ(vm->init_instance<TestItem>(shield)->value, 7);
+		CHECK(vm->is_instance_cached(shield));
+
+		// Registering externals drops all cached instances.
+		vm->register_external("RANDOM", [&calls]() { return ++calls; });
+		CHECK_FALSE(vm->is_instance_cached(shield));
+		(void) vm->init_instance<TestItem>(shield);
+		CHECK(vm->is_instance_cached(shield));
+
+		// Instances reading or writing global variables are never cached.
+		CHECK_EQ(vm->init_instance<TestItem>(sword)->value, 10);
+		CHECK_FALSE(vm->is_instance_cached(sword));
+		base_value->set_int(20);
+		CHECK_EQ(vm->init_instance<TestItem>(sword)->value, 20);
+		CHECK_FALSE(vm->is_instance_cached(sword));
+
+		// Instances calling externals are never cached.
+		CHECK_EQ(vm->init_instance<TestItem>(potion)->flags, 1);
+		CHECK_EQ(vm->init_instance<TestItem>(potion)->flags, 2);
+		CHECK_FALSE(vm->is_instance_cached(potion));
+
+		vm->mark_instance_impure(shield);
+		CHECK_FALSE(vm->is_instance_cached(shield));
+		(void) vm->init_instance<TestItem>(shield);
+		CHECK_FALSE(vm->is_instance_cached(shield));
+
+		vm->clear_instance_cache();
+		(void) vm->init_instance<TestItem>(shield);
+		CHECK_FALSE(vm->is_instance_cached(shield));
+
+		// Overriding a function called by a cached instance drops the cache and makes the instance impure.
+		auto other = make_vm();
+		other->set_instance_cache_enable(true);
+		(void) other->init_instance<TestItem>("ITSHIELD");
+		CHECK(other->is_instance_cached(other->find_symbol_by_name("ITSHIELD")));
+
+		other->override_function("SHIELD_VALUE", []() { return 8; });
+		CHECK_FALSE(other->is_instance_cached(other->find_symbol_by_name("ITSHIELD")));
+		CHECK_EQ(other->init_instance<TestItem>("ITSHIELD")->value, 8);
+		CHECK_FALSE(other->is_instance_cached(other->find_symbol_by_name("ITSHIELD")));
+	}
+
+	TEST_CASE("DaedalusScript.bind_members") {
+		DaedalusVm vm {make_instance_script()};
+		vm.register_external("RANDOM", []() { return 3; });
+
+		std::string_view const members[] = {"C_ITEM.FLAGS", "C_ITEM.VALUE"};
+		CHECK_THROWS_AS((void) vm.bind_members("C_ITEM", members), DaedalusUnboundMemberAccess);
+
+		vm.register_member("C_ITEM.VALUE", &TestItem::value);
+		vm.register_member("C_ITEM.FLAGS", &TestItem::flags);
+
+		std::string_view const missing[] = {"C_ITEM.MISSING"};
+		std::string_view const global[] = {"BASE_VALUE"};
+		CHECK_THROWS_AS((void) vm.bind_members("C_ITEM", missing), DaedalusSymbolNotFound);
+		CHECK_THROWS_AS((void) vm.bind_members("C_ITEM", global), DaedalusMemberRegistrationError);
+
+		auto accessor = vm.bind_members("C_ITEM", members);
+		REQUIRE_EQ(accessor.size(), 2);
+		CHECK_EQ(accessor.member(0).name(), "C_ITEM.FLAGS");
+		CHECK_EQ(accessor.count(1), 1);
+
+		std::vector<std::shared_ptr<TestItem>> items {
+		    vm.init_instance<TestItem>("ITSWORD"),
+		    vm.init_instance<TestItem>("ITPOTION"),
+		};
+
+		CHECK(accessor.matches(*items[0]));
+		CHECK_EQ(*accessor.get<std::int32_t>(*items[1], 0), 3);
+
+		std::array<std::int32_t, 2> values {};
+		accessor.gather<std::int32_t>(0, items, std::span {values});
+		CHECK_EQ(values, std::array<std::int32_t, 2> {5, 3});
+
+		values = {7, 8};
+		accessor.scatter<std::int32_t>(1, items, std::span<std::int32_t const> {values});
+		CHECK_EQ(items[0]->value, 7);
+		CHECK_EQ(items[1]->value, 8);
+		CHECK_EQ(vm.find_symbol_by_name("C_ITEM.VALUE")->get_int(0, items[1].get()), 8);
+
+		// Empty slots are skipped, along with their values.
+		std::vector<std::shared_ptr<TestItem>> sparse {nullptr, items[1]};
+		values = {-1, -1};
+		accessor.gather<std::int32_t>(1, sparse, std::span {values});
+		CHECK_EQ(values, std::array<std::int32_t, 2> {-1, 8});
+
+		values = {1, 2};
+		accessor.scatter<std::int32_t>(1, sparse, std::span<std::int32_t const> {values});
+		CHECK_EQ(items[0]->value, 7);
+		CHECK_EQ(items[1]->value, 2);
+
+		std::array<float, 2> floats {};
+		std::array<std::int32_t, 1> small {};
+		CHECK_THROWS_AS(accessor.gather<float>(0, items, std::span {floats}), DaedalusIllegalTypeAccess);
+		CHECK_THROWS_AS(accessor.gather<std::int32_t>(0, items, std::span {small}), DaedalusIllegalIndexAccess);
+
+		std::vector<std::shared_ptr<TestInstance>> others {std::make_shared<TestInstance>()};
+		CHECK_FALSE(accessor.matches(*others[0]));
+		CHECK_THROWS_AS(accessor.gather<std::int32_t>(0, others, std::span {small}), DaedalusIllegalContextType);
+	}
+
+	TEST_CASE("DaedalusVm.snapshot") {
+		auto make_vm = [] {
+			auto vm = std::make_unique<DaedalusVm>(make_instance_script());
+			vm->register_member("C_ITEM.VALUE", &TestItem::value);
+			vm->register_member("C_ITEM.FLAGS", &TestItem::flags);
+			vm->register_external("RANDOM", []() { return 3; });
+			return vm;
+		};
+
+		auto vm = make_vm();
+		auto sword = vm->init_instance<TestItem>("ITSWORD");
+		auto potion = vm->init_instance<TestItem>("ITPOTION");
+
+		auto* base_value = vm->find_symbol_by_name("BASE_VALUE");
+		auto* name = vm->find_symbol_by_name("NAME");
+		auto* current = vm->find_symbol_by_name("CURRENT");
+		CHECK_EQ(name->get_string(), "Sword");
+
+		base_value->set_int(42);
+		name->set_string("Sword of a length which does not fit into small string storage");
+		current->set_instance(sword);
+		sword->flags = 7;
+
+		std::vector<std::byte> data;
+		auto w = Write::to(&data);
+		vm->save_snapshot(w.get());
+
+		base_value->set_int(1);
+		name->set_string("Potion");
+		current->set_instance(potion);
+		sword->value = 0;
+		sword->flags = 0;
+		potion->flags = 0;
+
+		auto r = Read::from(&data);
+		vm->load_snapshot(r.get());
+		CHECK_EQ(base_value->get_int(), 42);
+		CHECK_EQ(name->get_string(), "Sword of a length which does not fit into small string storage");
+		CHECK_EQ(current->get_instance(), sword);
+		CHECK_EQ(sword->value, 10);
+		CHECK_EQ(sword->flags, 7);
+		CHECK_EQ(potion->flags, 3);
+
+		// Snapshots restore into the instances of other VMs for the same script.
+		auto copy = make_vm();
+		auto copied_sword = copy->init_instance<TestItem>("ITSWORD");
+		r = Read::from(&data);
+		copy->load_snapshot(r.get());
+		CHECK_EQ(copy->find_symbol_by_name("BASE_VALUE")->get_int(), 42);
+		CHECK_EQ(copied_sword->flags, 7);
+		CHECK_EQ(copy->find_symbol_by_name("CURRENT")->get_instance(), copied_sword);
+
+		DaedalusVm different {make_test_script()};
+		r = Read::from(&data);
+		CHECK_THROWS_AS(different.load_snapshot(r.get()), DaedalusVmException);
+
+		// Invalid snapshots are rejected without changing anything.
+		base_value->set_int(5);
+		sword->flags = 0;
+
+		std::string_view text {"Sword of a length"};
+		auto at = std::search(data.begin(), data.end(), text.begin(), text.end(), [](std::byte a, char b) {
+			return a == static_cast<std::byte>(b);
+		});
+		REQUIRE_NE(at, data.end());
+
+		auto corrupt = data;
+		auto length = corrupt.begin() + (at - data.begin()) - 4;
+		std::fill(length, length + 4, std::byte {0xFF});
+		r = Read::from(&corrupt);
+		CHECK_THROWS_AS(vm->load_snapshot(r.get()), DaedalusVmException);
+
+		auto truncated = std::vector<std::byte> {data.begin(), data.end() - 8};
+		r = Read::from(&truncated);
+		CHECK_THROWS_AS(vm->load_snapshot(r.get()), DaedalusVmException);
+
+		CHECK_EQ(base_value->get_int(), 5);
+		CHECK_EQ(sword->flags, 0);
+	}
+
+	TEST_CASE("DaedalusProfiler") {
+		auto script = make_test_script();
+		auto& sum = *script.find_symbol_by_name("SUM");
+		auto& sub = *script.find_symbol_by_name("SUB");
+
+		DaedalusProfiler profiler;
+		profiler.enter(sum);
+		profiler.instruction();
+		profiler.instruction();
+		profiler.enter(sub);
+		profiler.instruction();
+		profiler.enter(sub);
+		profiler.instruction();
+		profiler.leave();
+		profiler.leave();
+		profiler.instruction();
+		profiler.leave();
+
+		REQUIRE_NE(profiler.entry(sum), nullptr);
+		CHECK_EQ(profiler.entry(sum)->calls, 1);
+		CHECK_EQ(profiler.entry(sum)->instructions_inclusive, 5);
+		CHECK_EQ(profiler.entry(sum)->instructions_exclusive, 3);
+		CHECK_GE(profiler.entry(sum)->time_inclusive, profiler.entry(sum)->time_exclusive);
+
+		// Recursive calls are only counted once in the inclusive values.
+		REQUIRE_NE(profiler.entry(sub), nullptr);
+		CHECK_EQ(profiler.entry(sub)->calls, 2);
+		CHECK_EQ(profiler.entry(sub)->instructions_inclusive, 2);
+		CHECK_EQ(profiler.entry(sub)->instructions_exclusive, 2);
+
+		CHECK_EQ(profiler.entry(*script.find_symbol_by_name("REC")), nullptr);
+		CHECK_EQ(profiler.entries().size(), 2);
+
+		std::vector<std::byte> data;
+		auto w = Write::to(&data);
+		profiler.write_collapsed(w.get(), script, DaedalusProfileMetric::INSTRUCTIONS);
+		CHECK_EQ(std::string {reinterpret_cast<char const*>(data.data()), data.size()},
+		         "SUM 3\nSUM;SUB 1\nSUM;SUB;SUB 1\n");
+
+		data.clear();
+		w = Write::to(&data);
+		profiler.write_chrome_trace(w.get(), script);
+		CHECK_EQ(std::string {reinterpret_cast<char const*>(data.data()), data.size()}, "{\"traceEvents\":[\n]}\n");
+
+		profiler.set_trace_enabled(true);
+		profiler.enter(sub);
+		profiler.leave();
+
+		data.clear();
+		w = Write::to(&data);
+		profiler.write_chrome_trace(w.get(), script);
+		auto trace = std::string {reinterpret_cast<char const*>(data.data()), data.size()};
+		CHECK_NE(trace.find("{\"name\":\"SUB\",\"ph\":\"X\""), std::string::npos);
+
+		profiler.reset();
+		CHECK(profiler.entries().empty());
+
+#ifdef _ZK_WITH_VM_PROFILER
+		DaedalusVm vm {make_test_script()};
+		vm.register_external("EXT_DOUBLE", [](int a) { return a * 2; });
+		CHECK_EQ(vm.profiler(), nullptr);
+
+		vm.enable_profiler(true);
+		REQUIRE_NE(vm.profiler(), nullptr);
+		CHECK_EQ(vm.call_function<int>("TWICE_MINUS_ONE", 21), 41);
+
+		auto* twice = vm.profiler()->entry(*vm.find_symbol_by_name("TWICE_MINUS_ONE"));
+		auto* ext = vm.profiler()->entry(*vm.find_symbol_by_name("EXT_DOUBLE"));
+		REQUIRE_NE(twice, nullptr);
+		REQUIRE_NE(ext, nullptr);
+		CHECK_EQ(twice->calls, 1);
+		CHECK_EQ(ext->calls, 1);
+		CHECK_EQ(ext->instructions_inclusive, 0);
+		CHECK_GT(twice->instructions_exclusive, 0);
+		CHECK_GE(twice->time_inclusive, ext->time_inclusive);
+
+		// Calls interrupted by a script error are closed when the error leaves the VM.
+		vm.enable_profiler(true);
+		CHECK_THROWS_AS((void) vm.call_function<int>("DIV_PLUS_ONE", 1, 0), DaedalusVmException);
+		CHECK_EQ(vm.profiler()->depth(), 0);
+		CHECK_EQ(vm.call_function<int>("SUB", 10, 3), 7);
+
+		data.clear();
+		w = Write::to(&data);
+		vm.profiler()->write_collapsed(w.get(), vm, DaedalusProfileMetric::INSTRUCTIONS);
+		auto collapsed = std::string {reinterpret_cast<char const*>(data.data()), data.size()};
+		CHECK_EQ(collapsed.find("DIV_PLUS_ONE;SUB"), std::string::npos);
+		CHECK_NE(collapsed.find("SUB "), std::string::npos);
+
+		vm.enable_profiler(false);
+		CHECK_EQ(vm.profiler(), nullptr);
+#endif
+	}
+
+	TEST_CASE("DaedalusTrace") {
+		auto script = make_test_script();
+
+		DaedalusTrace trace {5};
+		CHECK_EQ(trace.capacity(), 8);
+		CHECK(trace.entries().empty());
+
+		for (std::uint32_t i = 0; i < 10; ++i) {
+			trace.record(i * 5, DaedalusOpcode::PUSHI, i, script.find_symbol_by_name("SUM")->index());
+		}
+
+		// Only the most recent entries are kept.
+		auto entries = trace.entries();
+		CHECK_EQ(trace.recorded(), 10);
+		REQUIRE_EQ(entries.size(), 8);
+		CHECK_EQ(entries.front().pc, 10);
+		CHECK_EQ(entries.front().stack_depth, 2);
+		CHECK_EQ(entries.back().pc, 45);
+		CHECK_EQ(entries.back().op, DaedalusOpcode::PUSHI);
+
+		std::vector<std::byte> data;
+		auto w = Write::to(&data);
+		trace.write(w.get(), script, 2);
+		CHECK_EQ(std::string {reinterpret_cast<char const*>(data.data()), data.size()},
+		         "SUM 00000028 40 8\nSUM 0000002d 40 9\n");
+
+		trace.reset();
+		CHECK(trace.entries().empty());
+
+		DaedalusVm vm {make_test_script()};
+		CHECK_EQ(vm.trace(), nullptr);
+
+		vm.enable_trace(1024);
+		REQUIRE_NE(vm.trace(), nullptr);
+		CHECK_EQ(vm.call_function<int>("SUM", 3), 3);
+
+		auto* sum = vm.find_symbol_by_name("SUM");
+		entries = vm.trace()->entries();
+		REQUIRE(!entries.empty());
+		CHECK_EQ(entries.front().pc, sum->address());
+		CHECK_EQ(entries.front().function, sum->index());
+		CHECK_EQ(entries.back().op, DaedalusOpcode::RSR);
+
+		// The trace remains available after an unhandled error.
+		vm.enable_trace(4);
+		CHECK_THROWS_AS((void) vm.call_function<int>("DIV_PLUS_ONE", 9, 0), DaedalusVmException);
+		entries = vm.trace()->entries();
+		REQUIRE(!entries.empty());
+		CHECK_EQ(entries.back().op, DaedalusOpcode::DIV);
+		CHECK_EQ(entries.back().function, vm.find_symbol_by_name("DIV_PLUS_ONE")->index());
+
+		vm.enable_trace(0);
+		CHECK_EQ(vm.trace(), nullptr);
+	}
+
+	TEST_CASE("DaedalusCallGraph") {
+		auto script = make_test_script();
+		DaedalusCallGraph graph {script};
+
+		auto* sum = script.find_symbol_by_name("SUM");
+		auto* sub = script.find_symbol_by_name("SUB");
+		auto* twice = script.find_symbol_by_name("TWICE_MINUS_ONE");
+		auto* ext_double = script.find_symbol_by_name("EXT_DOUBLE");
+		auto* rec = script.find_symbol_by_name("REC");
+
+		CHECK_EQ(graph.nodes().size(), script.functions().size());
+		CHECK_EQ(graph.node(*script.find_symbol_by_name("SUM.N")), nullptr);
+
+		auto* twice_node = graph.node(*twice);
+		REQUIRE_NE(twice_node, nullptr);
+		CHECK(twice_node->verified);
+
+		auto edges = graph.edges(*twice_node);
+		REQUIRE_EQ(edges.size(), 2);
+		CHECK_EQ(edges[0].callee, ext_double->index());
+		CHECK_EQ(edges[0].kind, DaedalusCallKind::EXTERNAL);
+		CHECK_EQ(edges[1].callee, sub->index());
+		CHECK_EQ(edges[1].kind, DaedalusCallKind::CALL);
+		CHECK_EQ(edges[1].caller, twice->index());
+
+		// Depths include the function itself and all functions it calls.
+		CHECK_EQ(graph.node(*sum)->max_call_depth, 1);
+		CHECK_EQ(graph.node(*sub)->max_call_depth, 1);
+		CHECK_EQ(twice_node->max_call_depth, 2);
+		CHECK_EQ(twice_node->max_stack_depth, twice_node->stack_depth + graph.node(*sub)->stack_depth);
+		CHECK_EQ(graph.node(*ext_double)->max_call_depth, 0);
+		CHECK_EQ(graph.node(*rec)->max_call_depth, DaedalusCallGraphNode::UNBOUNDED);
+		CHECK_EQ(graph.node(*rec)->max_stack_depth, DaedalusCallGraphNode::UNBOUNDED);
+
+		DaedalusSymbol const* roots[] = {twice};
+		auto reachable = graph.reachable(roots);
+		CHECK_EQ(reachable, std::vector<std::uint32_t> {ext_double->index(), sub->index(), twice->index()});
+
+		auto unreachable = graph.unreachable(roots);
+		CHECK(std::find(unreachable.begin(), unreachable.end(), sum->index()) != unreachable.end());
+		CHECK(std::find(unreachable.begin(), unreachable.end(), sub->index()) == unreachable.end());
+		CHECK(std::find(unreachable.begin(), unreachable.end(), ext_double->index()) == unreachable.end());
+
+		// Instances set using GMOVI and functions assigned to variables are followed as well.
+		ScriptBuilder b;
+		using Op = DaedalusOpcode;
+
+		auto item = b.cls("C_ITEM", 0);
+		auto handler = b.variable("HANDLER");
+		b.symbols[handler].type = DaedalusDataType::FUNCTION;
+
+		auto callback = b.function("CALLBACK", 0);
+		b.op(Op::RSR);
+
+		auto sword = b.instance("ITSWORD", item);
+		b.op(Op::RSR);
+
+		b.function("UNUSED", 0);
+		b.op(Op::RSR);
+
+		auto main = b.function("MAIN", 0);
+		b.op(Op::GMOVI, sword);
+		b.op(Op::PUSHI, callback).op(Op::PUSHV, handler).op(Op::MOVVF).op(Op::RSR);
+
+		auto other = b.build();
+		DaedalusCallGraph other_graph {other};
+
+		auto* main_node = other_graph.node(*other.find_symbol_by_index(main));
+		REQUIRE_NE(main_node, nullptr);
+		REQUIRE_EQ(other_graph.edges(*main_node).size(), 2);
+		CHECK_EQ(other_graph.edges(*main_node)[0].kind, DaedalusCallKind::INSTANCE);
+		CHECK_EQ(other_graph.edges(*main_node)[0].callee, sword);
+		CHECK_EQ(other_graph.edges(*main_node)[1].kind, DaedalusCallKind::REFERENCE);
+		CHECK_EQ(other_graph.edges(*main_node)[1].callee, callback);
+
+		DaedalusSymbol const* other_roots[] = {other.find_symbol_by_index(main)};
+		CHECK_EQ(other_graph.unreachable(other_roots), std::vector<std::uint32_t> {main - 1});
+
+		std::vector<std::byte> data;
+		auto w = Write::to(&data);
+		other_graph.write_json(w.get(), other_roots);
+
+		auto json = std::string {reinterpret_cast<char const*>(data.data()), data.size()};
+		CHECK_EQ(json.rfind("{\"functions\":[\n", 0), 0);
+		CHECK_NE(json.find("\"name\":\"UNUSED\",\"external\":false,\"verified\":true,\"stack_depth\":0,"
+		                   "\"max_call_depth\":1,\"max_stack_depth\":0,\"reachable\":false}"),
+		         std::string::npos);
+		CHECK_NE(json.find("\"callee\":" + std::to_string(callback) + ",\"address\":"), std::string::npos);
+		CHECK_NE(json.find("\"kind\":\"reference\"}\n]}\n"), std::string::npos);
+	}
+
+	TEST_CASE("DaedalusVm.stack") {
+		CHECK_EQ(sizeof(DaedalusStackSlot), 16);
+
+		DaedalusVm vm {make_test_script()};
+
+		vm.push_int(10);
+		vm.push_float(1.5f);
+		vm.push_reference(vm.find_symbol_by_name("SUM.N"));
+		vm.find_symbol_by_name("SUM.N")->set_int(42);
+
+		CHECK(vm.top_is_reference());
+		CHECK_EQ(vm.pop_int(), 42);
+		CHECK_EQ(vm.pop_float(), 1.5f);
+		CHECK_EQ(vm.pop_int(), 10);
+
+		auto instance = std::make_shared<TestInstance>();
+		vm.push_instance(instance);
+		vm.push_instance(nullptr);
+		CHECK_EQ(vm.pop_instance(), nullptr);
+
+		// The VM hands out shared ownership of the instance when it is popped.
+		auto popped = vm.pop_instance();
+		CHECK_EQ(popped.get(), instance.get());
+		CHECK_FALSE(popped.owner_before(instance));
+		CHECK_FALSE(instance.owner_before(popped));
+
+		// The VM stops keeping instances alive once they are popped.
+		std::weak_ptr<DaedalusInstance> weak = instance;
+		for (auto i = 0; i < 1000; ++i) {
+			vm.push_instance(instance);
+			vm.push_instance(instance);
+			CHECK_EQ(vm.pop_instance(), instance);
+			CHECK_EQ(vm.pop_instance(), instance);
+		}
+		popped.reset();
+		instance.reset();
+		CHECK(weak.expired());
+
+		// Instances which can not share their ownership themselves are shared through their owner instead.
+		auto shared = std::make_shared<TestSharedInstance>();
+		REQUIRE(static_cast<DaedalusInstance*>(shared.get())->weak_from_this().expired());
+		vm.push_instance(shared);
+		popped = vm.pop_instance();
+		CHECK_EQ(popped.get(), shared.get());
+		CHECK_FALSE(popped.owner_before(shared));
+		CHECK_FALSE(shared.owner_before(popped));
+	}
+
+	TEST_CASE("DaedalusVm.temporary_strings") {
+		DaedalusVm vm {make_test_script()};
+
+		for (auto i = 0; i < 1000; ++i) {
+			vm.push_string("a string which is too long for small string storage " + std::to_string(i));
+		}
+
+		for (auto i = 999; i >= 0; --i) {
+			CHECK_EQ(vm.pop_string(), "a string which is too long for small string storage " + std::to_string(i));
+		}
+
+		// Outside of calls, popped strings stay valid until the next call.
+		vm.push_string("first");
+		auto const& first = vm.pop_string();
+		vm.push_string("second");
+		CHECK_EQ(first, "first");
+
+		auto [sym, index, context] = vm.pop_reference();
+		CHECK_EQ(sym->get_string(index), "second");
+		CHECK_EQ(index, 1001);
+
+		// Once it does, all temporary strings are reused.
+		CHECK_EQ(vm.call_function<int>("SUB", 10, 3), 7);
+		vm.push_string("third");
+		CHECK_EQ(std::get<1>(vm.pop_reference()), 0);
+
+		// Strings pushed while a function runs are reused after each statement, so loops don't use up all of them.
+		ScriptBuilder b;
+		using Op = DaedalusOpcode;
+
+		auto ext = b.external("EXT_NAME", 1);
+		b.returns(ext, DaedalusDataType::STRING);
+		b.variable("EXT_NAME.PAR0");
+		auto last = b.string("LAST");
+
+		b.function("NAMES", 1);
+		auto n = b.variable("NAMES.N");
+		b.op(Op::PUSHV, n).op(Op::MOVI);
+		auto loop = b.here();
+		b.op(Op::PUSHI, 0).op(Op::PUSHV, n).op(Op::GT);
+		auto exit = b.here();
+		b.op(Op::BZ, 0);
+		b.op(Op::PUSHV, n).op(Op::BE, ext).op(Op::PUSHV, last).op(Op::MOVS);
+		b.op(Op::PUSHI, 1).op(Op::PUSHV, n).op(Op::SUBMOVI);
+		b.op(Op::B, loop);
+		b.patch(exit, b.here());
+		b.op(Op::RSR);
+
+		DaedalusVm names {b.build()};
+		names.register_external("EXT_NAME", [](int i) { return "a name which does not fit " + std::to_string(i); });
+		names.call_function("NAMES", 100000);
+		CHECK_EQ(names.find_symbol_by_name("LAST")->get_string(), "a name which does not fit 1");
+		CHECK_LE(names.symbols().back().count(), 2);
+	}
+}
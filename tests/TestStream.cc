@@ -4,6 +4,9 @@
 
 #include <doctest/doctest.h>
 
+#include <cstdio>
+#include <sstream>
+
 template <typename... Args>
 static std::vector<std::byte> bytes(Args... bytes) {
 	return std::vector<std::byte> {static_cast<std::byte>(bytes)...};
@@ -141,6 +144,161 @@ TEST_SUITE("Read") {
 		CHECK(r->eof());
 		CHECK(r->read_line(true).empty());
 	}
+
+	TEST_CASE("Read.read_array") {
+		auto r = zenkit::Read::from(bytes(0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x80, 0x3F, 0x02));
+
+		std::uint32_t values[2] {};
+		CHECK_EQ(r->read_array(std::span {values}), 2);
+		CHECK_EQ(values[0], 1);
+		CHECK_EQ(values[1], 0xFFFF'FFFF);
+
+		// Values which were not read completely are zeroed.
+		zenkit::Vec2 vectors[2] {zenkit::Vec2 {5.f}, zenkit::Vec2 {5.f}};
+		CHECK_EQ(r->read_array(std::span {vectors}), 0);
+		CHECK_EQ(vectors[0].x, 1.f);
+		CHECK_NE(vectors[0].y, 5.f);
+		CHECK_EQ(vectors[1], zenkit::Vec2 {0.f});
+		CHECK(r->eof());
+	}
+
+	TEST_CASE("ReadSpan") {
+		auto data = bytes('H', 'i', '\n', ' ', '\t', 'Y', 'o', '\0', ' ', 0x01, 0x00, 0xFF, 0xFF, 0xFF, 0xFF);
+		zenkit::ReadSpan s {data};
+
+		CHECK_EQ(s.read_line(true), "Hi");
+		CHECK_EQ(s.tell(), 5);
+		CHECK_EQ(s.read_line(true), "Yo");
+		CHECK_EQ(s.tell(), 8);
+		CHECK_EQ(s.read_char(), ' ');
+		CHECK_EQ(s.read_ushort(), 1);
+		CHECK_EQ(s.read_int(), -1);
+
+		CHECK(s.eof());
+		CHECK_EQ(s.read_uint(), 0);
+
+		s.seek(-4, zenkit::Whence::END);
+		CHECK_EQ(s.read_uint(), 0xFFFF'FFFF);
+
+		// Lines end at the first terminator, whichever one it is.
+		auto lines = bytes('A', '\0', 'B', '\r', 'C', '\n', 'D', '\r', '\0', 'E');
+		zenkit::ReadSpan l {lines};
+		CHECK_EQ(l.read_line(false), "A");
+		CHECK_EQ(l.read_line(false), "B");
+		CHECK_EQ(l.read_line(false), "C");
+		CHECK_EQ(l.read_line(false), "D");
+		CHECK_EQ(l.read_line(false), "");
+		CHECK_EQ(l.read_line(false), "E");
+		CHECK(l.eof());
+	}
+
+	TEST_CASE("Read.buffered") {
+		std::string data;
+		for (auto i = 0; i < 100; ++i) {
+			data.push_back(static_cast<char>(i));
+		}
+
+		std::stringstream stream {data};
+		stream.seekg(2);
+
+		{
+			auto r = zenkit::Read::from(&stream, 8);
+			CHECK_EQ(r->tell(), 2);
+			CHECK_EQ(r->read_ubyte(), 2);
+			CHECK_EQ(r->read_uint(), 0x06050403);
+
+			// Seeks within and outside of the buffered block.
+			r->seek(-3, zenkit::Whence::CUR);
+			CHECK_EQ(r->read_ubyte(), 4);
+			r->seek(50, zenkit::Whence::BEG);
+			CHECK_EQ(r->read_ubyte(), 50);
+			r->seek(-1, zenkit::Whence::END);
+			CHECK_EQ(r->tell(), 99);
+			r->seek(10, zenkit::Whence::BEG);
+
+			// Reads spanning blocks and reads larger than the buffer.
+			CHECK_EQ(r->read_string(4), std::string {data.data() + 10, 4});
+			CHECK_EQ(r->read_string(20), std::string {data.data() + 14, 20});
+			CHECK_EQ(r->tell(), 34);
+			CHECK_EQ(r->read_ubyte(), 34);
+
+			r->seek(96, zenkit::Whence::BEG);
+			CHECK_EQ(r->read_uint(), 0x63626160);
+			CHECK_EQ(r->read_ubyte(), 0);
+			CHECK(r->eof());
+
+			r->seek(20, zenkit::Whence::BEG);
+			CHECK_EQ(r->read_ubyte(), 20);
+		}
+
+		// The underlying stream is left at the position of the last byte read.
+		CHECK_EQ(stream.tellg(), 21);
+
+		auto* file = std::tmpfile();
+		REQUIRE_NE(file, nullptr);
+		std::fwrite(data.data(), 1, data.size(), file);
+		std::rewind(file);
+
+		auto buffered = zenkit::Read::from(file);
+		CHECK_EQ(buffered->read_string(100), data);
+		CHECK(buffered->eof());
+		buffered.reset();
+
+		std::rewind(file);
+		auto unbuffered = zenkit::Read::from(file, 0);
+		CHECK_EQ(unbuffered->read_ubyte(), 0);
+		CHECK_EQ(std::ftell(file), 1);
+		std::fclose(file);
+	}
+
+	TEST_CASE("Read.view") {
+		auto data = bytes(0x01, 0x00, 0x02, 0x00, 0x03, 0x00);
+		auto r = zenkit::Read::from(&data);
+		CHECK_EQ(r->view().data(), data.data());
+		CHECK_EQ(r->view().size(), data.size());
+
+		std::uint16_t first = 0;
+		r->seek(2, zenkit::Whence::BEG);
+		zenkit::proto::read_contiguous(r.get(), [&first](auto* c) { first = c->read_ushort(); });
+		CHECK_EQ(first, 2);
+		CHECK_EQ(r->tell(), 4);
+
+		std::stringstream stream {"ab"};
+		auto sr = zenkit::Read::from(&stream);
+		CHECK(sr->view().empty());
+
+		char c = 0;
+		zenkit::proto::read_contiguous(sr.get(), [&c](auto* rd) { c = rd->read_char(); });
+		CHECK_EQ(c, 'a');
+		CHECK_EQ(sr->tell(), 1);
+	}
+
+	TEST_CASE("Read.read_line_view") {
+		auto data = bytes('H', 'i', '\r', '\n', ' ', '\t', 'Y', 'o', '\n', 'E', 'n', 'd');
+		std::string buffer;
+
+		// Memory-backed streams return views into the underlying data.
+		auto r = zenkit::Read::from(&data);
+		auto line = r->read_line_view(true, buffer);
+		CHECK_EQ(line, "Hi");
+		CHECK_EQ(static_cast<void const*>(line.data()), static_cast<void const*>(data.data()));
+		CHECK_EQ(r->tell(), 6);
+		CHECK_EQ(r->read_line_view(true, buffer), "Yo");
+		CHECK_EQ(r->read_line_view(true, buffer), "End");
+		CHECK(r->eof());
+		CHECK(r->read_line_view(true, buffer).empty());
+		CHECK(buffer.empty());
+
+		// Other streams fall back to copying into the buffer.
+		std::stringstream stream {"Hi\r\n \tYo\nEnd"};
+		auto sr = zenkit::Read::from(&stream);
+		CHECK_EQ(sr->read_line_view(true, buffer), "Hi");
+		CHECK_EQ(buffer, "Hi");
+		CHECK_EQ(sr->tell(), 6);
+		CHECK_EQ(sr->read_line_view(false, buffer), "Yo");
+		CHECK_EQ(sr->read_line_view(false, buffer), "End");
+		CHECK(sr->eof());
+	}
 }
 
 TEST_SUITE("Write") {
@@ -287,4 +445,50 @@ TEST_SUITE("Write") {
 		CHECK_EQ(BUF[5], std::byte {'!'});
 		CHECK_EQ(BUF[6], std::byte {'\n'});
 	}
+
+	TEST_CASE("Write.buffered") {
+		enum class Chunk : std::uint16_t { OUTER = 1, INNER = 2 };
+
+		auto produce = [](zenkit::Write* w) {
+			w->write_uint(0xAABBCCDD);
+
+			zenkit::proto::write_chunk(w, Chunk::OUTER, [](zenkit::Write* c) {
+				zenkit::proto::write_chunk(c, Chunk::INNER, [](zenkit::Write* i) { i->write_string("small"); });
+				c->write_string(std::string(40, 'x'));
+				zenkit::proto::write_chunk(c, Chunk::INNER, [](zenkit::Write* i) { i->write_ushort(7); });
+			});
+
+			// Rewrite data which has already been flushed and data still in the buffer.
+			auto end = w->tell();
+			w->seek(1, zenkit::Whence::BEG);
+			w->write_ubyte(0x11);
+			w->seek(static_cast<ssize_t>(end), zenkit::Whence::BEG);
+			w->write_uint(1);
+			w->seek(-2, zenkit::Whence::CUR);
+			w->write_ubyte(0x22);
+			w->seek(0, zenkit::Whence::END);
+			w->write_ubyte(0x33);
+		};
+
+		std::vector<std::byte> expected;
+		produce(zenkit::Write::to(&expected).get());
+
+		std::stringstream stream;
+		{
+			auto w = zenkit::Write::to(&stream, 8);
+			produce(w.get());
+			CHECK_EQ(w->tell(), expected.size());
+		}
+
+		auto actual = stream.str();
+		CHECK_EQ(actual, std::string {reinterpret_cast<char const*>(expected.data()), expected.size()});
+
+		// Data is passed on when flushing.
+		std::stringstream flushed;
+		auto w = zenkit::Write::to(&flushed);
+		w->write_uint(5);
+		CHECK(flushed.str().empty());
+		w->flush();
+		CHECK_EQ(flushed.str().size(), 4);
+	}
 }
@@ -0,0 +1,27 @@
+// Copyright © 2024 GothicKit Contributors.
+// SPDX-License-Identifier: MIT
+#include "DaedalusScriptBuilder.hh"
+
+#include <zenkit/DaedalusTranslator.hh>
+
+#include <iostream>
+
+/// Writes the translation of zenkit::test::make_translator_script() to the given file, which is compiled into the
+/// test suite. This way the tests can compare translated functions with the interpreter.
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: test-zenkit-translate <OUTPUT.cc>\n";
+		return -1;
+	}
+
+	auto wr = zenkit::Write::to(std::filesystem::path {argv[1]});
+	if (wr == nullptr) {
+		std::cerr << "Failed to open " << argv[1] << " for writing.\n";
+		return -1;
+	}
+
+	auto script = zenkit::test::make_translator_script();
+	zenkit::DaedalusTranslator translator {script};
+	translator.write_source(wr.get(), "TRANSLATOR_TEST_MODULE");
+	return 0;
+}